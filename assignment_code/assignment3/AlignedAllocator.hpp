@@ -0,0 +1,67 @@
+#ifndef ALIGNED_ALLOCATOR_H_
+#define ALIGNED_ALLOCATOR_H_
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+
+namespace GLOO {
+// Minimal C++11 allocator returning memory aligned to Alignment bytes, so that
+// std::vector storage can be used directly with aligned SIMD loads/stores.
+template <class T, size_t Alignment>
+class AlignedAllocator {
+ public:
+  using value_type = T;
+
+  template <class U>
+  struct rebind {
+    using other = AlignedAllocator<U, Alignment>;
+  };
+
+  AlignedAllocator() {
+  }
+  template <class U>
+  AlignedAllocator(const AlignedAllocator<U, Alignment>&) {
+  }
+
+  T* allocate(size_t n) {
+    if (n == 0)
+      return nullptr;
+    void* ptr = nullptr;
+#ifdef _MSC_VER
+    ptr = _aligned_malloc(n * sizeof(T), Alignment);
+#else
+    if (posix_memalign(&ptr, Alignment, n * sizeof(T)) != 0)
+      ptr = nullptr;
+#endif
+    if (ptr == nullptr)
+      throw std::bad_alloc();
+    return static_cast<T*>(ptr);
+  }
+
+  void deallocate(T* ptr, size_t) {
+#ifdef _MSC_VER
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+  }
+};
+
+template <class T, class U, size_t Alignment>
+bool operator==(const AlignedAllocator<T, Alignment>&,
+                const AlignedAllocator<U, Alignment>&) {
+  return true;
+}
+template <class T, class U, size_t Alignment>
+bool operator!=(const AlignedAllocator<T, Alignment>&,
+                const AlignedAllocator<U, Alignment>&) {
+  return false;
+}
+}  // namespace GLOO
+
+#endif
@@ -63,8 +63,8 @@ namespace GLOO {
 
 		}
 		for (int i = 0; i < num_steps; i++) {
-			state_ = integrator_->Integrate(system_, state_, time_, dt);
-			state_2_ = integrator_2_->Integrate(system_, state_2_, time_, dt);
+			integrator_->Step(system_, state_, time_, dt);
+			integrator_2_->Step(system_, state_2_, time_, dt);
 			//std::cout << "New Pos: " << state_.positions[0].x << " " << state_.positions[0].y << " " << state_.positions[0].z << " " << std::endl;
 
 			time_ += dt;
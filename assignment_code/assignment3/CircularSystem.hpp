@@ -9,7 +9,8 @@ namespace GLOO {
     public:
         // Constructor
         CircularSystem();
-        ParticleState ComputeTimeDerivative(const ParticleState& state, float time) const override;
+        using ParticleSystemBase::ComputeTimeDerivative;
+        void ComputeTimeDerivative(const ParticleState& state, float time, ParticleState& out) const override;
     private:
         
     };
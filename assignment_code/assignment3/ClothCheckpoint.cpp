@@ -0,0 +1,111 @@
+#include "ClothCheckpoint.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace GLOO {
+namespace {
+const char kMagic[8] = {'G', 'L', 'O', 'O', 'C', 'L', 'T', 'H'};
+const uint64_t kAlignment = 8;
+
+uint64_t Align(uint64_t offset) {
+  return (offset + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+// Places an array of count elements of T at the next aligned offset and
+// returns where it starts.
+template <class T>
+uint64_t Place(uint64_t& end, uint64_t count) {
+  uint64_t offset = Align(end);
+  end = offset + count * sizeof(T);
+  return offset;
+}
+
+template <class T>
+void WriteArray(std::ofstream& fs, uint64_t offset, const std::vector<T>& values) {
+  static const char zeros[kAlignment] = {};
+  fs.write(zeros, std::streamsize(offset - uint64_t(fs.tellp())));
+  fs.write(reinterpret_cast<const char*>(values.data()),
+           std::streamsize(values.size() * sizeof(T)));
+}
+
+bool ArrayFits(uint64_t offset, uint64_t count, size_t element_size,
+               uint64_t file_size) {
+  return offset % kAlignment == 0 && offset <= file_size &&
+         count <= (file_size - offset) / element_size;
+}
+}  // namespace
+
+void WriteClothCheckpoint(const std::string& file_path,
+                          ClothCheckpointHeader header,
+                          const std::vector<glm::vec3>& positions,
+                          const std::vector<glm::vec3>& velocities,
+                          const std::vector<float>& masses,
+                          const std::vector<uint8_t>& fixed,
+                          const std::vector<Spring>& springs) {
+  uint64_t particle_count = header.particle_count;
+  if (positions.size() != particle_count ||
+      velocities.size() != particle_count || masses.size() != particle_count ||
+      fixed.size() != particle_count ||
+      springs.size() != header.spring_count) {
+    throw std::runtime_error("Checkpoint arrays do not match the header!");
+  }
+
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kClothCheckpointVersion;
+  header.padding = 0;
+  uint64_t end = sizeof(ClothCheckpointHeader);
+  header.positions_offset = Place<glm::vec3>(end, particle_count);
+  header.velocities_offset = Place<glm::vec3>(end, particle_count);
+  header.masses_offset = Place<float>(end, particle_count);
+  header.fixed_offset = Place<uint8_t>(end, particle_count);
+  header.springs_offset = Place<Spring>(end, header.spring_count);
+  header.file_size = end;
+
+  std::ofstream fs(file_path, std::ios::binary | std::ios::trunc);
+  if (!fs) {
+    throw std::runtime_error("Unable to create checkpoint " + file_path + "!");
+  }
+  fs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  WriteArray(fs, header.positions_offset, positions);
+  WriteArray(fs, header.velocities_offset, velocities);
+  WriteArray(fs, header.masses_offset, masses);
+  WriteArray(fs, header.fixed_offset, fixed);
+  WriteArray(fs, header.springs_offset, springs);
+  if (!fs.flush()) {
+    throw std::runtime_error("Unable to write checkpoint " + file_path + "!");
+  }
+}
+
+ClothCheckpoint::ClothCheckpoint(const std::string& file_path)
+    : file_path_(file_path), file_(file_path), header_(nullptr) {
+  if (file_.GetSize() < sizeof(ClothCheckpointHeader)) {
+    throw std::runtime_error(file_path + " is too short for a checkpoint!");
+  }
+  header_ = reinterpret_cast<const ClothCheckpointHeader*>(file_.GetData());
+  if (std::memcmp(header_->magic, kMagic, sizeof(kMagic)) != 0) {
+    throw std::runtime_error(file_path + " is not a cloth checkpoint!");
+  }
+  if (header_->version != kClothCheckpointVersion) {
+    throw std::runtime_error(file_path + " has unsupported checkpoint version " +
+                             std::to_string(header_->version) + "!");
+  }
+
+  uint64_t file_size = file_.GetSize();
+  uint64_t particle_count = header_->particle_count;
+  if (header_->file_size != file_size ||
+      !ArrayFits(header_->positions_offset, particle_count, sizeof(glm::vec3),
+                 file_size) ||
+      !ArrayFits(header_->velocities_offset, particle_count, sizeof(glm::vec3),
+                 file_size) ||
+      !ArrayFits(header_->masses_offset, particle_count, sizeof(float),
+                 file_size) ||
+      !ArrayFits(header_->fixed_offset, particle_count, sizeof(uint8_t),
+                 file_size) ||
+      !ArrayFits(header_->springs_offset, header_->spring_count, sizeof(Spring),
+                 file_size)) {
+    throw std::runtime_error(file_path + " is truncated or corrupt!");
+  }
+}
+}  // namespace GLOO
@@ -0,0 +1,109 @@
+#ifndef CLOTH_CHECKPOINT_H_
+#define CLOTH_CHECKPOINT_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "MappedFile.hpp"
+#include "Spring.hpp"
+
+namespace GLOO {
+// Version 1 of the cloth checkpoint format: this header, followed by the
+// arrays at the offsets it gives, each 8-byte aligned. Values are stored in
+// the writing machine's byte order; a checkpoint from a machine of the other
+// order fails the version check. Bump kClothCheckpointVersion whenever the
+// layout changes.
+const uint32_t kClothCheckpointVersion = 1;
+
+struct ClothCheckpointHeader {
+  // "GLOOCLTH", unterminated.
+  char magic[8];
+  uint32_t version;
+  uint32_t particle_count;
+  uint32_t spring_count;
+  int32_t cloth_size;
+  // Pins still holding, as counted by ClothSimulation::TogglePins.
+  int32_t pinned;
+  uint32_t wind_on;
+  double time;
+  float rollover_time;
+  float gravity[3];
+  float wind_strength;
+  uint32_t ball_collision;
+  float ball_start_position[3];
+  float ball_position[3];
+  float ball_radius;
+  uint32_t padding;
+
+  // glm::vec3[particle_count] each.
+  uint64_t positions_offset;
+  uint64_t velocities_offset;
+  // float[particle_count].
+  uint64_t masses_offset;
+  // uint8_t[particle_count], 1 for fixed particles.
+  uint64_t fixed_offset;
+  // Spring[spring_count].
+  uint64_t springs_offset;
+  uint64_t file_size;
+};
+static_assert(sizeof(ClothCheckpointHeader) == 144,
+              "ClothCheckpointHeader must not gain padding.");
+static_assert(sizeof(Spring) == 16, "Checkpoints store Spring as is.");
+
+// Writes a checkpoint. The header's counts and scalars must be filled in;
+// its magic, version and offsets are set here. Throws std::runtime_error if
+// the file cannot be written.
+void WriteClothCheckpoint(const std::string& file_path,
+                          ClothCheckpointHeader header,
+                          const std::vector<glm::vec3>& positions,
+                          const std::vector<glm::vec3>& velocities,
+                          const std::vector<float>& masses,
+                          const std::vector<uint8_t>& fixed,
+                          const std::vector<Spring>& springs);
+
+// A checkpoint file mapped into memory and checked against the format. The
+// arrays point straight into the mapping, so nothing is read or copied
+// until it is used, and they stay valid for the checkpoint's lifetime.
+class ClothCheckpoint {
+ public:
+  // Throws std::runtime_error for files that are not valid checkpoints.
+  explicit ClothCheckpoint(const std::string& file_path);
+
+  const ClothCheckpointHeader& GetHeader() const {
+    return *header_;
+  }
+  const glm::vec3* GetPositions() const {
+    return GetArray<glm::vec3>(header_->positions_offset);
+  }
+  const glm::vec3* GetVelocities() const {
+    return GetArray<glm::vec3>(header_->velocities_offset);
+  }
+  const float* GetMasses() const {
+    return GetArray<float>(header_->masses_offset);
+  }
+  const uint8_t* GetFixed() const {
+    return GetArray<uint8_t>(header_->fixed_offset);
+  }
+  const Spring* GetSprings() const {
+    return GetArray<Spring>(header_->springs_offset);
+  }
+  const std::string& GetPath() const {
+    return file_path_;
+  }
+
+ private:
+  template <class T>
+  const T* GetArray(uint64_t offset) const {
+    return reinterpret_cast<const T*>(file_.GetData() + offset);
+  }
+
+  std::string file_path_;
+  MappedFile file_;
+  const ClothCheckpointHeader* header_;
+};
+}  // namespace GLOO
+
+#endif
@@ -7,127 +7,85 @@
 
 #include "gloo/debug/PrimitiveFactory.hpp"
 #include "gloo/shaders/PhongShader.hpp"
-#include "IntegratorFactory.hpp"
 #include "gloo/shaders/SimpleShader.hpp"
 #include "gloo/InputManager.hpp"
 #include "gloo/shaders/CheckerShader.hpp"
+#include "gloo/debug/Profiler.hpp"
+#include "SimulationClock.hpp"
+#include "ClothCheckpoint.hpp"
 
 #include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
 
 namespace GLOO {
-	ClothNode::ClothNode(float integration_step, IntegratorType integrator_type, Raycaster* raycaster) : SceneNode() {
+	ClothNode::ClothNode(float integration_step, IntegratorType integrator_type, const ClothParameters& parameters, Raycaster* raycaster, SimulationThread& simulation_thread)
+		: SceneNode(), simulation_(integrator_type, integration_step, parameters), simulation_thread_(simulation_thread) {
 		// Constructor
 		raycaster_ = raycaster;
-		time_ = 0.0f;
-		integration_step_ = integration_step;
-		integrator_type_ = integrator_type;
-		rollover_time_ = 0.0f;
-		integrator_ = IntegratorFactory::CreateIntegrator<PendulumSystem, ParticleState>(integrator_type);
 		wireframe_on_ = false;
 		normals_on_ = false;
 		pause_on_ = false;
-		wind_on_ = false;
-		ball_collision_ = true;
-		pinned_ = 2;
-		ball_start_pos_ = glm::vec3(3.f, -8.f, 7.5f);
-
-		// ---- Cloth Properties ----
-		cloth_size_ = 12;
-		cloth_width_ = 10.0f;
-		// --------------------------
-
-		// ---- Spring Properties ----
-		float structural_rest_length = cloth_width_/float(cloth_size_);
-		float shear_rest_length = sqrt(2) * cloth_width_ / float(cloth_size_);
-		float flex_rest_length = 2 * cloth_width_ / float(cloth_size_);
-
-		float stiffness = 150.f;
-		float mass = .075f;
-		glm::vec3 start_pos = glm::vec3(0.f, 0.f, 0.f);
-		// -------------------------
-
-		float z_start = 0.f;
-		for (int i = 0; i < cloth_size_; i++) {
-			for (int j = 0; j < cloth_size_; j++) {
-				glm::vec3 new_pos(start_pos[0] + i * cloth_width_ / float(cloth_size_), 
-								  start_pos[1] - j * cloth_width_ / float(cloth_size_), 
-					              0.f);
-								  //j*.5f);
-				//std::cout << "New pos: " << new_pos.x << " " << new_pos.y << " " << new_pos.z << std::endl;
-				initial_positions_.push_back(new_pos);
-			}
-		}
-		state_.positions = initial_positions_;
-		std::vector<float> masses;
-
-		for (int i = 0; i < state_.positions.size(); i++) {
-			state_.velocities.push_back(glm::vec3(0.f, 0.f, 0.f));
-			masses.push_back(mass);
-		}
+		simulation_paused_ = false;
+		ball_on_ = simulation_.GetBallState();
+		wind_on_ = simulation_.GetWindState();
+		wind_strength_ = simulation_.GetWindStrength();
+		gravity_ = simulation_.GetGravity();
+		settings_generation_ = 0;
+		seen_settings_generation_ = 0;
+		simulation_playing_back_ = false;
+		playback_time_ = 0.0;
+		playback_paused_ = false;
+		shown_frame_ = std::numeric_limits<uint64_t>::max();
+		cloth_size_ = simulation_.GetClothSize();
+		cloth_width_ = simulation_.GetClothWidth();
+
+		// The simulation thread has not started yet, so the initial state can be read directly
+		ForgetPreviousTick();
+		ClothSnapshot initial_snapshot;
+		WriteSnapshot(initial_snapshot, 1.0f);
+		snapshots_.Reset(initial_snapshot);
+		positions_ = initial_snapshot.positions;
+		simulation_thread_.AddTask([this](int tick_count, double tick_seconds, float alpha) {
+			AdvanceSimulation(tick_count, tick_seconds, alpha);
+		});
+		const std::vector<glm::vec3>& positions = GetPositions();
 
 		shader_ = std::make_shared<PhongShader>();
 		sphere_mesh_ = PrimitiveFactory::CreateSphere(0.1f, 25, 25);
 
-		// Create one sphere for each particle and initialize particles in system
-		for (int i = 0; i < state_.positions.size(); i++) {
-			auto sphere_node = make_unique<SceneNode>();
-			sphere_node->CreateComponent<ShadingComponent>(shader_);
-			sphere_node->CreateComponent<RenderingComponent>(sphere_mesh_);
-			sphere_node->GetTransform().SetPosition(state_.positions[i]);
-			sphere_ptrs_.push_back(sphere_node.get());
-			AddChild(std::move(sphere_node));
-			sphere_ptrs_[i]->SetActive(false);
-
-			system_.AddParticle(masses[i]);
-		}
-		for (int col = 0; col < cloth_size_; col++) {
-			for (int row = 0; row < cloth_size_; row++) {
-
-				// ---- Structural Springs ----
-				if (col < cloth_size_ - 1) {
-					CreateSpring(IndexOf(row, col), IndexOf(row, col + 1), structural_rest_length, stiffness, true);
-				}
-				if (row < cloth_size_ - 1) {
-					CreateSpring(IndexOf(row, col), IndexOf(row+1, col), structural_rest_length, stiffness, true);
-				}
-				// ---- Shear Springs ----
-				float shear_scalar = 1.f;
-				if (col < cloth_size_ - 1 && row < cloth_size_ - 1) {
-					CreateSpring(IndexOf(row, col), IndexOf(row + 1, col + 1), shear_rest_length * shear_scalar, stiffness, false);
-				}
-				if (row > 0 && col < cloth_size_ - 1) {
-					CreateSpring(IndexOf(row, col), IndexOf(row - 1, col + 1), shear_rest_length * shear_scalar, stiffness, false);
-				}
-				// ---- Flex Springs ----
-				float flex_scalar = 1.3f;
-				if (col < cloth_size_ - 2) {
-					CreateSpring(IndexOf(row, col), IndexOf(row, col + 2), flex_rest_length, stiffness * flex_scalar, false);
-				}
-				if (row  < cloth_size_ - 2) {
-					CreateSpring(IndexOf(row, col), IndexOf(row + 2, col), flex_rest_length, stiffness * flex_scalar, false);
-				}
+		// Create one sphere for each particle, unless there are too many for a node each;
+		// the wireframe then shows the springs alone
+		if (int(positions.size()) <= kMaxParticleSpheres) {
+			for (int i = 0; i < positions.size(); i++) {
+				auto sphere_node = make_unique<SceneNode>();
+				sphere_node->CreateComponent<ShadingComponent>(shader_);
+				sphere_node->CreateComponent<RenderingComponent>(sphere_mesh_);
+				sphere_node->GetTransform().SetPosition(positions[i]);
+				sphere_ptrs_.push_back(sphere_node.get());
+				AddChild(std::move(sphere_node));
+				sphere_ptrs_[i]->SetActive(false);
 			}
-
 		}
-		// Pin top left and top right particles
-		FixCorners();
-		
-
-		system_.PopulateSpringData();
+		// Visualize the structural springs as lines
+		CreateSpringLines();
 
 		// Create intersection ball
 		auto ball_node = make_unique<SceneNode>();
 		ball_node->CreateComponent<ShadingComponent>(shader_);
-		ball_radius_ = 2.f;
-		ball_node->CreateComponent<RenderingComponent>(PrimitiveFactory::CreateSphere(ball_radius_, 25, 25));
+		ball_mesh_radius_ = simulation_.GetBallRadius();
+		ball_node->CreateComponent<RenderingComponent>(PrimitiveFactory::CreateSphere(ball_mesh_radius_, 25, 25));
 		glm::vec3 ball_color(.3f, 0.3f, 0.9f);
 		ball_node->CreateComponent<MaterialComponent>(
 			std::make_shared<Material>(Material::GetDefault()));
 		ball_node->GetComponentPtr<MaterialComponent>()->GetMaterial().SetDiffuseColor(ball_color);
 		ball_node->GetComponentPtr<MaterialComponent>()->GetMaterial().SetAmbientColor(ball_color);
-		ball_node->GetTransform().SetPosition(ball_start_pos_);
+		ball_node->GetTransform().SetPosition(initial_snapshot.ball_position);
 		ball_ptr_ = ball_node.get();
 		AddChild(std::move(ball_node));
+		ball_ptr_->SetActive(ball_on_);
 
 		// Create ray collision mesh
 		auto collision_node = make_unique<SceneNode>();
@@ -208,7 +166,7 @@ namespace GLOO {
 			int current_vertex_hit_ = CheckVertexCollision(ray_data);
 			if (current_vertex_hit_ != -1) {
 				collision_ptr_->SetActive(true);
-				collision_ptr_->GetTransform().SetPosition(state_.positions[current_vertex_hit_]);
+				collision_ptr_->GetTransform().SetPosition(GetPositions()[current_vertex_hit_]);
 			}
 			else {
 				collision_ptr_->SetActive(false);
@@ -217,7 +175,7 @@ namespace GLOO {
 		else {
 			if (current_vertex_hit_ != -1) {
 				//::cout << "Current vertex" << current_vertex_hit_ << std::endl;
-				collision_ptr_->GetTransform().SetPosition(state_.positions[current_vertex_hit_]);
+				collision_ptr_->GetTransform().SetPosition(GetPositions()[current_vertex_hit_]);
 				DragCloth(InputManager::GetInstance().GetCursorPosition());
 			}
 		}
@@ -289,70 +247,26 @@ namespace GLOO {
 			
 		}
 
-		if (!pause_on_) {
-			float dist = 8.5f;
-			float z = dist * cos(.75f * time_) - dist;
-			ball_ptr_->GetTransform().SetPosition(ball_start_pos_ + glm::vec3(0.f, 0.f, z));
-
-			rollover_time_ += delta_time;
-			float dt = 0.0f;
-			int num_steps = 0;
-			if (float(delta_time) < integration_step_) {
-				dt = float(delta_time);
-				num_steps = 1;
-				rollover_time_ = 0.0f;
-			}
-			else {
-				dt = integration_step_;
-				num_steps = int(rollover_time_ / dt);
-				rollover_time_ -= dt * num_steps;
-			}
-			for (int i = 0; i < num_steps; i++) {
-				state_ = integrator_->Integrate(system_, state_, time_, dt);
-
-				if (ball_collision_) {
-					glm::vec3 ball_pos = ball_ptr_->GetTransform().GetPosition();
-					float eps = .12f;
-					for (int j = 0; j < state_.positions.size(); j++) {
-
-						glm::vec3 diff = state_.positions[j] - ball_pos;
-						float distance = glm::length(diff);
-						// Checks collision
-						if (distance < ball_radius_ + eps) {
-							//std::cout << "Found collision" << std::endl;
-							glm::vec3 direction = glm::normalize(diff);
-							glm::vec3 new_pos = ball_pos + direction * (ball_radius_ + eps);
-							glm::vec3 delta_pos = new_pos - state_.positions[j];
-							state_.positions[j] = new_pos;
-							state_.velocities[j] += delta_pos / dt;
-
-						}
-					}
-				}
-				if (pinned_ < 3) {
-					float eps = .05f;
-					for (int j = 0; j < state_.positions.size(); j++) {
-						float height = state_.positions[j].y;
-						// Checks collision
-						if (height < ground_height_ + eps) {
-							//std::cout << "Found collision" << std::endl;
-							glm::vec3 direction = glm::vec3(0.f, 1.f, 0.f);
-							glm::vec3 new_pos = glm::vec3(state_.positions[j].x, ground_height_ + eps, state_.positions[j].z);
-							glm::vec3 delta_pos = state_.positions[j]-new_pos;
-							state_.positions[j] = new_pos;
-							state_.velocities[j] = delta_pos / dt;
-
-						}
-					}
-				}
-				time_ += dt;
+		if (player_ != nullptr) {
+			UpdatePlayback(delta_time);
+		}
+		// The simulation thread publishes a snapshot after each pass; meshes only change with a new one
+		else if (snapshots_.Update()) {
+			ScopedTimer update_timer("ClothNode::Update");
+			const ClothSnapshot& snapshot = snapshots_.GetReadBuffer();
+			InterpolatePositions(snapshot.previous_positions, snapshot.positions, snapshot.alpha, positions_);
+			ball_ptr_->GetTransform().SetPosition(glm::mix(snapshot.previous_ball_position, snapshot.ball_position, snapshot.alpha));
+			if (snapshot.settings_generation != seen_settings_generation_) {
+				// A checkpoint brought its own settings; show them in place of the requested ones
+				seen_settings_generation_ = snapshot.settings_generation;
+				ball_on_ = snapshot.ball_on;
+				ball_ptr_->SetActive(ball_on_);
+				ball_ptr_->GetTransform().SetScale(glm::vec3(snapshot.ball_radius / ball_mesh_radius_));
+				wind_on_ = snapshot.wind_on;
+				wind_strength_ = snapshot.wind_strength;
+				gravity_ = snapshot.gravity;
 			}
-			if (wireframe_on_) {
-				DrawWireframe();
-			}
-			DrawClothPositions();
-			UpdateClothNormals();
-			UpdateClothTangents();
+			UpdateMeshes();
 		}
 		
 	}
@@ -362,9 +276,9 @@ namespace GLOO {
 		float delta = 40.0f;
 
 		if (distance.x != 0.f || distance.y != 0.f) {
-			glm::vec3 prev_pos = state_.positions[current_vertex_hit_];
-			state_.positions[current_vertex_hit_] = prev_pos + distance / delta;
-			state_.velocities[current_vertex_hit_] += (state_.positions[current_vertex_hit_] - prev_pos);
+			int index = current_vertex_hit_;
+			glm::vec3 offset = distance / delta;
+			simulation_thread_.PostCommand([this, index, offset]() { simulation_.DisplaceParticle(index, offset); });
 			start_click_pos_ = glm::dvec2(pos.x, pos.y);
 		}
 
@@ -377,8 +291,10 @@ namespace GLOO {
 		std::vector<glm::vec3> centers_hit;
 		std::vector<int> vert_indices;
 		int vert_index = 0;
-		for (glm::vec3 center : state_.positions) {
-			float dist = CheckSphereCollision(data[1], data[0], center, cloth_width_/cloth_size_);
+		// Particles are in the node's space, which is only translated from the world
+		glm::vec3 camera_pos = data[0] - GetTransform().GetWorldPosition();
+		for (glm::vec3 center : GetPositions()) {
+			float dist = CheckSphereCollision(data[1], camera_pos, center, cloth_width_/cloth_size_);
 			if (dist >= 0) {
 				collision_found = true;
 				hit_distances.push_back(dist);
@@ -424,83 +340,280 @@ namespace GLOO {
 
 
 	int ClothNode::IndexOf(int row, int col) {
-		if (row >= cloth_size_ || row < 0 || col >= cloth_size_ || col < 0) return -1;
-		int index = row + col * cloth_size_;
-		return index;
-	}
-
-	void ClothNode::CreateSpring(int start, int end, float rest_length, float stiffness, bool render) {
-		system_.AddSpring(start, end, rest_length, stiffness);
-
-		// Create a line between particles to visualize springs
-		if (render) {
-			auto line = std::make_shared<VertexObject>();
-			auto line_shader = std::make_shared<SimpleShader>();
-			auto indices = IndexArray({ 0,1 });
-			line->UpdateIndices(make_unique<IndexArray>(indices));
-			auto positions = PositionArray({ state_.positions[start] , state_.positions[end] });
-			line->UpdatePositions(make_unique<PositionArray>(positions));
-
-			auto line_node = make_unique<SceneNode>();
-			line_node->CreateComponent<ShadingComponent>(line_shader);
-			auto& rc_line = line_node->CreateComponent<RenderingComponent>(line);
-			rc_line.SetDrawMode(DrawMode::Lines);
-			auto color = glm::vec3(1.f, 0.f, 0.f);
-			auto material = std::make_shared<Material>(color, color, color, 0.0f);
-			line_node->CreateComponent<MaterialComponent>(material);
-			line_ptrs_.push_back(line_node.get());
-			line_indices_.push_back(start);
-			line_indices_.push_back(end);
-			AddChild(std::move(line_node));
-			line_ptrs_.back()->SetActive(false);
+		return simulation_.IndexOf(row, col);
+	}
 
-			
+	void ClothNode::CreateSpringLines() {
+		// One line mesh over the particle positions with a line for each structural spring
+		spring_lines_ = std::make_shared<VertexObject>();
+		auto indices = make_unique<IndexArray>();
+		for (const std::pair<int, int>& spring : simulation_.GetStructuralSprings()) {
+			indices->push_back(spring.first);
+			indices->push_back(spring.second);
 		}
-		
+		spring_lines_->UpdateIndices(std::move(indices));
+		spring_lines_->UpdatePositions(make_unique<PositionArray>(GetPositions()));
+		spring_lines_node_ = CreateLineNode(spring_lines_, glm::vec3(1.f, 0.f, 0.f));
+	}
+
+	SceneNode* ClothNode::CreateLineNode(std::shared_ptr<VertexObject> lines, glm::vec3 color) {
+		auto line_node = make_unique<SceneNode>();
+		line_node->CreateComponent<ShadingComponent>(std::make_shared<SimpleShader>());
+		auto& rc_line = line_node->CreateComponent<RenderingComponent>(lines);
+		rc_line.SetDrawMode(DrawMode::Lines);
+		auto material = std::make_shared<Material>(color, color, color, 0.0f);
+		line_node->CreateComponent<MaterialComponent>(material);
+		SceneNode* line_ptr = line_node.get();
+		AddChild(std::move(line_node));
+		line_ptr->SetActive(false);
+		return line_ptr;
+	}
+
+	std::shared_ptr<VertexObject> ClothNode::CreateVectorLines() {
+		// Two vertices per particle, filled in while the lines are shown
+		auto lines = std::make_shared<VertexObject>();
+		size_t count = 2 * GetPositions().size();
+		auto indices = make_unique<IndexArray>(count);
+		for (size_t i = 0; i < count; i++) {
+			(*indices)[i] = unsigned(i);
+		}
+		lines->UpdateIndices(std::move(indices));
+		lines->UpdatePositions(make_unique<PositionArray>(count, glm::vec3(0.f)));
+		return lines;
+	}
+
+	void ClothNode::UpdateVectorLines(VertexObject& lines, const std::vector<glm::vec3>& vectors) {
+		const std::vector<glm::vec3>& particles = GetPositions();
+		float vector_size = .5f;
+		auto positions = make_unique<PositionArray>(2 * particles.size());
+		for (size_t i = 0; i < particles.size(); i++) {
+			(*positions)[2 * i] = particles[i];
+			(*positions)[2 * i + 1] = particles[i] + vectors[i] * vector_size;
+		}
+		lines.UpdatePositions(std::move(positions));
+	}
+
+	void ClothNode::UpdateMeshes() {
+		if (wireframe_on_) {
+			ScopedTimer timer("DrawWireframe");
+			DrawWireframe();
+		}
+		{
+			ScopedTimer timer("DrawClothPositions");
+			DrawClothPositions();
+		}
+		{
+			ScopedTimer timer("UpdateClothNormals");
+			UpdateClothNormals();
+		}
+		{
+			ScopedTimer timer("UpdateClothTangents");
+			UpdateClothTangents();
+		}
+	}
+
+	void ClothNode::AdvanceSimulation(int tick_count, double tick_seconds, float alpha) {
+		ScopedTimer timer("Cloth");
+		if (simulation_playing_back_) {
+			// Nothing to step or publish; the node shows the trajectory instead
+			return;
+		}
+		if (simulation_paused_) {
+			// Show commands such as drags right away instead of blending towards them
+			ForgetPreviousTick();
+		}
+		else {
+			for (int i = 0; i < tick_count; i++) {
+				if (i == tick_count - 1) {
+					ForgetPreviousTick();
+				}
+				simulation_.Advance(tick_seconds);
+				if (recorder_ != nullptr) {
+					recorder_->RecordFrame(simulation_.GetTime(), simulation_.GetState().positions);
+				}
+			}
+		}
+		WriteSnapshot(snapshots_.GetWriteBuffer(), alpha);
+		snapshots_.Publish();
+	}
+
+	void ClothNode::WriteSnapshot(ClothSnapshot& snapshot, float alpha) const {
+		// Assigning into the old snapshot reuses its storage
+		snapshot.previous_positions = previous_positions_;
+		snapshot.positions = simulation_.GetState().positions;
+		snapshot.previous_ball_position = previous_ball_position_;
+		snapshot.ball_position = simulation_.GetBallPosition();
+		snapshot.alpha = alpha;
+		snapshot.settings_generation = settings_generation_;
+		snapshot.ball_on = simulation_.GetBallState();
+		snapshot.ball_radius = simulation_.GetBallRadius();
+		snapshot.wind_on = simulation_.GetWindState();
+		snapshot.wind_strength = simulation_.GetWindStrength();
+		snapshot.gravity = simulation_.GetGravity();
+		const AdaptiveStepStats* stats = simulation_.GetAdaptiveStats();
+		snapshot.adaptive = stats != nullptr;
+		if (stats != nullptr) {
+			snapshot.adaptive_stats = *stats;
+		}
+	}
+
+	void ClothNode::ForgetPreviousTick() {
+		previous_positions_ = simulation_.GetState().positions;
+		previous_ball_position_ = simulation_.GetBallPosition();
 	}
 
 	void ClothNode::ResetSystem() {
-		time_ = 0.0f;
-		rollover_time_ = 0.0f;
-		state_.positions = initial_positions_;
-		state_.velocities.clear();
-		for (int i = 0; i < state_.positions.size(); i++) {
-			state_.velocities.push_back(glm::vec3(0.f, 0.f, 0.f));
+		if (player_ != nullptr) {
+			SeekPlayback(player_->GetStartTime());
+			return;
+		}
+		simulation_thread_.PostCommand([this]() {
+			simulation_.Reset();
+			ForgetPreviousTick();
+			// Resets may go back to a checkpoint, settings included
+			settings_generation_++;
+		});
+	}
+
+	void ClothNode::SaveCheckpoint(const std::string& file_path) {
+		simulation_thread_.PostCommand([this, file_path]() {
+			try {
+				simulation_.SaveCheckpoint(file_path);
+				std::cout << "Saved checkpoint " << file_path << std::endl;
+			}
+			catch (const std::runtime_error& error) {
+				std::cerr << error.what() << std::endl;
+			}
+		});
+	}
+
+	void ClothNode::LoadCheckpoint(const std::string& file_path) {
+		simulation_thread_.PostCommand([this, file_path]() {
+			try {
+				ClothCheckpoint checkpoint(file_path);
+				simulation_.LoadCheckpoint(checkpoint);
+			}
+			catch (const std::runtime_error& error) {
+				std::cerr << error.what() << std::endl;
+				return;
+			}
+			ForgetPreviousTick();
+			settings_generation_++;
+		});
+	}
+
+	void ClothNode::StartRecording(const std::string& file_path) {
+		simulation_thread_.PostCommand([this, file_path]() {
+			try {
+				std::pair<glm::vec3, glm::vec3> bounds = simulation_.GetBounds();
+				// Finish the previous recording, if any, before the new one starts
+				recorder_.reset();
+				recorder_ = make_unique<TrajectoryRecorder>(file_path, simulation_.GetState().positions.size(), bounds.first, bounds.second);
+				std::cout << "Recording trajectory " << file_path << std::endl;
+			}
+			catch (const std::runtime_error& error) {
+				std::cerr << error.what() << std::endl;
+			}
+		});
+	}
+
+	void ClothNode::SetStateHashInterval(int interval) {
+		simulation_thread_.PostCommand([this, interval]() {
+			simulation_.SetStateHashing(interval, [](long step, double time, uint64_t hash) {
+				printf("Cloth state hash at step %ld (%.6f s): %016llx\n", step, time, (unsigned long long)hash);
+			});
+		});
+	}
+
+	void ClothNode::StartPlayback(const std::string& file_path) {
+		std::unique_ptr<TrajectoryPlayer> player = make_unique<TrajectoryPlayer>(file_path);
+		if (player->GetParticleCount() != positions_.size()) {
+			throw std::runtime_error(file_path + " has " + std::to_string(player->GetParticleCount()) +
+				" particles but the cloth has " + std::to_string(positions_.size()) + "!");
+		}
+		player_ = std::move(player);
+		simulation_thread_.PostCommand([this]() { simulation_playing_back_ = true; });
+		// The ball's motion is not recorded
+		ball_on_ = false;
+		ball_ptr_->SetActive(false);
+		SeekPlayback(player_->GetStartTime());
+	}
+
+	void ClothNode::SeekPlayback(double time) {
+		playback_time_ = glm::clamp(time, player_->GetStartTime(), player_->GetEndTime());
+	}
+
+	void ClothNode::UpdatePlayback(double delta_time) {
+		if (!playback_paused_) {
+			SeekPlayback(playback_time_ + delta_time);
+		}
+		uint64_t frame = player_->FindFrame(playback_time_);
+		if (frame == shown_frame_) {
+			return;
 		}
+		// Until the decoder catches up, e.g. right after a seek, the last frame stays up
+		if (player_->GetFrame(frame, positions_)) {
+			ScopedTimer update_timer("ClothNode::UpdatePlayback");
+			shown_frame_ = frame;
+			UpdateMeshes();
+		}
+	}
 
-		ball_ptr_->GetTransform().SetPosition(ball_start_pos_);
+	void ClothNode::ToggleWind() {
+		wind_on_ = !wind_on_;
+		simulation_thread_.PostCommand([this]() { simulation_.ToggleWind(); });
+	}
+
+	void ClothNode::SetGravity(float amountx, float amounty, float amountz) {
+		// The GUI sets the gravity every frame; only post actual changes
+		glm::vec3 gravity(amountx, amounty, amountz);
+		if (gravity != gravity_) {
+			gravity_ = gravity;
+			simulation_thread_.PostCommand([this, gravity]() { simulation_.SetGravity(gravity); });
+		}
+	}
+
+	void ClothNode::SetThreadCount(int thread_count) {
+		simulation_thread_.PostCommand([this, thread_count]() { simulation_.SetThreadCount(thread_count); });
+	}
+
+	void ClothNode::SetWindStrength(float value) {
+		if (value != wind_strength_) {
+			wind_strength_ = value;
+			simulation_thread_.PostCommand([this, value]() { simulation_.SetWindStrength(value); });
+		}
+	}
+
+	void ClothNode::TogglePins() {
+		simulation_thread_.PostCommand([this]() { simulation_.TogglePins(); });
 	}
 
 	void ClothNode::DrawWireframe() {
+		const std::vector<glm::vec3>& positions = GetPositions();
 		for (int i = 0; i < sphere_ptrs_.size(); i++) {
-			sphere_ptrs_[i]->GetTransform().SetPosition(state_.positions[i]);
-		}
-		for (int line_index = 0; line_index < line_ptrs_.size(); line_index++) {
-			if (line_ptrs_[line_index]->IsActive()) {
-				auto positions = make_unique<PositionArray>();
-				positions->push_back(state_.positions[line_indices_[line_index * 2]]);
-				positions->push_back(state_.positions[line_indices_[(line_index * 2) + 1]]);
-				line_ptrs_[line_index]->GetComponentPtr<RenderingComponent>()->GetVertexObjectPtr()->UpdatePositions(std::move(positions));
-			}
-
+			sphere_ptrs_[i]->GetTransform().SetPosition(positions[i]);
+		}
+		if (spring_lines_node_->IsActive()) {
+			spring_lines_->UpdatePositions(make_unique<PositionArray>(positions));
 		}
 	}
 
 	void ClothNode::DrawClothPositions() {
+		const std::vector<glm::vec3>& particles = GetPositions();
 		auto positions = make_unique<PositionArray>();
 
 		for (int col = 0; col < cloth_size_; col++) {
 			for (int row = 0; row < cloth_size_; row++) {
 				int i = IndexOf(row, col);
-				positions->push_back(state_.positions[i]);
+				positions->push_back(particles[i]);
 			}
 		}
 		cloth_mesh_->UpdatePositions(std::move(positions));
 	}
 
 	void ClothNode::UpdateClothNormals() {
-		auto indices = cloth_mesh_->GetIndices();
-		auto positions = cloth_mesh_->GetPositions();
+		const IndexArray& indices = cloth_mesh_->GetIndices();
+		const PositionArray& positions = cloth_mesh_->GetPositions();
 		auto new_normals = make_unique<NormalArray>();
 		for (int position_index = 0; position_index < positions.size(); position_index++) {
 			glm::vec3 vertex_norm = glm::vec3(0.0f);
@@ -517,27 +630,16 @@ namespace GLOO {
 		}
 		cloth_mesh_->UpdateNormals(std::move(new_normals));
 
-		auto normals = cloth_mesh_->GetNormals();
-		float normal_size = .5f;
-
 		if (normals_on_) {
-			for (int normal_index = 0; normal_index < normals_ptrs_.size(); normal_index++) {
-				
-				auto positions = make_unique<PositionArray>();
-				positions->push_back(state_.positions[normal_index]);
-				positions->push_back((state_.positions[normal_index] + normals[normal_index] * normal_size));
-				normals_ptrs_[normal_index]->GetComponentPtr<RenderingComponent>()->GetVertexObjectPtr()->UpdatePositions(std::move(positions));
-				
-
-			}
+			UpdateVectorLines(*normal_lines_, cloth_mesh_->GetNormals());
 		}
 		
 	}
 
 	void ClothNode::UpdateClothTangents() {
-		auto indices2 = cloth_mesh_->GetIndices();
-		auto positions = cloth_mesh_->GetPositions();
-		auto uvs = cloth_mesh_->GetTexCoords();
+		const IndexArray& indices2 = cloth_mesh_->GetIndices();
+		const PositionArray& positions = cloth_mesh_->GetPositions();
+		const TexCoordArray& uvs = cloth_mesh_->GetTexCoords();
 
 		auto tangents = make_unique<TangentArray>();
 
@@ -582,18 +684,8 @@ namespace GLOO {
 
 		cloth_mesh_->UpdateTangents(std::move(tangents));
 
-		auto tangents2 = cloth_mesh_->GetTangents();
-		float normal_size = .5f;
-
 		if (normals_on_) {
-			for (int normal_index = 0; normal_index < tangents_ptrs_.size(); normal_index++) {
-				auto positions = make_unique<PositionArray>();
-				positions->push_back(state_.positions[normal_index]);
-				positions->push_back((state_.positions[normal_index] + tangents2[normal_index] * normal_size));
-				tangents_ptrs_[normal_index]->GetComponentPtr<RenderingComponent>()->GetVertexObjectPtr()->UpdatePositions(std::move(positions));
-
-
-			}
+			UpdateVectorLines(*tangent_lines_, cloth_mesh_->GetTangents());
 		}
 
 	}
@@ -615,19 +707,14 @@ namespace GLOO {
 	}
 
 	void ClothNode::FindIncidentTriangles() {
-		auto indices = cloth_mesh_->GetIndices();
-		auto positions = cloth_mesh_->GetPositions();
-		std::vector<std::vector<int>> incident_tris;
-		for (int position_index = 0; position_index < positions.size(); position_index++) {
-			std::vector<int> tris;
-			for (int i = 0; i < indices.size() - 2; i += 3) {
-				if (indices[i] == position_index || indices[i + 1] == position_index || indices[i + 2] == position_index) {
-					tris.push_back(i / 3);
-				}
+		// One pass over the triangles, so large cloths do not pay for every vertex-triangle pair
+		const IndexArray& indices = cloth_mesh_->GetIndices();
+		incident_triangles_.assign(cloth_mesh_->GetPositions().size(), std::vector<int>());
+		for (int i = 0; i + 2 < indices.size(); i += 3) {
+			for (int corner = 0; corner < 3; corner++) {
+				incident_triangles_[indices[i + corner]].push_back(i / 3);
 			}
-			incident_tris.push_back(tris);
 		}
-		incident_triangles_ = incident_tris;
 	}
 
 	void ClothNode::ToggleWireframe() {
@@ -635,8 +722,10 @@ namespace GLOO {
 		for (auto ptr : sphere_ptrs_) {
 			ptr->SetActive(wireframe_on_);
 		}
-		for (auto ptr : line_ptrs_) {
-			ptr->SetActive(wireframe_on_);
+		spring_lines_node_->SetActive(wireframe_on_);
+		if (wireframe_on_) {
+			// No new snapshot may arrive while paused
+			DrawWireframe();
 		}
 
 		cloth_mesh_node_->SetActive(!wireframe_on_);
@@ -644,77 +733,33 @@ namespace GLOO {
 	}
 
 	void ClothNode::ToggleBall() {
-		ball_collision_ = !ball_collision_;
-		ball_ptr_->SetActive(ball_collision_);
+		if (player_ != nullptr) {
+			return;
+		}
+		ball_on_ = !ball_on_;
+		ball_ptr_->SetActive(ball_on_);
+		simulation_thread_.PostCommand([this]() { simulation_.ToggleBall(); });
 	}
 
 	void ClothNode::CreateNormalLines() {
-		for (int i = 0; i < state_.positions.size(); i++) {
-			auto line = std::make_shared<VertexObject>();
-			auto line_shader = std::make_shared<SimpleShader>();
-			auto indices = IndexArray({ 0,1 });
-			line->UpdateIndices(make_unique<IndexArray>(indices));
-			auto positions = PositionArray({ glm::vec3(0.f) , glm::vec3(0.f) });
-			line->UpdatePositions(make_unique<PositionArray>(positions));
-
-			auto line_node = make_unique<SceneNode>();
-			line_node->CreateComponent<ShadingComponent>(line_shader);
-			auto& rc_line = line_node->CreateComponent<RenderingComponent>(line);
-			rc_line.SetDrawMode(DrawMode::Lines);
-			auto color = glm::vec3(0.f, 0.f, 1.f);
-			auto material = std::make_shared<Material>(color, color, color, 0.0f);
-			line_node->CreateComponent<MaterialComponent>(material);
-			normals_ptrs_.push_back(line_node.get());
-	
-			AddChild(std::move(line_node));
-			normals_ptrs_.back()->SetActive(false);
-		}
-		
+		normal_lines_ = CreateVectorLines();
+		normal_lines_node_ = CreateLineNode(normal_lines_, glm::vec3(0.f, 0.f, 1.f));
 	}
 
 	void ClothNode::CreateTangentLines() {
-		for (int i = 0; i < state_.positions.size(); i++) {
-			auto line = std::make_shared<VertexObject>();
-			auto line_shader = std::make_shared<SimpleShader>();
-			auto indices = IndexArray({ 0,1 });
-			line->UpdateIndices(make_unique<IndexArray>(indices));
-			auto positions = PositionArray({ glm::vec3(0.f) , glm::vec3(0.f) });
-			line->UpdatePositions(make_unique<PositionArray>(positions));
-
-			auto line_node = make_unique<SceneNode>();
-			line_node->CreateComponent<ShadingComponent>(line_shader);
-			auto& rc_line = line_node->CreateComponent<RenderingComponent>(line);
-			rc_line.SetDrawMode(DrawMode::Lines);
-			auto color = glm::vec3(1.f, 0.f, 0.f);
-			auto material = std::make_shared<Material>(color, color, color, 0.0f);
-			line_node->CreateComponent<MaterialComponent>(material);
-			tangents_ptrs_.push_back(line_node.get());
-
-			AddChild(std::move(line_node));
-			tangents_ptrs_.back()->SetActive(false);
-		}
-
+		tangent_lines_ = CreateVectorLines();
+		tangent_lines_node_ = CreateLineNode(tangent_lines_, glm::vec3(1.f, 0.f, 0.f));
 	}
 	void ClothNode::ToggleNormals() {
 		normals_on_ = !normals_on_;
-		for (auto ptr : normals_ptrs_) {
-			ptr->SetActive(normals_on_);
-		}
-		for (auto ptr : tangents_ptrs_) {
-			ptr->SetActive(normals_on_);
-		}
+		normal_lines_node_->SetActive(normals_on_);
+		tangent_lines_node_->SetActive(normals_on_);
 	}
 
 	void ClothNode::TogglePause() {
 		pause_on_ = !pause_on_;
-
-	}
-	void ClothNode::FixCorners() {
-		state_.positions[IndexOf(0, 0)] = glm::vec3(0.f, 0.f, 0.f);
-		state_.positions[IndexOf(0, cloth_size_ - 1)] = glm::vec3(cloth_width_, 0.f, 0.f);
-		system_.FixParticle(IndexOf(0, 0));
-		system_.FixParticle(IndexOf(0, cloth_size_ - 1));
-
+		bool paused = pause_on_;
+		simulation_thread_.PostCommand([this, paused]() { simulation_paused_ = paused; });
 	}
 
 	void ClothNode::CreateFrame() {
@@ -2,27 +2,31 @@
 #define CLOTH_NODE_H_
 
 #include "gloo/SceneNode.hpp"
-#include "ParticleState.hpp"
-#include "PendulumSystem.hpp"
-#include "ForwardEulerIntegrator.hpp"
+#include "ClothSimulation.hpp"
 #include "gloo/components/TextureComponent.hpp"
 #include "gloo/components/RenderingComponent.hpp"
 #include "Raycaster.hpp"
 #include "gloo/shaders/ShaderProgram.hpp"
 #include "gloo/VertexObject.hpp"
+#include "SimulationThread.hpp"
+#include "TripleBuffer.hpp"
+#include "TrajectoryRecorder.hpp"
+#include "TrajectoryPlayer.hpp"
+
+#include <memory>
 
 namespace GLOO {
     class ClothNode : public SceneNode {
     public:
-        // Constructor
-        ClothNode(float integration_step, IntegratorType integrator_type, Raycaster* raycaster);
+        // Constructor; the cloth is stepped by simulation_thread, which must outlive the node
+        ClothNode(float integration_step, IntegratorType integrator_type, const ClothParameters& parameters, Raycaster* raycaster, SimulationThread& simulation_thread);
         void Update(double delta_time) override;
         bool GetWireFrameState() {
             return wireframe_on_;
 
         }
         bool GetBallState() {
-            return ball_collision_;
+            return ball_on_;
         }
         bool GetNormalsState() {
             return normals_on_;
@@ -33,36 +37,52 @@ namespace GLOO {
         bool GetWindState() {
             return wind_on_;
         }
-        void ToggleWind() {
-            system_.ToggleWind();
-            wind_on_ = !wind_on_;
-        }
-        void SetGravity(float amountx, float amounty, float amountz) {
-            gravity_ = glm::vec3(amountx, amounty, amountz);
-            system_.UpdateGravity(gravity_);
-        }
+        void ToggleWind();
+        void SetGravity(float amountx, float amounty, float amountz);
         glm::vec3 GetGravity() {
             return gravity_;
         }
+        void SetThreadCount(int thread_count);
+        // Accepted/rejected step counts of an adaptive integrator, nullptr for fixed steps
+        const AdaptiveStepStats* GetAdaptiveStats() const {
+            const ClothSnapshot& snapshot = snapshots_.GetReadBuffer();
+            return snapshot.adaptive ? &snapshot.adaptive_stats : nullptr;
+        }
         float GetWindStrength() {
-            return system_.GetWindStrength();
-        }
-        void SetWindStrength(float value) {
-            system_.SetWindStrength(value);
-        }
-        void TogglePins() {
-            if (pinned_ == 2) {
-                ReleaseOneCorner();
-                pinned_ = 1;
-            } else if (pinned_ == 1) {
-                ReleaseCorners();
-                pinned_ = 0;
-            }
-            else {
-                FixCorners();
-                pinned_ = 2;
-            }
-        } 
+            return wind_strength_;
+        }
+        void SetWindStrength(float value);
+        void TogglePins();
+        // Saved and restored on the simulation thread; failures are reported on stderr
+        void SaveCheckpoint(const std::string& file_path);
+        void LoadCheckpoint(const std::string& file_path);
+        // Streams the positions after every tick to a trajectory file from here on
+        void StartRecording(const std::string& file_path);
+        // Prints a hash of the cloth's state after every interval-th step, 0 to stop
+        void SetStateHashInterval(int interval);
+        // Shows a recorded trajectory instead of simulating; throws std::runtime_error if the
+        // file cannot be read or holds a different number of particles
+        void StartPlayback(const std::string& file_path);
+        bool IsPlayingBack() const {
+            return player_ != nullptr;
+        }
+        // Recorded simulation time shown; R seeks back to the start
+        double GetPlaybackTime() const {
+            return playback_time_;
+        }
+        double GetPlaybackStartTime() const {
+            return player_->GetStartTime();
+        }
+        double GetPlaybackEndTime() const {
+            return player_->GetEndTime();
+        }
+        void SeekPlayback(double time);
+        bool GetPlaybackPaused() const {
+            return playback_paused_;
+        }
+        void SetPlaybackPaused(bool paused) {
+            playback_paused_ = paused;
+        }
         void ToggleClothNormal() {
             cloth_mesh_node_->GetComponentPtr<TextureComponent>()->GetTexture().ToggleNormal();
         }
@@ -91,9 +111,44 @@ namespace GLOO {
             polygon_is_wire_ = !polygon_is_wire_;
         }
     private:
+        // What the render thread sees of the simulation, published after each pass:
+        // the states after the last two ticks and how far to blend between them
+        struct ClothSnapshot {
+            std::vector<glm::vec3> previous_positions;
+            std::vector<glm::vec3> positions;
+            glm::vec3 previous_ball_position;
+            glm::vec3 ball_position;
+            float alpha;
+            // Bumped whenever a checkpoint replaced the settings below
+            int settings_generation;
+            bool ball_on;
+            float ball_radius;
+            bool wind_on;
+            float wind_strength;
+            glm::vec3 gravity;
+            bool adaptive;
+            AdaptiveStepStats adaptive_stats;
+        };
+        // Run on the simulation thread
+        void AdvanceSimulation(int tick_count, double tick_seconds, float alpha);
+        void WriteSnapshot(ClothSnapshot& snapshot, float alpha) const;
+        // Drops the previous tick's state, e.g. after a reset, so nothing blends across the jump
+        void ForgetPreviousTick();
+        // Shows the recorded frame at playback_time_ once the player has it decoded
+        void UpdatePlayback(double delta_time);
+        // Brings the meshes in line with positions_
+        void UpdateMeshes();
+        // Particle positions interpolated to the render time
+        const std::vector<glm::vec3>& GetPositions() const {
+            return positions_;
+        }
         void ResetSystem();
         int IndexOf(int row, int col);
-        void CreateSpring(int i, int j, float rest_length, float stiffness, bool render);
+        void CreateSpringLines();
+        SceneNode* CreateLineNode(std::shared_ptr<VertexObject> lines, glm::vec3 color);
+        // Lines from each particle along a per-particle vector, for normals and tangents
+        std::shared_ptr<VertexObject> CreateVectorLines();
+        void UpdateVectorLines(VertexObject& lines, const std::vector<glm::vec3>& vectors);
         void DrawClothPositions();
         void CreateNormalLines();
         void CreateTangentLines();
@@ -102,13 +157,6 @@ namespace GLOO {
         void UpdateClothNormals();
         void UpdateClothTangents();
 
-        void FixCorners();
-        void ReleaseOneCorner() {
-            system_.ReleaseParticle(IndexOf(0, 0));
-        }
-        void ReleaseCorners() {
-            system_.ReleaseParticle(IndexOf(0, cloth_size_ - 1));
-        }
         glm::vec3 FindTriNorm(glm::vec3 a, glm::vec3 b, glm::vec3 c);
         float FindTriArea(glm::vec3 a, glm::vec3 b, glm::vec3 c);
         void FindIncidentTriangles();
@@ -121,24 +169,43 @@ namespace GLOO {
         float CheckSphereCollision(glm::vec3 ray, glm::vec3 camera_pos, glm::vec3 center, float radius);
         void DragCloth(glm::dvec2 pos);
         glm::dvec2 start_click_pos_;
-        ParticleState state_;
-        // Set gravity and drag value for system calculations
-        glm::vec3 gravity_{ 0.0f, -50.0f, 0.0f };
-        float drag_ = .4f;
-        PendulumSystem system_ = PendulumSystem(gravity_, drag_);
-        std::unique_ptr<IntegratorBase<PendulumSystem, ParticleState>> integrator_;
+        // Physics of the cloth, ball and ground; this node only draws it and handles input.
+        // Only the simulation thread touches it once the node is built; changes are posted
+        // there as commands and the results come back through snapshots_.
+        ClothSimulation simulation_;
+        SimulationThread& simulation_thread_;
+        TripleBuffer<ClothSnapshot> snapshots_;
+        bool simulation_paused_;
+        std::vector<glm::vec3> previous_positions_;
+        glm::vec3 previous_ball_position_;
+        int settings_generation_;
+        std::vector<glm::vec3> positions_;
+        // Settings as last requested from the GUI, ahead of the simulation by up to a pass
+        bool ball_on_;
+        bool wind_on_;
+        float wind_strength_;
+        glm::vec3 gravity_;
+        int seen_settings_generation_;
+        // Created and fed on the simulation thread
+        std::unique_ptr<TrajectoryRecorder> recorder_;
+        // Set while a trajectory is shown; the simulation is not stepped then
+        bool simulation_playing_back_;
+        std::unique_ptr<TrajectoryPlayer> player_;
+        double playback_time_;
+        bool playback_paused_;
+        uint64_t shown_frame_;
         int cloth_size_;
         float cloth_width_;
-        float ground_height_ = -12.0;
+        // Particles get a sphere node each in the wireframe only up to this count
+        static const int kMaxParticleSpheres = 32 * 32;
         std::vector<SceneNode*> sphere_ptrs_;
-        std::vector<SceneNode*> line_ptrs_;
-        std::vector<SceneNode*> tangents_ptrs_;
-
-        std::vector<SceneNode*> normals_ptrs_;
-
-        std::vector<int> line_indices_;
-
-        std::vector<glm::vec3> initial_positions_;
+        // Structural springs, normals and tangents are drawn as one line mesh each
+        std::shared_ptr<VertexObject> spring_lines_;
+        std::shared_ptr<VertexObject> normal_lines_;
+        std::shared_ptr<VertexObject> tangent_lines_;
+        SceneNode* spring_lines_node_;
+        SceneNode* normal_lines_node_;
+        SceneNode* tangent_lines_node_;
 
         std::vector<std::vector<int>> incident_triangles_;
 
@@ -147,20 +214,13 @@ namespace GLOO {
         std::shared_ptr<VertexObject> cloth_mesh_;
         SceneNode* cloth_mesh_node_;
         SceneNode* ball_ptr_;
+        // Radius the ball mesh was built with; the node is scaled to the simulation's radius
+        float ball_mesh_radius_;
         SceneNode* collision_ptr_;
-        glm::vec3 ball_start_pos_;
-        double time_;
-        float integration_step_;
-        IntegratorType integrator_type_;
-        float rollover_time_;
-        float ball_radius_;
-        
-        int pinned_ = 2;
-        bool wind_on_;
+
         bool pause_on_;
         bool wireframe_on_;
         bool normals_on_;
-        bool ball_collision_;
 
         int texture_index_ = 0;
         std::vector<std::string> diffuse_maps_{"stone.png", "14.png", "argyle.png"};
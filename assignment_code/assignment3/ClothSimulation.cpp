@@ -0,0 +1,796 @@
+#include "ClothSimulation.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <set>
+#include <stdexcept>
+
+#include "ClothCheckpoint.hpp"
+#include "IntegratorFactory.hpp"
+#include "StateHash.hpp"
+#include "gloo/debug/Profiler.hpp"
+
+namespace GLOO {
+namespace {
+// Particles count as touching within this fraction of the particle spacing.
+const float kImpactTolerance = 0.01f;
+// Rounds of impulses before the remaining contacts are frozen.
+const int kImpulseRounds = 4;
+// Impulses leave contacts this many tolerances apart, so they are not
+// taken for contacts that were there before the next step.
+const float kImpactSeparation = 2.0f;
+// Impulses move no particle by more than this times the distance the
+// features need to move apart.
+const float kMaxImpulseScale = 2.0f;
+// Particles are kept this far outside the ball.
+const float kBallMargin = .12f;
+// Particles rest this far above the ground.
+const float kGroundOffset = .05f;
+// Particles up to this high above the ground lie on it: the ground holds
+// them, and cloth pressed onto them cannot be pushed aside.
+const float kGroundLayer = 2.0f * kGroundOffset;
+}  // namespace
+
+ClothSimulation::ClothSimulation(IntegratorType integrator_type,
+                                 float integration_step,
+                                 const ClothParameters& parameters)
+    : cloth_size_(parameters.resolution),
+      cloth_width_(parameters.width),
+      integration_step_(integration_step),
+      gravity_(parameters.gravity),
+      ground_height_(parameters.ground_height),
+      pins_(parameters.pins),
+      system_(parameters.gravity, parameters.drag),
+      integrator_type_(integrator_type),
+      tolerances_(parameters.tolerances),
+      soa_layout_(parameters.soa_layout),
+      time_(0.0),
+      rollover_time_(0.0f),
+      deterministic_(parameters.deterministic),
+      step_count_(0),
+      hash_interval_(0),
+      pinned_(int(parameters.pins.size())),
+      ball_start_pos_(parameters.ball_position),
+      ball_position_(ball_start_pos_),
+      ball_radius_(parameters.ball_radius),
+      ball_collision_(parameters.ball),
+      colliders_(parameters.colliders),
+      swept_spheres_(parameters.swept_spheres),
+      ball_step_start_(ball_position_),
+      self_collision_thickness_(parameters.self_collision_thickness),
+      continuous_collision_(parameters.continuous_collision) {
+  if (cloth_size_ < 2) {
+    throw std::runtime_error("Cloth resolution must be at least 2!");
+  }
+  if (self_collision_thickness_ < 0.0f ||
+      self_collision_thickness_ >= cloth_width_ / float(cloth_size_)) {
+    throw std::runtime_error(
+        "Cloth self-collision thickness must be below the particle spacing!");
+  }
+  for (const glm::ivec2& pin : pins_) {
+    if (PinIndex(pin) == -1)
+      throw std::runtime_error("Cloth pin is outside the cloth!");
+  }
+  ball_collider_ = colliders_.AddSphere(
+      SphereCollider{ball_position_, ball_radius_}, kBallMargin);
+  colliders_.AddPlane(PlaneCollider{glm::vec3(0.f, 1.f, 0.f), ground_height_},
+                      kGroundOffset);
+  CreateIntegrator();
+
+  // ---- Spring Properties ----
+  float spacing = cloth_width_ / float(cloth_size_);
+  float structural_rest_length = spacing;
+  float shear_rest_length = std::sqrt(2.0f) * spacing;
+  float flex_rest_length = 2 * spacing;
+  float stiffness = parameters.stiffness;
+  float mass = parameters.mass;
+  // -------------------------
+
+  for (int i = 0; i < cloth_size_; i++) {
+    for (int j = 0; j < cloth_size_; j++) {
+      initial_positions_.push_back(glm::vec3(i * spacing, -j * spacing, 0.f));
+    }
+  }
+  state_.positions = initial_positions_;
+  state_.velocities.assign(initial_positions_.size(), glm::vec3(0.f));
+  for (size_t i = 0; i < initial_positions_.size(); i++) {
+    system_.AddParticle(mass);
+  }
+
+  for (int col = 0; col < cloth_size_; col++) {
+    for (int row = 0; row < cloth_size_; row++) {
+      // ---- Structural Springs ----
+      if (col < cloth_size_ - 1) {
+        AddSpring(IndexOf(row, col), IndexOf(row, col + 1),
+                  structural_rest_length, stiffness, true);
+      }
+      if (row < cloth_size_ - 1) {
+        AddSpring(IndexOf(row, col), IndexOf(row + 1, col),
+                  structural_rest_length, stiffness, true);
+      }
+      // ---- Shear Springs ----
+      if (col < cloth_size_ - 1 && row < cloth_size_ - 1) {
+        AddSpring(IndexOf(row, col), IndexOf(row + 1, col + 1),
+                  shear_rest_length, stiffness, false);
+      }
+      if (row > 0 && col < cloth_size_ - 1) {
+        AddSpring(IndexOf(row, col), IndexOf(row - 1, col + 1),
+                  shear_rest_length, stiffness, false);
+      }
+      // ---- Flex Springs ----
+      float flex_scalar = parameters.flex_scale;
+      if (col < cloth_size_ - 2) {
+        AddSpring(IndexOf(row, col), IndexOf(row, col + 2), flex_rest_length,
+                  stiffness * flex_scalar, false);
+      }
+      if (row < cloth_size_ - 2) {
+        AddSpring(IndexOf(row, col), IndexOf(row + 2, col), flex_rest_length,
+                  stiffness * flex_scalar, false);
+      }
+    }
+  }
+  for (int col = 0; col < cloth_size_ - 1; col++) {
+    for (int row = 0; row < cloth_size_ - 1; row++) {
+      int i = IndexOf(row, col);
+      triangles_.push_back(glm::ivec3(i, i + 1, i + cloth_size_));
+      triangles_.push_back(
+          glm::ivec3(i + cloth_size_, i + 1, i + cloth_size_ + 1));
+    }
+  }
+  FixPins();
+  system_.PopulateSpringData();
+  collision_free_positions_ = state_.positions;
+
+  if (continuous_collision_) {
+    std::vector<bool> vertex_taken(state_.Size(), false);
+    std::set<std::pair<int, int>> edges_taken;
+    triangle_features_.assign(triangles_.size(), 0);
+    for (size_t t = 0; t < triangles_.size(); t++) {
+      const glm::ivec3& triangle = triangles_[t];
+      for (int corner = 0; corner < 3; corner++) {
+        int start = triangle[corner];
+        int end = triangle[(corner + 1) % 3];
+        if (!vertex_taken[start]) {
+          vertex_taken[start] = true;
+          triangle_features_[t] |= uint8_t(1 << corner);
+        }
+        if (edges_taken
+                .insert(std::make_pair(std::min(start, end),
+                                       std::max(start, end)))
+                .second) {
+          triangle_features_[t] |= uint8_t(1 << (3 + corner));
+        }
+      }
+    }
+    triangle_bvh_.Build(triangles_, initial_positions_);
+    resting_triangles_.resize(triangles_.size());
+  }
+
+  if (!parameters.checkpoint.empty()) {
+    start_checkpoint_ = std::make_shared<ClothCheckpoint>(parameters.checkpoint);
+    LoadCheckpoint(*start_checkpoint_);
+  }
+}
+
+int ClothSimulation::Advance(double delta_time) {
+  UpdateBall();
+
+  rollover_time_ += delta_time;
+  float dt = 0.0f;
+  int num_steps = 0;
+  if (deterministic_) {
+    num_steps = int(rollover_time_ / integration_step_);
+    rollover_time_ -= integration_step_ * num_steps;
+    for (int i = 0; i < num_steps; i++) {
+      if (i > 0)
+        UpdateBall();
+      Step(integration_step_);
+    }
+    return num_steps;
+  } else if (integrator_->GetAdaptiveStats() != nullptr) {
+    // Adaptive integrators choose their own substeps, so hand them the whole
+    // frame.
+    dt = float(delta_time);
+    num_steps = 1;
+    rollover_time_ = 0.0f;
+  } else if (float(delta_time) < integration_step_) {
+    dt = float(delta_time);
+    num_steps = 1;
+    rollover_time_ = 0.0f;
+  } else {
+    dt = integration_step_;
+    num_steps = int(rollover_time_ / dt);
+    rollover_time_ -= dt * num_steps;
+  }
+  for (int i = 0; i < num_steps; i++) {
+    Step(dt);
+  }
+  return num_steps;
+}
+
+void ClothSimulation::Step(float dt) {
+  if (swept_spheres_) {
+    ball_step_start_ = GetBallPositionAt(time_);
+    ball_position_ = GetBallPositionAt(time_ + dt);
+    step_start_positions_ = state_.positions;
+  }
+  {
+    ScopedTimer timer("Integration");
+    integrator_->Step(system_, state_, float(time_), dt);
+  }
+  bool moved = ResolveCollisions(dt);
+  if (continuous_collision_ && ResolveContinuousCollisions(dt)) {
+    moved = true;
+  }
+  // Forces the integrator kept from the step are of the state before
+  // collisions changed it.
+  if (moved) {
+    integrator_->Invalidate();
+  }
+  time_ += dt;
+  step_count_++;
+  if (hash_interval_ > 0 && step_count_ % hash_interval_ == 0) {
+    hash_callback_(step_count_, time_, HashParticleState(state_));
+  }
+}
+
+void ClothSimulation::SetStateHashing(int interval,
+                                      StateHashCallback callback) {
+  hash_interval_ = callback ? std::max(interval, 0) : 0;
+  hash_callback_ = callback;
+}
+
+void ClothSimulation::CreateIntegrator() {
+  if (soa_layout_) {
+    integrator_ = IntegratorFactory::CreateSoaLayoutIntegrator<PendulumSystem>(
+        integrator_type_, tolerances_);
+    return;
+  }
+  integrator_ = IntegratorFactory::CreateIntegrator<PendulumSystem, ParticleState>(
+      integrator_type_, tolerances_);
+}
+
+void ClothSimulation::Reset() {
+  if (start_checkpoint_ != nullptr) {
+    LoadCheckpoint(*start_checkpoint_);
+    return;
+  }
+  time_ = 0.0;
+  rollover_time_ = 0.0f;
+  step_count_ = 0;
+  CreateIntegrator();
+  state_.positions = initial_positions_;
+  state_.velocities.assign(initial_positions_.size(), glm::vec3(0.f));
+  collision_free_positions_ = state_.positions;
+  ball_position_ = ball_start_pos_;
+}
+
+std::pair<glm::vec3, glm::vec3> ClothSimulation::GetBounds() const {
+  glm::vec3 box_min = state_.positions[0];
+  glm::vec3 box_max = state_.positions[0];
+  for (const glm::vec3& position : state_.positions) {
+    box_min = glm::min(box_min, position);
+    box_max = glm::max(box_max, position);
+  }
+  box_min -= glm::vec3(cloth_width_);
+  box_max += glm::vec3(cloth_width_);
+  box_min.y = std::min(box_min.y, ground_height_ - 1.0f);
+  return std::make_pair(box_min, box_max);
+}
+
+void ClothSimulation::SaveCheckpoint(const std::string& file_path) const {
+  size_t particle_count = state_.Size();
+  const std::vector<Spring>& springs = system_.GetSprings();
+  ClothCheckpointHeader header = ClothCheckpointHeader();
+  header.particle_count = uint32_t(particle_count);
+  header.spring_count = uint32_t(springs.size());
+  header.cloth_size = cloth_size_;
+  header.pinned = pinned_;
+  header.wind_on = system_.IsWindOn() ? 1 : 0;
+  header.time = time_;
+  header.rollover_time = rollover_time_;
+  for (int i = 0; i < 3; i++) {
+    header.gravity[i] = gravity_[i];
+    header.ball_start_position[i] = ball_start_pos_[i];
+    header.ball_position[i] = ball_position_[i];
+  }
+  header.wind_strength = system_.GetWindStrength();
+  header.ball_collision = ball_collision_ ? 1 : 0;
+  header.ball_radius = ball_radius_;
+
+  std::vector<float> masses(particle_count);
+  std::vector<uint8_t> fixed(particle_count);
+  for (size_t i = 0; i < particle_count; i++) {
+    masses[i] = system_.GetMass(int(i));
+    fixed[i] = system_.IsFixed(int(i)) ? 1 : 0;
+  }
+  WriteClothCheckpoint(file_path, header, state_.positions, state_.velocities,
+                       masses, fixed, springs);
+}
+
+void ClothSimulation::LoadCheckpoint(const ClothCheckpoint& checkpoint) {
+  const ClothCheckpointHeader& header = checkpoint.GetHeader();
+  const std::vector<Spring>& springs = system_.GetSprings();
+  if (header.cloth_size != cloth_size_ ||
+      header.particle_count != state_.Size() ||
+      header.spring_count != springs.size()) {
+    throw std::runtime_error("Checkpoint " + checkpoint.GetPath() +
+                             " is of a different cloth!");
+  }
+  const Spring* saved_springs = checkpoint.GetSprings();
+  for (size_t i = 0; i < springs.size(); i++) {
+    if (saved_springs[i].start != springs[i].start ||
+        saved_springs[i].end != springs[i].end) {
+      throw std::runtime_error("Checkpoint " + checkpoint.GetPath() +
+                               " has different springs!");
+    }
+  }
+  if (header.pinned < 0 || header.pinned > int(pins_.size())) {
+    throw std::runtime_error("Checkpoint " + checkpoint.GetPath() +
+                             " has a different number of pins!");
+  }
+
+  // The arrays are read straight from the mapping into the live state.
+  size_t particle_count = state_.Size();
+  state_.positions.assign(checkpoint.GetPositions(),
+                          checkpoint.GetPositions() + particle_count);
+  state_.velocities.assign(checkpoint.GetVelocities(),
+                           checkpoint.GetVelocities() + particle_count);
+  collision_free_positions_ = state_.positions;
+  const float* masses = checkpoint.GetMasses();
+  const uint8_t* fixed = checkpoint.GetFixed();
+  for (size_t i = 0; i < particle_count; i++) {
+    system_.SetMass(int(i), masses[i]);
+    if (fixed[i])
+      system_.FixParticle(int(i));
+    else
+      system_.ReleaseParticle(int(i));
+  }
+  for (size_t i = 0; i < springs.size(); i++) {
+    system_.SetSpringParameters(int(i), saved_springs[i].rest_length,
+                                saved_springs[i].stiffness);
+  }
+  system_.PopulateSpringData();
+
+  pinned_ = header.pinned;
+  time_ = header.time;
+  rollover_time_ = header.rollover_time;
+  step_count_ = 0;
+  CreateIntegrator();
+  SetGravity(glm::vec3(header.gravity[0], header.gravity[1], header.gravity[2]));
+  if (system_.IsWindOn() != (header.wind_on != 0))
+    system_.ToggleWind();
+  system_.SetWindStrength(header.wind_strength);
+  ball_start_pos_ = glm::vec3(header.ball_start_position[0],
+                              header.ball_start_position[1],
+                              header.ball_start_position[2]);
+  ball_position_ = glm::vec3(header.ball_position[0], header.ball_position[1],
+                             header.ball_position[2]);
+  ball_radius_ = header.ball_radius;
+  ball_collision_ = header.ball_collision != 0;
+}
+
+void ClothSimulation::DisplaceParticle(int index, const glm::vec3& offset) {
+  state_.positions[index] += offset;
+  state_.velocities[index] += offset;
+  integrator_->Invalidate();
+}
+
+int ClothSimulation::IndexOf(int row, int col) const {
+  if (row >= cloth_size_ || row < 0 || col >= cloth_size_ || col < 0)
+    return -1;
+  return row + col * cloth_size_;
+}
+
+void ClothSimulation::TogglePins() {
+  if (pinned_ > 0) {
+    system_.ReleaseParticle(PinIndex(pins_[pins_.size() - pinned_]));
+    pinned_--;
+  } else {
+    FixPins();
+    pinned_ = int(pins_.size());
+  }
+  integrator_->Invalidate();
+}
+
+void ClothSimulation::AddSpring(int start,
+                                int end,
+                                float rest_length,
+                                float stiffness,
+                                bool structural) {
+  system_.AddSpring(start, end, rest_length, stiffness);
+  if (structural) {
+    structural_springs_.push_back(std::make_pair(start, end));
+  }
+}
+
+void ClothSimulation::FixPins() {
+  float spacing = cloth_width_ / float(cloth_size_);
+  float frame_spacing = cloth_width_ / float(cloth_size_ - 1);
+  for (const glm::ivec2& pin : pins_) {
+    int index = PinIndex(pin);
+    int row = index % cloth_size_;
+    int col = index / cloth_size_;
+    state_.positions[index] =
+        glm::vec3(col * frame_spacing, -row * spacing, 0.f);
+    system_.FixParticle(index);
+  }
+}
+
+int ClothSimulation::PinIndex(const glm::ivec2& pin) const {
+  int row = pin.x < 0 ? cloth_size_ + pin.x : pin.x;
+  int col = pin.y < 0 ? cloth_size_ + pin.y : pin.y;
+  return IndexOf(row, col);
+}
+
+void ClothSimulation::UpdateBall() {
+  ball_position_ = GetBallPositionAt(time_);
+}
+
+glm::vec3 ClothSimulation::GetBallPositionAt(double time) const {
+  float dist = 8.5f;
+  float z = dist * std::cos(.75f * float(time)) - dist;
+  return ball_start_pos_ + glm::vec3(0.f, 0.f, z);
+}
+
+bool ClothSimulation::ResolveCollisions(float dt) {
+  bool moved = false;
+  if (self_collision_thickness_ > 0.0f) {
+    moved = ResolveSelfCollisions();
+  }
+
+  ScopedTimer timer("Collider collision");
+  colliders_.SetSphere(ball_collider_,
+                       SphereCollider{ball_position_, ball_radius_},
+                       swept_spheres_ ? ball_step_start_ : ball_position_);
+  colliders_.SetSphereActive(ball_collider_, ball_collision_);
+  const std::vector<glm::vec3>* start_positions =
+      swept_spheres_ ? &step_start_positions_ : nullptr;
+  std::atomic<bool> collider_moved(false);
+  system_.ForEachRange(int(state_.Size()), [&](int begin, int end) {
+    if (colliders_.Resolve(state_.positions, state_.velocities, begin, end,
+                           dt, start_positions)) {
+      collider_moved = true;
+    }
+  });
+  return moved || collider_moved;
+}
+
+bool ClothSimulation::ResolveSelfCollisions() {
+  ScopedTimer timer("Self collision");
+  // Cells no smaller than a grid square keep each triangle in a few cells.
+  float cell_size = std::max(2.0f * self_collision_thickness_,
+                             cloth_width_ / float(cloth_size_));
+  particle_hash_.BuildPoints(state_.positions, cell_size);
+  triangle_hash_.BuildTriangles(state_.positions, triangles_, cell_size,
+                                self_collision_thickness_);
+
+  int n = int(state_.Size());
+  position_changes_.resize(n);
+  velocity_changes_.resize(n);
+  system_.ForEachRange(n, [&](int begin, int end) {
+    for (int i = begin; i < end; i++) {
+      ComputeSelfCollisionResponse(i, position_changes_[i],
+                                   velocity_changes_[i]);
+    }
+  });
+  bool moved = false;
+  for (int i = 0; i < n; i++) {
+    if (position_changes_[i] != glm::vec3(0.f) ||
+        velocity_changes_[i] != glm::vec3(0.f)) {
+      state_.positions[i] += position_changes_[i];
+      state_.velocities[i] += velocity_changes_[i];
+      moved = true;
+    }
+  }
+  return moved;
+}
+
+void ClothSimulation::ComputeSelfCollisionResponse(
+    int index,
+    glm::vec3& position_change,
+    glm::vec3& velocity_change) const {
+  position_change = glm::vec3(0.f);
+  velocity_change = glm::vec3(0.f);
+  if (system_.IsFixed(index))
+    return;
+  float thickness = self_collision_thickness_;
+  const glm::vec3& position = state_.positions[index];
+  const glm::vec3& velocity = state_.velocities[index];
+  int contacts = 0;
+  // Moves the particle out to the thickness along normal and stops it
+  // closing in on the other side, which moves at other_velocity.
+  auto respond = [&](const glm::vec3& normal, float distance, float share,
+                     const glm::vec3& other_velocity) {
+    position_change += share * (thickness - distance) * normal;
+    float approach = glm::dot(velocity - other_velocity, normal);
+    if (approach < 0.0f)
+      velocity_change -= share * approach * normal;
+    contacts++;
+  };
+
+  particle_hash_.ForEachNear(position, [&](int other) {
+    glm::vec3 offset = position - state_.positions[other];
+    float distance_squared = glm::dot(offset, offset);
+    if (distance_squared >= thickness * thickness || distance_squared == 0.0f ||
+        AreAdjacent(index, other)) {
+      return;
+    }
+    float distance = std::sqrt(distance_squared);
+    // Both particles of a pair respond, each going half the way.
+    float share = system_.IsFixed(other) ? 1.0f : 0.5f;
+    respond(offset / distance, distance, share, state_.velocities[other]);
+  });
+
+  triangle_hash_.ForEachInCell(position, [&](int t) {
+    const glm::ivec3& triangle = triangles_[t];
+    const glm::vec3& a = state_.positions[triangle.x];
+    const glm::vec3& b = state_.positions[triangle.y];
+    const glm::vec3& c = state_.positions[triangle.z];
+    // Most triangles sharing the cell are out of reach; the box test is
+    // cheaper than the adjacency test and the closest point.
+    glm::vec3 box_min = glm::min(glm::min(a, b), c) - glm::vec3(thickness);
+    glm::vec3 box_max = glm::max(glm::max(a, b), c) + glm::vec3(thickness);
+    for (int axis = 0; axis < 3; axis++) {
+      if (position[axis] < box_min[axis] || position[axis] > box_max[axis])
+        return;
+    }
+    if (AreAdjacent(index, triangle.x) || AreAdjacent(index, triangle.y) ||
+        AreAdjacent(index, triangle.z)) {
+      return;
+    }
+    glm::vec3 weights;
+    glm::vec3 closest = ClosestPointOnTriangle(position, a, b, c, weights);
+    glm::vec3 offset = position - closest;
+    float distance_squared = glm::dot(offset, offset);
+    if (distance_squared >= thickness * thickness || distance_squared == 0.0f)
+      return;
+    float distance = std::sqrt(distance_squared);
+    glm::vec3 triangle_velocity = weights.x * state_.velocities[triangle.x] +
+                                  weights.y * state_.velocities[triangle.y] +
+                                  weights.z * state_.velocities[triangle.z];
+    // Only the particle moves; the triangle's corners respond through
+    // their own contacts.
+    respond(offset / distance, distance, 1.0f, triangle_velocity);
+  });
+
+  // Averaging keeps a particle caught between several contacts from
+  // overshooting.
+  if (contacts > 1) {
+    position_change /= float(contacts);
+    velocity_change /= float(contacts);
+  }
+}
+
+bool ClothSimulation::AreAdjacent(int a, int b) const {
+  int row_a = a % cloth_size_;
+  int col_a = a / cloth_size_;
+  int row_b = b % cloth_size_;
+  int col_b = b / cloth_size_;
+  return std::abs(row_a - row_b) <= 1 && std::abs(col_a - col_b) <= 1;
+}
+
+bool ClothSimulation::ResolveContinuousCollisions(float dt) {
+  ScopedTimer timer("Continuous collision");
+  float tolerance = kImpactTolerance * cloth_width_ / float(cloth_size_);
+  // Stopping one contact can cause others, so impulses go round a few times.
+  int impact_count = FindImpacts(tolerance);
+  bool moved = false;
+  for (int round = 0; round < kImpulseRounds && impact_count > 0; round++) {
+    bool applied = false;
+    for (size_t k = 0; k < contact_tests_.size(); k++) {
+      if (impact_found_[k] &&
+          ApplyImpulse(contact_tests_[k], impacts_[k], tolerance, dt)) {
+        applied = true;
+      }
+    }
+    // Contacts no impulse can stop go straight to the fail-safe.
+    if (!applied)
+      break;
+    moved = true;
+    impact_count = FindImpacts(tolerance);
+  }
+
+  // Whatever contacts are left, the particles involved go back to where
+  // they were, which was free of contacts. Each pass freezes at least one
+  // more particle, so this ends.
+  std::vector<glm::vec3>& start = collision_free_positions_;
+  reverted_.assign(state_.Size(), 0);
+  while (impact_count > 0) {
+    bool frozen = false;
+    for (size_t k = 0; k < contact_tests_.size(); k++) {
+      if (!impact_found_[k])
+        continue;
+      for (int i = 0; i < 4; i++) {
+        int particle = contact_tests_[k].particles[i];
+        if (impacts_[k].weights[i] != 0.0f &&
+            state_.positions[particle] != start[particle]) {
+          state_.positions[particle] = start[particle];
+          state_.velocities[particle] = glm::vec3(0.f);
+          reverted_[particle] = 1;
+          frozen = true;
+        }
+      }
+    }
+    if (!frozen)
+      break;
+    moved = true;
+    // Going back only shrinks the swept boxes, so the tests still hold
+    // every pair of features that can touch, and only those of particles
+    // that just went back can have changed.
+    impact_count = TestContacts(tolerance, true);
+    std::fill(reverted_.begin(), reverted_.end(), 0);
+  }
+  start = state_.positions;
+  return moved;
+}
+
+int ClothSimulation::FindImpacts(float tolerance) {
+  for (size_t t = 0; t < triangles_.size(); t++) {
+    const glm::ivec3& triangle = triangles_[t];
+    resting_triangles_[t] =
+        IsHeld(triangle.x) && IsHeld(triangle.y) && IsHeld(triangle.z);
+  }
+  triangle_bvh_.Refit(collision_free_positions_, state_.positions,
+                      resting_triangles_, tolerance);
+  contact_tests_.clear();
+  triangle_bvh_.ForEachOverlappingPair(
+      [this](int t, int u) { AddContactTests(t, u); });
+
+  impacts_.resize(contact_tests_.size());
+  impact_found_.resize(contact_tests_.size());
+  return TestContacts(tolerance, false);
+}
+
+int ClothSimulation::TestContacts(float tolerance, bool only_reverted) {
+  system_.ForEachRange(int(contact_tests_.size()), [&](int begin, int end) {
+    for (int k = begin; k < end; k++) {
+      const int* particles = contact_tests_[k].particles;
+      if (only_reverted && !reverted_[particles[0]] &&
+          !reverted_[particles[1]] && !reverted_[particles[2]] &&
+          !reverted_[particles[3]]) {
+        continue;
+      }
+      impact_found_[k] = FindImpact(contact_tests_[k], tolerance, impacts_[k]);
+    }
+  });
+  return int(std::count(impact_found_.begin(), impact_found_.end(), 1));
+}
+
+void ClothSimulation::AddContactTests(int t, int u) {
+  const glm::ivec3 triangles[2] = {triangles_[t], triangles_[u]};
+  const uint8_t features[2] = {triangle_features_[t], triangle_features_[u]};
+  // Features near each other in the grid are kept apart by the springs, as
+  // in ResolveSelfCollisions, and features lying on the ground are held
+  // there.
+  auto near_triangle = [this](const glm::ivec3& triangle, int particle) {
+    return AreAdjacent(particle, triangle.x) ||
+           AreAdjacent(particle, triangle.y) ||
+           AreAdjacent(particle, triangle.z);
+  };
+  auto held = [this](int a, int b, int c, int d) {
+    return IsHeld(a) && IsHeld(b) && IsHeld(c) && IsHeld(d);
+  };
+  for (int side = 0; side < 2; side++) {
+    const glm::ivec3& own = triangles[side];
+    const glm::ivec3& other = triangles[1 - side];
+    for (int corner = 0; corner < 3; corner++) {
+      if ((features[side] & (1 << corner)) == 0 ||
+          near_triangle(other, own[corner]) ||
+          held(own[corner], other.x, other.y, other.z)) {
+        continue;
+      }
+      contact_tests_.push_back(
+          ContactTest{{own[corner], other.x, other.y, other.z}, false});
+    }
+  }
+  for (int i = 0; i < 3; i++) {
+    if ((features[0] & (1 << (3 + i))) == 0)
+      continue;
+    int a0 = triangles[0][i];
+    int a1 = triangles[0][(i + 1) % 3];
+    for (int j = 0; j < 3; j++) {
+      if ((features[1] & (1 << (3 + j))) == 0)
+        continue;
+      int b0 = triangles[1][j];
+      int b1 = triangles[1][(j + 1) % 3];
+      if (AreAdjacent(a0, b0) || AreAdjacent(a0, b1) || AreAdjacent(a1, b0) ||
+          AreAdjacent(a1, b1) || held(a0, a1, b0, b1)) {
+        continue;
+      }
+      contact_tests_.push_back(ContactTest{{a0, a1, b0, b1}, true});
+    }
+  }
+}
+
+bool ClothSimulation::FindImpact(const ContactTest& test,
+                                 float tolerance,
+                                 Impact& impact) const {
+  glm::vec3 start[4];
+  glm::vec3 end[4];
+  for (int i = 0; i < 4; i++) {
+    start[i] = collision_free_positions_[test.particles[i]];
+    end[i] = state_.positions[test.particles[i]];
+  }
+  bool found = test.edge_edge
+                   ? FindEdgeEdgeImpact(start, end, tolerance, impact)
+                   : FindVertexTriangleImpact(start, end, tolerance, impact);
+  if (!found)
+    return false;
+  // Features moving apart are left alone, and so are features that cannot
+  // move apart: the ground presses layers of cloth lying on it into one
+  // plane, which no response here can undo.
+  float approach = 0.0f;
+  bool movable = false;
+  for (int i = 0; i < 4; i++) {
+    approach += impact.weights[i] * glm::dot(impact.normal, end[i] - start[i]);
+    movable = movable ||
+              (impact.weights[i] != 0.0f && !IsHeld(test.particles[i]));
+  }
+  return approach < 0.0f && movable;
+}
+
+bool ClothSimulation::ApplyImpulse(const ContactTest& test,
+                                   const Impact& impact,
+                                   float tolerance,
+                                   float dt) {
+  // How far the features must move apart along the normal to end the step
+  // separated.
+  float needed = kImpactSeparation * tolerance;
+  for (int i = 0; i < 4; i++) {
+    needed -= impact.weights[i] *
+              glm::dot(impact.normal, state_.positions[test.particles[i]]);
+  }
+  // An earlier impulse this round may already have separated them.
+  if (needed <= 0.0f)
+    return false;
+
+  // Split by weight and inverse mass, as an inelastic impulse would be.
+  // Particles on the ground hold against being pushed down; if that is
+  // where one would go, the others share its part.
+  float inverse_masses[4];
+  for (int i = 0; i < 4; i++) {
+    int particle = test.particles[i];
+    inverse_masses[i] =
+        system_.IsFixed(particle) ? 0.0f : 1.0f / system_.GetMass(particle);
+  }
+  float changes[4];
+  for (int pass = 0; pass < 2; pass++) {
+    float denominator = 0.0f;
+    for (int i = 0; i < 4; i++)
+      denominator += impact.weights[i] * impact.weights[i] * inverse_masses[i];
+    if (denominator == 0.0f)
+      return false;
+    bool grounded = false;
+    for (int i = 0; i < 4; i++) {
+      changes[i] = needed * impact.weights[i] * inverse_masses[i] / denominator;
+      if (changes[i] * impact.normal.y < 0.0f && IsHeld(test.particles[i])) {
+        inverse_masses[i] = 0.0f;
+        grounded = true;
+      }
+    }
+    if (!grounded)
+      break;
+    if (pass == 1)
+      return false;
+  }
+  // With the heavy end held, a particle of little weight would have to move
+  // far to part the features alone; that is left to the fail-safe.
+  for (int i = 0; i < 4; i++) {
+    if (std::abs(changes[i]) > kMaxImpulseScale * needed)
+      return false;
+  }
+  for (int i = 0; i < 4; i++) {
+    state_.positions[test.particles[i]] += changes[i] * impact.normal;
+    state_.velocities[test.particles[i]] += (changes[i] / dt) * impact.normal;
+  }
+  return true;
+}
+
+bool ClothSimulation::IsHeld(int particle) const {
+  return system_.IsFixed(particle) ||
+         state_.positions[particle].y <= ground_height_ + kGroundLayer;
+}
+}  // namespace GLOO
@@ -0,0 +1,331 @@
+#ifndef CLOTH_SIMULATION_H_
+#define CLOTH_SIMULATION_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "ColliderSet.hpp"
+#include "ContinuousCollision.hpp"
+#include "IntegratorBase.hpp"
+#include "IntegratorType.hpp"
+#include "ParticleState.hpp"
+#include "PendulumSystem.hpp"
+#include "SpatialHash.hpp"
+#include "TriangleBvh.hpp"
+
+namespace GLOO {
+// Physical setup of a cloth and its colliders. The defaults are the original
+// scene's.
+struct ClothParameters {
+  // Particles per side, spread over width units.
+  int resolution = 12;
+  float width = 10.0f;
+  float mass = .075f;
+  // Structural and shear springs; flex springs are flex_scale times stiffer.
+  float stiffness = 150.0f;
+  float flex_scale = 1.3f;
+  float drag = .4f;
+  glm::vec3 gravity{0.0f, -50.0f, 0.0f};
+  // Pinned particles as (row, col); negative indices count from the last
+  // row or column. Pins hold their particle on the frame bar, which spans
+  // the full width, so column c sits at x = c * width / (resolution - 1).
+  std::vector<glm::ivec2> pins{glm::ivec2(0, 0), glm::ivec2(0, -1)};
+  bool ball = true;
+  glm::vec3 ball_position{3.0f, -8.0f, 7.5f};
+  float ball_radius = 2.0f;
+  float ground_height = -12.0f;
+  // Shapes besides the ball and the ground, in the cloth's coordinates.
+  ColliderSet colliders;
+  // Distance particles keep from each other and from triangles of the
+  // cloth they are not next to; 0 lets the cloth pass through itself. Must
+  // be below the particle spacing, width / resolution.
+  float self_collision_thickness = 0.0f;
+  // Sweep each step's motion, including drags between steps, for particles
+  // passing through triangles and edges through edges of the cloth, and
+  // stop them at the contact, so fast drags and large steps cannot tunnel
+  // through the cloth.
+  bool continuous_collision = false;
+  // Move the ball through every step, from where it is at the step's start
+  // to where it is at its end, and sweep particles against it and the other
+  // spheres for their first contact during the step, so a fast ball or
+  // large steps cannot carry particles through a sphere. Otherwise the ball
+  // moves once per frame and particles are pushed out of spheres only if
+  // they end a step inside.
+  bool swept_spheres = false;
+  // Error tolerances of the adaptive integrators, kept when Reset or
+  // LoadCheckpoint starts a new integrator.
+  AdaptiveTolerances tolerances;
+  // Integrate in the structure-of-arrays layout, see SoaLayoutIntegrator.
+  // The results are the same; RK4 and the other many-stage integrators run
+  // faster on large cloths. Implicit Euler and XPBD do not support it.
+  bool soa_layout = false;
+  // Checkpoint to start from, and to go back to on Reset, if not empty. It
+  // must come from a cloth of the same resolution.
+  std::string checkpoint;
+  // Take steps of exactly the integration step whatever the frame length,
+  // moving the ball before each one, so the states depend only on how many
+  // steps were taken and not on how frames split them. See Advance.
+  bool deterministic = false;
+};
+
+class ClothCheckpoint;
+
+// The cloth physics without any rendering or input: a pinned square of
+// particles joined by structural, shear and flex springs, a moving ball, the
+// ground plane and any other colliders. ClothNode draws and drives one of
+// these; it can also run on its own where no GL context exists.
+class ClothSimulation {
+ public:
+  // Receives the hash of the state after a step, see SetStateHashing.
+  using StateHashCallback =
+      std::function<void(long step, double time, uint64_t hash)>;
+
+  ClothSimulation(IntegratorType integrator_type,
+                  float integration_step,
+                  const ClothParameters& parameters = ClothParameters());
+
+  // Advances by one frame of delta_time seconds: moves the ball, then takes
+  // integration_step sized steps and carries the remainder over to the next
+  // frame. Adaptive integrators get the whole frame in one step. Returns the
+  // number of steps taken.
+  //
+  // In deterministic mode there are no shortened steps: frames shorter than
+  // a step only carry their time over, adaptive integrators get one
+  // integration step at a time, and the ball moves before every step rather
+  // than once per frame. Forces are always summed per particle in a fixed
+  // spring order, so no mode depends on the thread count.
+  int Advance(double delta_time);
+  // One integrator step of dt followed by the collision response.
+  void Step(float dt);
+  // Goes back to the start: the checkpoint given in the parameters, or else
+  // the flat cloth. Integrator history starts over.
+  void Reset();
+
+  // Writes everything that changes while the cloth runs, so it can be
+  // resumed later: particle state, time, pins and fixed particles, masses,
+  // spring parameters, wind, gravity and the ball. Throws
+  // std::runtime_error if the file cannot be written.
+  void SaveCheckpoint(const std::string& file_path) const;
+  // Restores a checkpoint of a cloth with the same resolution and springs.
+  // Integrator history, such as an adaptive step size, starts over. Throws
+  // std::runtime_error on mismatches, leaving the simulation unchanged.
+  void LoadCheckpoint(const ClothCheckpoint& checkpoint);
+
+  const ParticleState& GetState() const {
+    return state_;
+  }
+  const PendulumSystem& GetSystem() const {
+    return system_;
+  }
+  // Moves a particle by offset and adds offset to its velocity, as when the
+  // cloth is dragged with the mouse.
+  void DisplaceParticle(int index, const glm::vec3& offset);
+
+  int IndexOf(int row, int col) const;
+  int GetClothSize() const {
+    return cloth_size_;
+  }
+  float GetClothWidth() const {
+    return cloth_width_;
+  }
+  // Particle pairs joined by structural springs, in creation order.
+  const std::vector<std::pair<int, int>>& GetStructuralSprings() const {
+    return structural_springs_;
+  }
+  double GetTime() const {
+    return time_;
+  }
+  // A box the cloth stays inside in ordinary runs, as (min, max): its
+  // starting extent grown by its width on every side and down to the
+  // ground. Trajectories are quantized within it.
+  std::pair<glm::vec3, glm::vec3> GetBounds() const;
+
+  // Releases the pins one at a time, in order, then pins them all again.
+  void TogglePins();
+
+  bool GetBallState() const {
+    return ball_collision_;
+  }
+  void ToggleBall() {
+    ball_collision_ = !ball_collision_;
+  }
+  glm::vec3 GetBallPosition() const {
+    return ball_position_;
+  }
+  float GetBallRadius() const {
+    return ball_radius_;
+  }
+
+  glm::vec3 GetGravity() const {
+    return gravity_;
+  }
+  void SetGravity(const glm::vec3& gravity) {
+    gravity_ = gravity;
+    system_.UpdateGravity(gravity_);
+    integrator_->Invalidate();
+  }
+  bool GetWindState() const {
+    return system_.IsWindOn();
+  }
+  void ToggleWind() {
+    system_.ToggleWind();
+    integrator_->Invalidate();
+  }
+  float GetWindStrength() const {
+    return system_.GetWindStrength();
+  }
+  void SetWindStrength(float value) {
+    system_.SetWindStrength(value);
+    integrator_->Invalidate();
+  }
+  void SetThreadCount(int thread_count) {
+    system_.SetThreadCount(thread_count);
+  }
+  bool IsDeterministic() const {
+    return deterministic_;
+  }
+  void SetDeterministic(bool deterministic) {
+    deterministic_ = deterministic;
+  }
+  // Steps taken since construction, Reset or LoadCheckpoint.
+  long GetStepCount() const {
+    return step_count_;
+  }
+  // Calls callback with HashParticleState of the state after every
+  // interval-th step, so two runs can be compared step by step and the
+  // first divergent one found. An interval of 0 stops hashing.
+  void SetStateHashing(int interval, StateHashCallback callback);
+  const AdaptiveStepStats* GetAdaptiveStats() const {
+    return integrator_->GetAdaptiveStats();
+  }
+
+ private:
+  void AddSpring(int start, int end, float rest_length, float stiffness,
+                 bool structural);
+  void FixPins();
+  int PinIndex(const glm::ivec2& pin) const;
+  void CreateIntegrator();
+  void UpdateBall();
+  glm::vec3 GetBallPositionAt(double time) const;
+  // The collision passes return whether they moved or slowed any particle.
+  bool ResolveCollisions(float dt);
+  // Pushes apart particles closer than the thickness to other particles or
+  // to triangles, found through spatial hashes rebuilt from the current
+  // positions. Each particle's response only depends on the positions
+  // before the pass, so particles are handled in parallel.
+  bool ResolveSelfCollisions();
+  void ComputeSelfCollisionResponse(int index,
+                                    glm::vec3& position_change,
+                                    glm::vec3& velocity_change) const;
+  // Whether two particles are the same or grid neighbors, including
+  // diagonal ones, which springs already keep apart.
+  bool AreAdjacent(int a, int b) const;
+
+  // A vertex and a triangle, or two edges, whose motion over the step is
+  // checked for contact. See FindVertexTriangleImpact for the order.
+  struct ContactTest {
+    int particles[4];
+    bool edge_edge;
+  };
+  // Stops the contacts that moving from collision_free_positions_ to the
+  // current positions would make: impulses stop each contact's approach
+  // for a few rounds, and particles of contacts left over after that stay
+  // at their collision-free positions.
+  bool ResolveContinuousCollisions(float dt);
+  // Refits the BVH around the step's motion and finds the first contact of
+  // each pair of features that approach each other, into impact_found_
+  // and impacts_. Returns how many there are.
+  int FindImpacts(float tolerance);
+  // Finds the impacts of the current contact tests, or with only_reverted
+  // of those involving a particle marked in reverted_, keeping the others.
+  // Returns how many impacts there are in all.
+  int TestContacts(float tolerance, bool only_reverted);
+  // Appends the tests of triangle t's features against triangle u's and
+  // the other way around.
+  void AddContactTests(int t, int u);
+  bool FindImpact(const ContactTest& test,
+                  float tolerance,
+                  Impact& impact) const;
+  // Changes the particles' motion so the contact's features end the step
+  // apart along its normal. Returns false if they do already or no
+  // impulse can part them.
+  bool ApplyImpulse(const ContactTest& test,
+                    const Impact& impact,
+                    float tolerance,
+                    float dt);
+  // Whether the particle is pinned or on the ground, which holds it against
+  // being pushed down.
+  bool IsHeld(int particle) const;
+
+  int cloth_size_;
+  float cloth_width_;
+  float integration_step_;
+  glm::vec3 gravity_;
+  float ground_height_;
+  std::vector<glm::ivec2> pins_;
+
+  ParticleState state_;
+  std::vector<glm::vec3> initial_positions_;
+  std::vector<std::pair<int, int>> structural_springs_;
+  // Two per grid square, as ClothNode draws them.
+  std::vector<glm::ivec3> triangles_;
+  PendulumSystem system_;
+  IntegratorType integrator_type_;
+  AdaptiveTolerances tolerances_;
+  bool soa_layout_;
+  std::unique_ptr<IntegratorBase<PendulumSystem, ParticleState>> integrator_;
+  double time_;
+  float rollover_time_;
+  bool deterministic_;
+  long step_count_;
+  int hash_interval_;
+  StateHashCallback hash_callback_;
+  // Pins still holding; TogglePins releases pins_[pins_.size() - pinned_].
+  int pinned_;
+
+  glm::vec3 ball_start_pos_;
+  glm::vec3 ball_position_;
+  float ball_radius_;
+  bool ball_collision_;
+  // The parameters' colliders, the ball and the ground; the ball is the
+  // sphere ball_collider_, moved to ball_position_ before every use.
+  ColliderSet colliders_;
+  int ball_collider_;
+  bool swept_spheres_;
+  // Where the ball and the particles were at the start of the step, for
+  // sweeping them against spheres.
+  glm::vec3 ball_step_start_;
+  std::vector<glm::vec3> step_start_positions_;
+  float self_collision_thickness_;
+  SpatialHash particle_hash_;
+  SpatialHash triangle_hash_;
+  std::vector<glm::vec3> position_changes_;
+  std::vector<glm::vec3> velocity_changes_;
+  bool continuous_collision_;
+  // Bit i is set if the triangle tests its corner i as a vertex, bit 3 + i
+  // if it tests its edge from corner i to the next one. Each vertex and
+  // edge belongs to one triangle, so no feature pair is tested twice.
+  std::vector<uint8_t> triangle_features_;
+  TriangleBvh triangle_bvh_;
+  // Whether each triangle lies held on the ground, see IsHeld.
+  std::vector<uint8_t> resting_triangles_;
+  // Positions after the last step, where the next step's sweep starts.
+  std::vector<glm::vec3> collision_free_positions_;
+  std::vector<ContactTest> contact_tests_;
+  std::vector<Impact> impacts_;
+  std::vector<uint8_t> impact_found_;
+  // Particles the fail-safe has just sent back to their collision-free
+  // positions.
+  std::vector<uint8_t> reverted_;
+  // Mapped for as long as Reset may return to it.
+  std::shared_ptr<ClothCheckpoint> start_checkpoint_;
+};
+}  // namespace GLOO
+
+#endif
@@ -0,0 +1,689 @@
+#include "ColliderSet.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+#include "SimdKernels.hpp"
+
+namespace GLOO {
+namespace {
+// Particles that share a bounding box when checked against the colliders.
+const int kBlockSize = 64;
+
+// The widest lanes SimdKernels.hpp has, as a handful of operations the
+// kernels below are written in once. A Mask holds a comparison's result
+// per lane.
+#if defined(GLOO_SIMD_AVX)
+const int kLanes = 8;
+using Lanes = __m256;
+using Mask = __m256;
+inline Lanes Splat(float a) {
+  return _mm256_set1_ps(a);
+}
+inline Lanes Load(const float* p) {
+  return _mm256_load_ps(p);
+}
+inline void Store(float* p, Lanes a) {
+  _mm256_store_ps(p, a);
+}
+inline Lanes Add(Lanes a, Lanes b) {
+  return _mm256_add_ps(a, b);
+}
+inline Lanes Sub(Lanes a, Lanes b) {
+  return _mm256_sub_ps(a, b);
+}
+inline Lanes Mul(Lanes a, Lanes b) {
+  return _mm256_mul_ps(a, b);
+}
+inline Lanes Div(Lanes a, Lanes b) {
+  return _mm256_div_ps(a, b);
+}
+inline Lanes Sqrt(Lanes a) {
+  return _mm256_sqrt_ps(a);
+}
+inline Lanes Min(Lanes a, Lanes b) {
+  return _mm256_min_ps(a, b);
+}
+inline Lanes Max(Lanes a, Lanes b) {
+  return _mm256_max_ps(a, b);
+}
+inline Mask Less(Lanes a, Lanes b) {
+  return _mm256_cmp_ps(a, b, _CMP_LT_OQ);
+}
+inline Mask AtLeast(Lanes a, Lanes b) {
+  return _mm256_cmp_ps(a, b, _CMP_GE_OQ);
+}
+inline Mask And(Mask a, Mask b) {
+  return _mm256_and_ps(a, b);
+}
+inline bool Any(Mask m) {
+  return _mm256_movemask_ps(m) != 0;
+}
+// a where m is set, b elsewhere.
+inline Lanes Select(Mask m, Lanes a, Lanes b) {
+  return _mm256_blendv_ps(b, a, m);
+}
+#elif defined(GLOO_SIMD_SSE)
+const int kLanes = 4;
+using Lanes = __m128;
+using Mask = __m128;
+inline Lanes Splat(float a) {
+  return _mm_set1_ps(a);
+}
+inline Lanes Load(const float* p) {
+  return _mm_load_ps(p);
+}
+inline void Store(float* p, Lanes a) {
+  _mm_store_ps(p, a);
+}
+inline Lanes Add(Lanes a, Lanes b) {
+  return _mm_add_ps(a, b);
+}
+inline Lanes Sub(Lanes a, Lanes b) {
+  return _mm_sub_ps(a, b);
+}
+inline Lanes Mul(Lanes a, Lanes b) {
+  return _mm_mul_ps(a, b);
+}
+inline Lanes Div(Lanes a, Lanes b) {
+  return _mm_div_ps(a, b);
+}
+inline Lanes Sqrt(Lanes a) {
+  return _mm_sqrt_ps(a);
+}
+inline Lanes Min(Lanes a, Lanes b) {
+  return _mm_min_ps(a, b);
+}
+inline Lanes Max(Lanes a, Lanes b) {
+  return _mm_max_ps(a, b);
+}
+inline Mask Less(Lanes a, Lanes b) {
+  return _mm_cmplt_ps(a, b);
+}
+inline Mask AtLeast(Lanes a, Lanes b) {
+  return _mm_cmpge_ps(a, b);
+}
+inline Mask And(Mask a, Mask b) {
+  return _mm_and_ps(a, b);
+}
+inline bool Any(Mask m) {
+  return _mm_movemask_ps(m) != 0;
+}
+inline Lanes Select(Mask m, Lanes a, Lanes b) {
+  return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));
+}
+#else
+const int kLanes = 1;
+using Lanes = float;
+using Mask = bool;
+inline Lanes Splat(float a) {
+  return a;
+}
+inline Lanes Load(const float* p) {
+  return *p;
+}
+inline void Store(float* p, Lanes a) {
+  *p = a;
+}
+inline Lanes Add(Lanes a, Lanes b) {
+  return a + b;
+}
+inline Lanes Sub(Lanes a, Lanes b) {
+  return a - b;
+}
+inline Lanes Mul(Lanes a, Lanes b) {
+  return a * b;
+}
+inline Lanes Div(Lanes a, Lanes b) {
+  return a / b;
+}
+inline Lanes Sqrt(Lanes a) {
+  return std::sqrt(a);
+}
+inline Lanes Min(Lanes a, Lanes b) {
+  return std::min(a, b);
+}
+inline Lanes Max(Lanes a, Lanes b) {
+  return std::max(a, b);
+}
+inline Mask Less(Lanes a, Lanes b) {
+  return a < b;
+}
+inline Mask AtLeast(Lanes a, Lanes b) {
+  return a >= b;
+}
+inline Mask And(Mask a, Mask b) {
+  return a && b;
+}
+inline bool Any(Mask m) {
+  return m;
+}
+inline Lanes Select(Mask m, Lanes a, Lanes b) {
+  return m ? a : b;
+}
+#endif
+
+// A block's particles, one array per coordinate. Lanes past count hold a
+// copy of the first particle and are never written back.
+struct ParticleBlock {
+  alignas(kSimdAlignment) float positions[3][kBlockSize];
+  alignas(kSimdAlignment) float velocities[3][kBlockSize];
+  // Where the particles started the step, if they are swept.
+  alignas(kSimdAlignment) float start_positions[3][kBlockSize];
+  int count;
+  int padded_count;
+  glm::vec3 box_min;
+  glm::vec3 box_max;
+  glm::vec3 start_box_min;
+  glm::vec3 start_box_max;
+
+  static void FindBox(const float (&coordinates)[3][kBlockSize],
+                      int count,
+                      glm::vec3& box_min,
+                      glm::vec3& box_max) {
+    for (int axis = 0; axis < 3; axis++) {
+      float low = coordinates[axis][0];
+      float high = low;
+      for (int i = 1; i < count; i++) {
+        low = std::min(low, coordinates[axis][i]);
+        high = std::max(high, coordinates[axis][i]);
+      }
+      box_min[axis] = low;
+      box_max[axis] = high;
+    }
+  }
+  void UpdateBox() {
+    FindBox(positions, count, box_min, box_max);
+  }
+};
+
+// Moves the hit lanes of the block starting at i to new_positions. Pushes add
+// the move over the step to the velocity, stops replace the velocity by the
+// move's reverse over the step.
+void MoveLanes(ParticleBlock& block,
+               int i,
+               Mask hit,
+               const Lanes new_positions[3],
+               Lanes dt,
+               bool stop) {
+  for (int axis = 0; axis < 3; axis++) {
+    Lanes position = Load(block.positions[axis] + i);
+    Lanes velocity = Load(block.velocities[axis] + i);
+    Lanes new_velocity =
+        stop ? Div(Sub(position, new_positions[axis]), dt)
+             : Add(velocity, Div(Sub(new_positions[axis], position), dt));
+    Store(block.positions[axis] + i,
+          Select(hit, new_positions[axis], position));
+    Store(block.velocities[axis] + i, Select(hit, new_velocity, velocity));
+  }
+}
+
+// Pushes lanes closer than reach to the points c out to reach from them,
+// along the line from c. Returns whether any lane moved.
+bool PushFromPoints(ParticleBlock& block,
+                    int i,
+                    const Lanes c[3],
+                    Lanes reach,
+                    Lanes dt) {
+  Lanes d[3];
+  for (int axis = 0; axis < 3; axis++) {
+    d[axis] = Sub(Load(block.positions[axis] + i), c[axis]);
+  }
+  Lanes length2 = Add(Add(Mul(d[0], d[0]), Mul(d[1], d[1])), Mul(d[2], d[2]));
+  Lanes distance = Sqrt(length2);
+  // Particles right on the point have no direction to be pushed along.
+  Mask hit = And(Less(distance, reach), Less(Splat(0.0f), length2));
+  if (!Any(hit))
+    return false;
+  Lanes scale = Div(Splat(1.0f), distance);
+  Lanes new_positions[3];
+  for (int axis = 0; axis < 3; axis++) {
+    new_positions[axis] = Add(c[axis], Mul(Mul(d[axis], scale), reach));
+  }
+  MoveLanes(block, i, hit, new_positions, dt, false);
+  return true;
+}
+
+// Stops lanes whose motion relative to a sphere, moving from start_center
+// to center, first touches it during the step at that contact, plus their
+// remaining motion across the sphere's surface. Lanes that start inside are
+// left for the end of step push. Returns whether any lane moved.
+bool SweepAgainstSphere(ParticleBlock& block,
+                        int i,
+                        const Lanes start_center[3],
+                        const Lanes center[3],
+                        Lanes reach,
+                        Lanes dt) {
+  // The relative position goes from start to start + motion; the first t
+  // in [0, 1) at which its length is reach solves a t^2 + 2 b t + c = 0.
+  Lanes start[3];
+  Lanes motion[3];
+  for (int axis = 0; axis < 3; axis++) {
+    start[axis] = Sub(Load(block.start_positions[axis] + i),
+                      start_center[axis]);
+    motion[axis] = Sub(Sub(Load(block.positions[axis] + i), center[axis]),
+                       start[axis]);
+  }
+  Lanes a = Add(Add(Mul(motion[0], motion[0]), Mul(motion[1], motion[1])),
+                Mul(motion[2], motion[2]));
+  Lanes b = Add(Add(Mul(start[0], motion[0]), Mul(start[1], motion[1])),
+                Mul(start[2], motion[2]));
+  Lanes c = Sub(Add(Add(Mul(start[0], start[0]), Mul(start[1], start[1])),
+                    Mul(start[2], start[2])),
+                Mul(reach, reach));
+  Lanes zero = Splat(0.0f);
+  Lanes one = Splat(1.0f);
+  Lanes discriminant = Sub(Mul(b, b), Mul(a, c));
+  // Approaching from outside, along a line that reaches the sphere.
+  Mask hit = And(And(Less(zero, c), Less(b, zero)),
+                 AtLeast(discriminant, zero));
+  if (!Any(hit))
+    return false;
+  // Lanes that miss get a harmless time, so nothing below divides by zero
+  // or takes the root of a negative number.
+  a = Select(hit, a, one);
+  Lanes t = Div(Sub(Sub(zero, b), Sqrt(Max(discriminant, zero))), a);
+  hit = And(hit, Less(t, one));
+  if (!Any(hit))
+    return false;
+  t = Max(t, zero);
+  Lanes contact[3];
+  for (int axis = 0; axis < 3; axis++) {
+    contact[axis] = Add(start[axis], Mul(motion[axis], t));
+  }
+  // The rest of the motion, less its part along the contact normal.
+  Lanes rest = Sub(one, t);
+  Lanes along = zero;
+  for (int axis = 0; axis < 3; axis++) {
+    along = Add(along, Mul(Mul(motion[axis], rest), contact[axis]));
+  }
+  along = Div(along, Mul(reach, reach));
+  Lanes new_positions[3];
+  for (int axis = 0; axis < 3; axis++) {
+    Lanes slide = Sub(Mul(motion[axis], rest), Mul(contact[axis], along));
+    new_positions[axis] = Add(Add(center[axis], contact[axis]), slide);
+  }
+  MoveLanes(block, i, hit, new_positions, dt, false);
+  return true;
+}
+
+bool ResolveSphere(const SphereCollider& sphere,
+                   const glm::vec3& start_center,
+                   float margin,
+                   bool sweep,
+                   ParticleBlock& block,
+                   float dt) {
+  Lanes center[3] = {Splat(sphere.center.x), Splat(sphere.center.y),
+                     Splat(sphere.center.z)};
+  Lanes start[3] = {Splat(start_center.x), Splat(start_center.y),
+                    Splat(start_center.z)};
+  Lanes reach = Splat(sphere.radius + margin);
+  Lanes lanes_dt = Splat(dt);
+  bool moved = false;
+  for (int i = 0; i < block.padded_count; i += kLanes) {
+    if (sweep)
+      moved |= SweepAgainstSphere(block, i, start, center, reach, lanes_dt);
+    moved |= PushFromPoints(block, i, center, reach, lanes_dt);
+  }
+  return moved;
+}
+
+bool ResolveCapsule(const CapsuleCollider& capsule,
+                    float margin,
+                    ParticleBlock& block,
+                    float dt) {
+  glm::vec3 segment = capsule.end - capsule.start;
+  float length2 = glm::dot(segment, segment);
+  // A capsule of zero length is a sphere around its start.
+  Lanes inverse_length2 = Splat(length2 > 0.0f ? 1.0f / length2 : 0.0f);
+  Lanes start[3] = {Splat(capsule.start.x), Splat(capsule.start.y),
+                    Splat(capsule.start.z)};
+  Lanes axis_lanes[3] = {Splat(segment.x), Splat(segment.y),
+                         Splat(segment.z)};
+  Lanes reach = Splat(capsule.radius + margin);
+  Lanes lanes_dt = Splat(dt);
+  bool moved = false;
+  for (int i = 0; i < block.padded_count; i += kLanes) {
+    Lanes along = Splat(0.0f);
+    for (int axis = 0; axis < 3; axis++) {
+      Lanes d = Sub(Load(block.positions[axis] + i), start[axis]);
+      along = Add(along, Mul(d, axis_lanes[axis]));
+    }
+    Lanes t = Min(Max(Mul(along, inverse_length2), Splat(0.0f)), Splat(1.0f));
+    Lanes closest[3];
+    for (int axis = 0; axis < 3; axis++) {
+      closest[axis] = Add(start[axis], Mul(axis_lanes[axis], t));
+    }
+    moved |= PushFromPoints(block, i, closest, reach, lanes_dt);
+  }
+  return moved;
+}
+
+// Pushes particles inside the box grown by the margin out through the
+// nearest face.
+bool ResolveBox(const BoxCollider& box,
+                float margin,
+                ParticleBlock& block,
+                float dt) {
+  Lanes center[3] = {Splat(box.center.x), Splat(box.center.y),
+                     Splat(box.center.z)};
+  Lanes axes[3][3];
+  Lanes reach[3];
+  for (int k = 0; k < 3; k++) {
+    for (int axis = 0; axis < 3; axis++) {
+      axes[k][axis] = Splat(box.axes[k][axis]);
+    }
+    reach[k] = Splat(box.half_extents[k] + margin);
+  }
+  Lanes zero = Splat(0.0f);
+  Lanes lanes_dt = Splat(dt);
+  bool moved = false;
+  for (int i = 0; i < block.padded_count; i += kLanes) {
+    Lanes d[3];
+    for (int axis = 0; axis < 3; axis++) {
+      d[axis] = Sub(Load(block.positions[axis] + i), center[axis]);
+    }
+    // How far each lane is inside each pair of faces, and the move out
+    // through the nearer face of that pair.
+    Lanes depth[3];
+    Lanes push[3];
+    for (int k = 0; k < 3; k++) {
+      Lanes local = Add(Add(Mul(axes[k][0], d[0]), Mul(axes[k][1], d[1])),
+                        Mul(axes[k][2], d[2]));
+      depth[k] = Sub(reach[k], Max(local, Sub(zero, local)));
+      push[k] = Select(Less(local, zero), Sub(zero, depth[k]), depth[k]);
+    }
+    // Lanes inside all three pairs leave through the shallowest.
+    Mask hit = Less(zero, depth[0]);
+    Lanes shallowest = depth[0];
+    Lanes move[3];
+    for (int axis = 0; axis < 3; axis++) {
+      move[axis] = Mul(axes[0][axis], push[0]);
+    }
+    for (int k = 1; k < 3; k++) {
+      hit = And(hit, Less(zero, depth[k]));
+      Mask shallower = Less(depth[k], shallowest);
+      shallowest = Select(shallower, depth[k], shallowest);
+      for (int axis = 0; axis < 3; axis++) {
+        move[axis] =
+            Select(shallower, Mul(axes[k][axis], push[k]), move[axis]);
+      }
+    }
+    if (!Any(hit))
+      continue;
+    Lanes new_positions[3];
+    for (int axis = 0; axis < 3; axis++) {
+      new_positions[axis] = Add(Load(block.positions[axis] + i), move[axis]);
+    }
+    MoveLanes(block, i, hit, new_positions, lanes_dt, false);
+    moved = true;
+  }
+  return moved;
+}
+
+// Fields are sampled at scattered points, which SIMD lanes cannot load
+// together, so particles are taken one at a time.
+bool ResolveField(const SignedDistanceField& field,
+                  float margin,
+                  ParticleBlock& block,
+                  float dt) {
+  bool moved = false;
+  for (int i = 0; i < block.count; i++) {
+    glm::vec3 position(block.positions[0][i], block.positions[1][i],
+                       block.positions[2][i]);
+    glm::vec3 gradient;
+    float distance = field.Evaluate(position, gradient);
+    float length = glm::length(gradient);
+    // Beyond the band, and right on ridges of the field, there is no
+    // direction to push along.
+    if (!(distance < margin) || !(length > 0.0f))
+      continue;
+    glm::vec3 move = gradient * ((margin - distance) / length);
+    for (int axis = 0; axis < 3; axis++) {
+      block.positions[axis][i] = position[axis] + move[axis];
+      block.velocities[axis][i] += move[axis] / dt;
+    }
+    moved = true;
+  }
+  return moved;
+}
+
+bool ResolvePlane(const PlaneCollider& plane,
+                  float margin,
+                  ParticleBlock& block,
+                  float dt) {
+  Lanes normal[3] = {Splat(plane.normal.x), Splat(plane.normal.y),
+                     Splat(plane.normal.z)};
+  Lanes level = Splat(plane.offset + margin);
+  Lanes lanes_dt = Splat(dt);
+  bool moved = false;
+  for (int i = 0; i < block.padded_count; i += kLanes) {
+    Lanes p[3];
+    for (int axis = 0; axis < 3; axis++) {
+      p[axis] = Load(block.positions[axis] + i);
+    }
+    Lanes height = Add(Add(Mul(normal[0], p[0]), Mul(normal[1], p[1])),
+                       Mul(normal[2], p[2]));
+    Mask hit = Less(height, level);
+    if (!Any(hit))
+      continue;
+    Lanes push = Sub(level, height);
+    Lanes new_positions[3];
+    for (int axis = 0; axis < 3; axis++) {
+      new_positions[axis] = Add(p[axis], Mul(normal[axis], push));
+    }
+    MoveLanes(block, i, hit, new_positions, lanes_dt, true);
+    moved = true;
+  }
+  return moved;
+}
+
+bool BoxesOverlap(const glm::vec3& min_a,
+                  const glm::vec3& max_a,
+                  const glm::vec3& min_b,
+                  const glm::vec3& max_b) {
+  return min_a.x <= max_b.x && min_b.x <= max_a.x && min_a.y <= max_b.y &&
+         min_b.y <= max_a.y && min_a.z <= max_b.z && min_b.z <= max_a.z;
+}
+}  // namespace
+
+ColliderSet::Extent ColliderSet::MakeExtent(const glm::vec3& box_min,
+                                            const glm::vec3& box_max,
+                                            float margin) const {
+  if (margin < 0.0f) {
+    throw std::runtime_error("Collider margins must not be negative!");
+  }
+  return Extent{margin, true, box_min - glm::vec3(margin),
+                box_max + glm::vec3(margin)};
+}
+
+int ColliderSet::AddSphere(const SphereCollider& sphere, float margin) {
+  if (!(sphere.radius > 0.0f)) {
+    throw std::runtime_error("Sphere radius must be positive!");
+  }
+  sphere_extents_.push_back(
+      MakeExtent(glm::vec3(0.0f), glm::vec3(0.0f), margin));
+  spheres_.push_back(sphere);
+  sphere_starts_.push_back(sphere.center);
+  SetSphere(int(spheres_.size()) - 1, sphere);
+  return int(spheres_.size()) - 1;
+}
+
+int ColliderSet::AddCapsule(const CapsuleCollider& capsule, float margin) {
+  if (!(capsule.radius > 0.0f)) {
+    throw std::runtime_error("Capsule radius must be positive!");
+  }
+  glm::vec3 radius(capsule.radius);
+  capsule_extents_.push_back(
+      MakeExtent(glm::min(capsule.start, capsule.end) - radius,
+                 glm::max(capsule.start, capsule.end) + radius, margin));
+  capsules_.push_back(capsule);
+  return int(capsules_.size()) - 1;
+}
+
+int ColliderSet::AddBox(const BoxCollider& box, float margin) {
+  if (!(box.half_extents.x > 0.0f && box.half_extents.y > 0.0f &&
+        box.half_extents.z > 0.0f)) {
+    throw std::runtime_error("Box half extents must be positive!");
+  }
+  // Each axis reaches the sum of the box axes' extents along it.
+  glm::vec3 reach(0.0f);
+  for (int k = 0; k < 3; k++) {
+    reach += glm::abs(box.axes[k]) * box.half_extents[k];
+  }
+  box_extents_.push_back(
+      MakeExtent(box.center - reach, box.center + reach, margin));
+  boxes_.push_back(box);
+  return int(boxes_.size()) - 1;
+}
+
+int ColliderSet::AddField(std::shared_ptr<const SignedDistanceField> field,
+                          float margin) {
+  if (field == nullptr) {
+    throw std::runtime_error("Field collider has no field!");
+  }
+  if (!(margin < field->GetBand())) {
+    throw std::runtime_error(
+        "Field collider margin must be within the field's band!");
+  }
+  field_extents_.push_back(
+      MakeExtent(field->GetBoxMin(), field->GetBoxMax(), margin));
+  fields_.push_back(std::move(field));
+  return int(fields_.size()) - 1;
+}
+
+int ColliderSet::AddPlane(const PlaneCollider& plane, float margin) {
+  float length = glm::length(plane.normal);
+  if (!(length > 0.0f)) {
+    throw std::runtime_error("Plane normal must not be zero!");
+  }
+  plane_extents_.push_back(
+      MakeExtent(glm::vec3(0.0f), glm::vec3(0.0f), margin));
+  planes_.push_back(PlaneCollider{plane.normal / length, plane.offset});
+  return int(planes_.size()) - 1;
+}
+
+void ColliderSet::SetSphere(int index, const SphereCollider& sphere) {
+  SetSphere(index, sphere, sphere.center);
+}
+
+void ColliderSet::SetSphere(int index,
+                            const SphereCollider& sphere,
+                            const glm::vec3& start_center) {
+  if (!(sphere.radius > 0.0f)) {
+    throw std::runtime_error("Sphere radius must be positive!");
+  }
+  Extent& extent = sphere_extents_[index];
+  glm::vec3 reach(sphere.radius + extent.margin);
+  extent.box_min = glm::min(sphere.center, start_center) - reach;
+  extent.box_max = glm::max(sphere.center, start_center) + reach;
+  spheres_[index] = sphere;
+  sphere_starts_[index] = start_center;
+}
+
+void ColliderSet::SetSphereActive(int index, bool active) {
+  sphere_extents_[index].active = active;
+}
+
+bool ColliderSet::Resolve(std::vector<glm::vec3>& positions,
+                          std::vector<glm::vec3>& velocities,
+                          int begin,
+                          int end,
+                          float dt,
+                          const std::vector<glm::vec3>* start_positions) const {
+  bool sweep = start_positions != nullptr;
+  bool any_moved = false;
+  ParticleBlock block;
+  for (int first = begin; first < end; first += kBlockSize) {
+    block.count = std::min(kBlockSize, end - first);
+    block.padded_count = (block.count + kLanes - 1) / kLanes * kLanes;
+    for (int i = 0; i < block.padded_count; i++) {
+      int particle = first + (i < block.count ? i : 0);
+      for (int axis = 0; axis < 3; axis++) {
+        block.positions[axis][i] = positions[particle][axis];
+        block.velocities[axis][i] = velocities[particle][axis];
+        if (sweep)
+          block.start_positions[axis][i] = (*start_positions)[particle][axis];
+      }
+    }
+    block.UpdateBox();
+    if (sweep) {
+      ParticleBlock::FindBox(block.start_positions, block.count,
+                             block.start_box_min, block.start_box_max);
+    }
+
+    // A collider that moves particles can move them out of the box, which
+    // is then grown for the colliders after it.
+    bool moved = false;
+    auto resolved = [&](bool collider_moved) {
+      if (collider_moved) {
+        block.UpdateBox();
+        moved = true;
+      }
+    };
+    for (size_t c = 0; c < spheres_.size(); c++) {
+      const Extent& extent = sphere_extents_[c];
+      // Swept particles can touch a sphere anywhere along their way.
+      glm::vec3 box_min = block.box_min;
+      glm::vec3 box_max = block.box_max;
+      if (sweep) {
+        box_min = glm::min(box_min, block.start_box_min);
+        box_max = glm::max(box_max, block.start_box_max);
+      }
+      if (extent.active &&
+          BoxesOverlap(box_min, box_max, extent.box_min, extent.box_max)) {
+        resolved(ResolveSphere(spheres_[c], sphere_starts_[c], extent.margin,
+                               sweep, block, dt));
+      }
+    }
+    for (size_t c = 0; c < capsules_.size(); c++) {
+      const Extent& extent = capsule_extents_[c];
+      if (extent.active && BoxesOverlap(block.box_min, block.box_max,
+                                        extent.box_min, extent.box_max)) {
+        resolved(ResolveCapsule(capsules_[c], extent.margin, block, dt));
+      }
+    }
+    for (size_t c = 0; c < boxes_.size(); c++) {
+      const Extent& extent = box_extents_[c];
+      if (extent.active && BoxesOverlap(block.box_min, block.box_max,
+                                        extent.box_min, extent.box_max)) {
+        resolved(ResolveBox(boxes_[c], extent.margin, block, dt));
+      }
+    }
+    for (size_t c = 0; c < fields_.size(); c++) {
+      const Extent& extent = field_extents_[c];
+      if (extent.active && BoxesOverlap(block.box_min, block.box_max,
+                                        extent.box_min, extent.box_max)) {
+        resolved(ResolveField(*fields_[c], extent.margin, block, dt));
+      }
+    }
+    for (size_t c = 0; c < planes_.size(); c++) {
+      const Extent& extent = plane_extents_[c];
+      const PlaneCollider& plane = planes_[c];
+      // The box corner lowest along the normal.
+      glm::vec3 lowest;
+      for (int axis = 0; axis < 3; axis++) {
+        lowest[axis] = plane.normal[axis] > 0.0f ? block.box_min[axis]
+                                                 : block.box_max[axis];
+      }
+      if (extent.active &&
+          glm::dot(plane.normal, lowest) < plane.offset + extent.margin) {
+        resolved(ResolvePlane(plane, extent.margin, block, dt));
+      }
+    }
+
+    if (!moved)
+      continue;
+    any_moved = true;
+    for (int i = 0; i < block.count; i++) {
+      for (int axis = 0; axis < 3; axis++) {
+        positions[first + i][axis] = block.positions[axis][i];
+        velocities[first + i][axis] = block.velocities[axis][i];
+      }
+    }
+  }
+  return any_moved;
+}
+}  // namespace GLOO
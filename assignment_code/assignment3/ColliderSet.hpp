@@ -0,0 +1,142 @@
+#ifndef COLLIDER_SET_H_
+#define COLLIDER_SET_H_
+
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "SignedDistanceField.hpp"
+
+namespace GLOO {
+struct SphereCollider {
+  glm::vec3 center;
+  float radius;
+};
+
+// The points within radius of the segment from start to end.
+struct CapsuleCollider {
+  glm::vec3 start;
+  glm::vec3 end;
+  float radius;
+};
+
+// The columns of axes are the box's unit axes, along which it reaches
+// half_extents from its center.
+struct BoxCollider {
+  glm::vec3 center;
+  glm::mat3 axes;
+  glm::vec3 half_extents;
+};
+
+// The solid half-space dot(normal, x) < offset, with a unit normal.
+struct PlaneCollider {
+  glm::vec3 normal;
+  float offset;
+};
+
+// Static shapes that particles are kept out of, each by a margin outside its
+// surface. Particles inside a sphere, capsule or box are moved to the
+// nearest point a margin outside it, and their velocities gain the move
+// divided by the step. Signed distance fields, such as those of meshes,
+// move particles closer than the margin along the field's gradient, and
+// the same way. Planes stop the particles they catch as the ground always
+// has: the particles land on the plane a margin above it and keep only the
+// velocity of the move's reverse.
+//
+// Given where particles started the step, Resolve also sweeps them against
+// spheres moving on a straight line from their start centers, and stops
+// particles that touch a sphere during the step at the first contact,
+// where they keep only the motion across the sphere's surface. This stops
+// fast spheres and particles passing through each other within one step.
+//
+// Resolve checks blocks of particles against the colliders whose bounds
+// reach the block's bounding box and handles each block's particles in SIMD
+// lanes; fields are looked up one particle at a time. Every particle meets
+// the spheres, capsules, boxes, fields and planes in that order, and within
+// each kind in the order they were added, so the result does not depend on
+// how particles are split into blocks or ranges.
+class ColliderSet {
+ public:
+  // Each Add returns the new collider's index among those of its kind.
+  // Throws std::runtime_error for shapes without a size or a plane without
+  // a normal.
+  int AddSphere(const SphereCollider& sphere, float margin);
+  int AddCapsule(const CapsuleCollider& capsule, float margin);
+  int AddBox(const BoxCollider& box, float margin);
+  // Particles within the field's band only are pushed out, so the band
+  // must be wider than the margin.
+  int AddField(std::shared_ptr<const SignedDistanceField> field,
+               float margin);
+  // The normal need not be of unit length.
+  int AddPlane(const PlaneCollider& plane, float margin);
+
+  // Moves a sphere, as for the cloth's ball, which then stands still over
+  // the step.
+  void SetSphere(int index, const SphereCollider& sphere);
+  // Places a sphere that moved from start_center to sphere.center over the
+  // step.
+  void SetSphere(int index,
+                 const SphereCollider& sphere,
+                 const glm::vec3& start_center);
+  // Inactive colliders are skipped by Resolve. Colliders start active.
+  void SetSphereActive(int index, bool active);
+
+  const std::vector<SphereCollider>& GetSpheres() const {
+    return spheres_;
+  }
+  const std::vector<CapsuleCollider>& GetCapsules() const {
+    return capsules_;
+  }
+  const std::vector<BoxCollider>& GetBoxes() const {
+    return boxes_;
+  }
+  const std::vector<std::shared_ptr<const SignedDistanceField>>& GetFields()
+      const {
+    return fields_;
+  }
+  const std::vector<PlaneCollider>& GetPlanes() const {
+    return planes_;
+  }
+
+  // Resolves particles begin to end - 1 against every active collider after
+  // a step of dt, sweeping them against spheres from start_positions if it
+  // is not null. Returns whether any particle was moved. Particles are
+  // independent of each other, so disjoint ranges can be resolved in
+  // parallel.
+  bool Resolve(std::vector<glm::vec3>& positions,
+               std::vector<glm::vec3>& velocities,
+               int begin,
+               int end,
+               float dt,
+               const std::vector<glm::vec3>* start_positions = nullptr) const;
+
+ private:
+  // A collider's margin, whether it is active, and the box its surface
+  // grown by the margin stays inside, which particles outside of cannot
+  // touch it. Planes have no box; a moving sphere's covers its sweep.
+  struct Extent {
+    float margin;
+    bool active;
+    glm::vec3 box_min;
+    glm::vec3 box_max;
+  };
+  Extent MakeExtent(const glm::vec3& box_min,
+                    const glm::vec3& box_max,
+                    float margin) const;
+
+  std::vector<SphereCollider> spheres_;
+  std::vector<glm::vec3> sphere_starts_;
+  std::vector<Extent> sphere_extents_;
+  std::vector<CapsuleCollider> capsules_;
+  std::vector<Extent> capsule_extents_;
+  std::vector<BoxCollider> boxes_;
+  std::vector<Extent> box_extents_;
+  std::vector<std::shared_ptr<const SignedDistanceField>> fields_;
+  std::vector<Extent> field_extents_;
+  std::vector<PlaneCollider> planes_;
+  std::vector<Extent> plane_extents_;
+};
+}  // namespace GLOO
+
+#endif
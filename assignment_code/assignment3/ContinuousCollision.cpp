@@ -0,0 +1,348 @@
+#include "ContinuousCollision.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace GLOO {
+namespace {
+const int kBisectionSteps = 40;
+// Points whose triple product stays below this fraction of the cube of
+// their spread over the whole step count as moving in one plane, where
+// float rounding alone decides the roots.
+const double kCoplanarTolerance = 1e-6;
+
+// Closest points p0 + s * (p1 - p0) and q0 + t * (q1 - q0) of two segments
+// (Ericson, Real-Time Collision Detection, 5.1.9).
+void ClosestPointsOnSegments(const glm::vec3& p0,
+                             const glm::vec3& p1,
+                             const glm::vec3& q0,
+                             const glm::vec3& q1,
+                             float& s,
+                             float& t) {
+  const float kEpsilon = 1e-12f;
+  glm::vec3 d1 = p1 - p0;
+  glm::vec3 d2 = q1 - q0;
+  glm::vec3 r = p0 - q0;
+  float a = glm::dot(d1, d1);
+  float e = glm::dot(d2, d2);
+  float f = glm::dot(d2, r);
+  if (a <= kEpsilon && e <= kEpsilon) {
+    s = t = 0.0f;
+    return;
+  }
+  if (a <= kEpsilon) {
+    s = 0.0f;
+    t = glm::clamp(f / e, 0.0f, 1.0f);
+    return;
+  }
+  float c = glm::dot(d1, r);
+  if (e <= kEpsilon) {
+    t = 0.0f;
+    s = glm::clamp(-c / a, 0.0f, 1.0f);
+    return;
+  }
+  float b = glm::dot(d1, d2);
+  float denominator = a * e - b * b;
+  s = denominator != 0.0f ? glm::clamp((b * f - c * e) / denominator, 0.0f, 1.0f)
+                          : 0.0f;
+  t = (b * s + f) / e;
+  if (t < 0.0f) {
+    t = 0.0f;
+    s = glm::clamp(-c / a, 0.0f, 1.0f);
+  } else if (t > 1.0f) {
+    t = 1.0f;
+    s = glm::clamp((b - c) / a, 0.0f, 1.0f);
+  }
+}
+
+double EvaluateCubic(const double coefficients[4], double t) {
+  return ((coefficients[3] * t + coefficients[2]) * t + coefficients[1]) * t +
+         coefficients[0];
+}
+
+// Times in [0, 1], ascending, at which the four points moving from start to
+// end are coplanar: the roots of the triple product of their differences.
+// Solved in double, as the coefficients cancel badly in float for the
+// nearly flat configurations cloth spends its time in.
+int FindCoplanarTimes(const glm::vec3 start[4],
+                      const glm::vec3 end[4],
+                      double times[3]) {
+  glm::dvec3 e[3];
+  glm::dvec3 de[3];
+  double spread = 0.0;
+  for (int i = 0; i < 3; i++) {
+    e[i] = glm::dvec3(start[i + 1]) - glm::dvec3(start[0]);
+    de[i] = glm::dvec3(end[i + 1]) - glm::dvec3(end[0]) - e[i];
+    spread = std::max(spread, std::max(glm::length(e[i]), glm::length(de[i])));
+  }
+  // cross(e0 + t de0, e1 + t de1) = c0 + t c1 + t^2 c2
+  glm::dvec3 c0 = glm::cross(e[0], e[1]);
+  glm::dvec3 c1 = glm::cross(e[0], de[1]) + glm::cross(de[0], e[1]);
+  glm::dvec3 c2 = glm::cross(de[0], de[1]);
+  double coefficients[4] = {
+      glm::dot(c0, e[2]), glm::dot(c1, e[2]) + glm::dot(c0, de[2]),
+      glm::dot(c2, e[2]) + glm::dot(c1, de[2]), glm::dot(c2, de[2])};
+  double limit = kCoplanarTolerance * spread * spread * spread;
+  if (std::abs(coefficients[0]) <= limit && std::abs(coefficients[1]) <= limit &&
+      std::abs(coefficients[2]) <= limit && std::abs(coefficients[3]) <= limit) {
+    return 0;
+  }
+  // The cubic lies within the hull of its Bernstein coefficients over
+  // [0, 1], so if they share a sign it has no root there. This rejects most
+  // feature pairs of a smooth cloth before any root is looked for.
+  double bernstein[4] = {
+      coefficients[0], coefficients[0] + coefficients[1] / 3.0,
+      coefficients[0] + (2.0 * coefficients[1] + coefficients[2]) / 3.0,
+      coefficients[0] + coefficients[1] + coefficients[2] + coefficients[3]};
+  if ((bernstein[0] > 0.0 && bernstein[1] > 0.0 && bernstein[2] > 0.0 &&
+       bernstein[3] > 0.0) ||
+      (bernstein[0] < 0.0 && bernstein[1] < 0.0 && bernstein[2] < 0.0 &&
+       bernstein[3] < 0.0)) {
+    return 0;
+  }
+
+  // Split [0, 1] where the derivative vanishes; the cubic is monotonic in
+  // between, so each piece holds at most one root.
+  double breaks[4] = {0.0, 0.0, 0.0, 1.0};
+  int break_count = 1;
+  double a = 3.0 * coefficients[3];
+  double b = 2.0 * coefficients[2];
+  double c = coefficients[1];
+  if (a != 0.0) {
+    double discriminant = b * b - 4.0 * a * c;
+    if (discriminant > 0.0) {
+      double root = std::sqrt(discriminant);
+      double r0 = (-b - root) / (2.0 * a);
+      double r1 = (-b + root) / (2.0 * a);
+      if (r0 > r1)
+        std::swap(r0, r1);
+      if (r0 > 0.0 && r0 < 1.0)
+        breaks[break_count++] = r0;
+      if (r1 > 0.0 && r1 < 1.0)
+        breaks[break_count++] = r1;
+    }
+  } else if (b != 0.0) {
+    double r = -c / b;
+    if (r > 0.0 && r < 1.0)
+      breaks[break_count++] = r;
+  }
+  breaks[break_count] = 1.0;
+
+  int count = 0;
+  for (int piece = 0; piece < break_count; piece++) {
+    double lo = breaks[piece];
+    double hi = breaks[piece + 1];
+    double f_lo = EvaluateCubic(coefficients, lo);
+    double f_hi = EvaluateCubic(coefficients, hi);
+    if (f_lo == 0.0) {
+      if (count == 0 || times[count - 1] != lo)
+        times[count++] = lo;
+      continue;
+    }
+    if (f_hi == 0.0) {
+      times[count++] = hi;
+      continue;
+    }
+    if ((f_lo < 0.0) == (f_hi < 0.0))
+      continue;
+    for (int step = 0; step < kBisectionSteps; step++) {
+      double middle = 0.5 * (lo + hi);
+      double f_middle = EvaluateCubic(coefficients, middle);
+      if ((f_middle < 0.0) == (f_lo < 0.0)) {
+        lo = middle;
+        f_lo = f_middle;
+      } else {
+        hi = middle;
+      }
+    }
+    times[count++] = 0.5 * (lo + hi);
+  }
+  return count;
+}
+
+// Whether the swept boxes of the two features, particles [0, split) and
+// [split, 4), come within tolerance of each other.
+bool SweptBoxesOverlap(const glm::vec3 start[4],
+                       const glm::vec3 end[4],
+                       int split,
+                       float tolerance) {
+  for (int axis = 0; axis < 3; axis++) {
+    float min_a = std::min(start[0][axis], end[0][axis]);
+    float max_a = std::max(start[0][axis], end[0][axis]);
+    for (int i = 1; i < split; i++) {
+      min_a = std::min(min_a, std::min(start[i][axis], end[i][axis]));
+      max_a = std::max(max_a, std::max(start[i][axis], end[i][axis]));
+    }
+    float min_b = std::min(start[split][axis], end[split][axis]);
+    float max_b = std::max(start[split][axis], end[split][axis]);
+    for (int i = split + 1; i < 4; i++) {
+      min_b = std::min(min_b, std::min(start[i][axis], end[i][axis]));
+      max_b = std::max(max_b, std::max(start[i][axis], end[i][axis]));
+    }
+    if (min_a > max_b + tolerance || min_b > max_a + tolerance)
+      return false;
+  }
+  return true;
+}
+
+glm::vec3 RelativePosition(const glm::vec3 x[4], const glm::vec4& weights) {
+  return weights[0] * x[0] + weights[1] * x[1] + weights[2] * x[2] +
+         weights[3] * x[3];
+}
+
+// Fills in impact's normal from the contact's normal, which may be zero or
+// point either way, by pointing it along the features' separation at the
+// start. Returns false if no direction can be told.
+bool OrientNormal(const glm::vec3& contact_normal,
+                  const glm::vec3 start[4],
+                  const glm::vec3 end[4],
+                  Impact& impact) {
+  glm::vec3 separation = RelativePosition(start, impact.weights);
+  glm::vec3 normal = contact_normal;
+  if (glm::dot(normal, normal) == 0.0f)
+    normal = separation;
+  // Features that start in contact are pushed against their approach.
+  if (glm::dot(separation, separation) == 0.0f)
+    separation = separation - RelativePosition(end, impact.weights);
+  float length = glm::length(normal);
+  if (length == 0.0f || glm::dot(separation, separation) == 0.0f)
+    return false;
+  impact.normal = normal / length;
+  if (glm::dot(impact.normal, separation) < 0.0f)
+    impact.normal = -impact.normal;
+  return true;
+}
+
+void PositionsAt(const glm::vec3 start[4],
+                 const glm::vec3 end[4],
+                 float time,
+                 glm::vec3 positions[4]) {
+  for (int i = 0; i < 4; i++)
+    positions[i] = start[i] + time * (end[i] - start[i]);
+}
+}  // namespace
+
+glm::vec3 ClosestPointOnTriangle(const glm::vec3& p,
+                                 const glm::vec3& a,
+                                 const glm::vec3& b,
+                                 const glm::vec3& c,
+                                 glm::vec3& weights) {
+  glm::vec3 ab = b - a;
+  glm::vec3 ac = c - a;
+  glm::vec3 ap = p - a;
+  float d1 = glm::dot(ab, ap);
+  float d2 = glm::dot(ac, ap);
+  if (d1 <= 0.0f && d2 <= 0.0f) {
+    weights = glm::vec3(1.0f, 0.0f, 0.0f);
+    return a;
+  }
+  glm::vec3 bp = p - b;
+  float d3 = glm::dot(ab, bp);
+  float d4 = glm::dot(ac, bp);
+  if (d3 >= 0.0f && d4 <= d3) {
+    weights = glm::vec3(0.0f, 1.0f, 0.0f);
+    return b;
+  }
+  float vc = d1 * d4 - d3 * d2;
+  if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+    float v = d1 / (d1 - d3);
+    weights = glm::vec3(1.0f - v, v, 0.0f);
+    return a + v * ab;
+  }
+  glm::vec3 cp = p - c;
+  float d5 = glm::dot(ab, cp);
+  float d6 = glm::dot(ac, cp);
+  if (d6 >= 0.0f && d5 <= d6) {
+    weights = glm::vec3(0.0f, 0.0f, 1.0f);
+    return c;
+  }
+  float vb = d5 * d2 - d1 * d6;
+  if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+    float w = d2 / (d2 - d6);
+    weights = glm::vec3(1.0f - w, 0.0f, w);
+    return a + w * ac;
+  }
+  float va = d3 * d6 - d5 * d4;
+  if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f) {
+    float w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+    weights = glm::vec3(0.0f, 1.0f - w, w);
+    return b + w * (c - b);
+  }
+  float denominator = 1.0f / (va + vb + vc);
+  float v = vb * denominator;
+  float w = vc * denominator;
+  weights = glm::vec3(1.0f - v - w, v, w);
+  return a + v * ab + w * ac;
+}
+
+bool FindVertexTriangleImpact(const glm::vec3 start[4],
+                              const glm::vec3 end[4],
+                              float tolerance,
+                              Impact& impact) {
+  if (!SweptBoxesOverlap(start, end, 1, tolerance))
+    return false;
+  double times[4];
+  int count = FindCoplanarTimes(start, end, times);
+  if (count == 0 && !SweptBoxesOverlap(end, end, 1, tolerance))
+    return false;
+  glm::vec3 weights;
+  glm::vec3 offset = start[0] - ClosestPointOnTriangle(start[0], start[1],
+                                                       start[2], start[3],
+                                                       weights);
+  if (glm::dot(offset, offset) <= tolerance * tolerance)
+    return false;
+  // Features can also come within tolerance without passing through each
+  // other's plane, so the end of the step is checked last.
+  if (count == 0 || times[count - 1] != 1.0)
+    times[count++] = 1.0;
+  for (int i = 0; i < count; i++) {
+    glm::vec3 x[4];
+    PositionsAt(start, end, float(times[i]), x);
+    glm::vec3 closest = ClosestPointOnTriangle(x[0], x[1], x[2], x[3], weights);
+    offset = x[0] - closest;
+    if (glm::dot(offset, offset) > tolerance * tolerance)
+      continue;
+    impact.time = float(times[i]);
+    impact.weights = glm::vec4(1.0f, -weights.x, -weights.y, -weights.z);
+    if (OrientNormal(glm::cross(x[2] - x[1], x[3] - x[1]), start, end, impact))
+      return true;
+  }
+  return false;
+}
+
+bool FindEdgeEdgeImpact(const glm::vec3 start[4],
+                        const glm::vec3 end[4],
+                        float tolerance,
+                        Impact& impact) {
+  if (!SweptBoxesOverlap(start, end, 2, tolerance))
+    return false;
+  double times[4];
+  int count = FindCoplanarTimes(start, end, times);
+  if (count == 0 && !SweptBoxesOverlap(end, end, 2, tolerance))
+    return false;
+  float s;
+  float t;
+  ClosestPointsOnSegments(start[0], start[1], start[2], start[3], s, t);
+  glm::vec3 offset = (start[0] + s * (start[1] - start[0])) -
+                     (start[2] + t * (start[3] - start[2]));
+  if (glm::dot(offset, offset) <= tolerance * tolerance)
+    return false;
+  if (count == 0 || times[count - 1] != 1.0)
+    times[count++] = 1.0;
+  for (int i = 0; i < count; i++) {
+    glm::vec3 x[4];
+    PositionsAt(start, end, float(times[i]), x);
+    ClosestPointsOnSegments(x[0], x[1], x[2], x[3], s, t);
+    offset = (x[0] + s * (x[1] - x[0])) - (x[2] + t * (x[3] - x[2]));
+    if (glm::dot(offset, offset) > tolerance * tolerance)
+      continue;
+    impact.time = float(times[i]);
+    impact.weights = glm::vec4(1.0f - s, s, t - 1.0f, -t);
+    // Parallel edges have no normal of their own; OrientNormal falls back
+    // to their separation.
+    if (OrientNormal(glm::cross(x[1] - x[0], x[3] - x[2]), start, end, impact))
+      return true;
+  }
+  return false;
+}
+}  // namespace GLOO
@@ -0,0 +1,51 @@
+#ifndef CONTINUOUS_COLLISION_H_
+#define CONTINUOUS_COLLISION_H_
+
+#include <glm/glm.hpp>
+
+namespace GLOO {
+// A contact between two features of moving particles, found by the
+// continuous tests below. At time, a fraction of the step, the relative
+// position sum_i weights[i] * x_i of the four particles involved is within
+// the tolerance of zero; a time of 1 means the features end the step close
+// without having passed through each other. normal is the direction the
+// first feature lay from the second at the start of the step; pushing the
+// particles apart along it undoes the contact.
+struct Impact {
+  float time;
+  glm::vec3 normal;
+  glm::vec4 weights;
+};
+
+// The point of triangle abc closest to p, with its barycentric coordinates
+// in weights (Ericson, Real-Time Collision Detection, 5.1.5).
+glm::vec3 ClosestPointOnTriangle(const glm::vec3& p,
+                                 const glm::vec3& a,
+                                 const glm::vec3& b,
+                                 const glm::vec3& c,
+                                 glm::vec3& weights);
+
+// Continuous tests of four particles that each move on a straight line from
+// start[i] to end[i] over a step. Features can only pass through each other
+// when the four are coplanar, so the cubic in time that measures that is
+// solved, and its roots in the step, then the end of the step, are checked
+// in order for the features being within tolerance of each other. Motion
+// that keeps the features in one plane throughout, such as cloth sliding
+// flat over itself, is not caught, and neither are features already within
+// tolerance at the start, whose contact the step did not make; proximity
+// tests such as the cloth's self-collision thickness cover both.
+
+// Particle 0 against the triangle of particles 1, 2 and 3. Returns whether
+// they come within tolerance, with the first such time in impact.
+bool FindVertexTriangleImpact(const glm::vec3 start[4],
+                              const glm::vec3 end[4],
+                              float tolerance,
+                              Impact& impact);
+// The edge of particles 0 and 1 against the edge of particles 2 and 3.
+bool FindEdgeEdgeImpact(const glm::vec3 start[4],
+                        const glm::vec3 end[4],
+                        float tolerance,
+                        Impact& impact);
+}  // namespace GLOO
+
+#endif
@@ -0,0 +1,184 @@
+#ifndef DORMAND_PRINCE_INTEGRATOR_H_
+#define DORMAND_PRINCE_INTEGRATOR_H_
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "IntegratorBase.hpp"
+
+namespace GLOO {
+// Embedded Runge-Kutta 5(4) pair of Dormand and Prince with step-size
+// control. Step advances the state by exactly dt, split into as many
+// substeps as the error estimate demands: a substep is accepted when the
+// difference between the 5th and 4th order solutions stays below
+//
+//   absolute_tolerance + relative_tolerance * |y|
+//
+// in every component, and the next substep size is scaled from that error.
+// The step size carries over between calls, so quiet motion ends up taking
+// one substep per call while violent motion is subdivided. Substeps shorter
+// than min_step are accepted regardless of their error.
+template <class TSystem, class TState>
+class DormandPrinceIntegrator : public IntegratorBase<TSystem, TState> {
+ public:
+  DormandPrinceIntegrator(float absolute_tolerance = 1e-3f,
+                          float relative_tolerance = 1e-3f,
+                          float min_step = 1e-6f)
+      : absolute_tolerance_(absolute_tolerance),
+        relative_tolerance_(relative_tolerance),
+        min_step_(min_step),
+        step_size_(0.0f) {
+  }
+
+  void SetTolerances(float absolute_tolerance, float relative_tolerance) {
+    absolute_tolerance_ = absolute_tolerance;
+    relative_tolerance_ = relative_tolerance;
+  }
+
+  TState Integrate(const TSystem& system,
+                   const TState& state,
+                   float start_time,
+                   float dt) const override {
+    TState end_state = state;
+    DormandPrinceIntegrator solver(absolute_tolerance_, relative_tolerance_,
+                                   min_step_);
+    solver.Step(system, end_state, start_time, dt);
+    return end_state;
+  }
+
+  void Step(const TSystem& system,
+            TState& state,
+            float start_time,
+            float dt) override {
+    if (step_size_ <= 0.0f) {
+      step_size_ = dt;
+    }
+    // The caller may have edited the state (collisions, dragging) since the
+    // last call, so the first stage is always recomputed here; later substeps
+    // reuse the last stage of the previous one.
+    system.ComputeTimeDerivative(state, start_time, k1_);
+
+    float time = start_time;
+    float remaining = dt;
+    while (remaining > 0.0f) {
+      float h = std::min(step_size_, remaining);
+      // Avoid leaving a sliver of the interval for a final tiny substep.
+      if (remaining - h < 1e-3f * h) {
+        h = remaining;
+      }
+      Attempt(system, state, time, h);
+      float error = ErrorNorm(state);
+      float factor = error == 0.0f
+                         ? kMaxGrowth
+                         : std::min(kMaxGrowth,
+                                    std::max(kMaxShrink,
+                                             kSafety * std::pow(error, -0.2f)));
+
+      if (error <= 1.0f || h <= min_step_) {
+        std::swap(state, next_);
+        std::swap(k1_, k7_);
+        time += h;
+        remaining -= h;
+        stats_.accepted_steps++;
+        stats_.last_step_size = h;
+        // A substep truncated to the end of the interval says nothing about
+        // how far the next one may go.
+        if (h == step_size_ || factor < 1.0f) {
+          step_size_ = h * factor;
+        }
+      }
+      else {
+        stats_.rejected_steps++;
+        step_size_ = std::max(min_step_, h * factor);
+      }
+    }
+  }
+
+  const AdaptiveStepStats* GetAdaptiveStats() const override {
+    return &stats_;
+  }
+
+ private:
+  static constexpr float kSafety = 0.9f;
+  static constexpr float kMaxGrowth = 5.0f;
+  static constexpr float kMaxShrink = 0.2f;
+
+  // Fills next_ with the 5th order solution after h and error_ with its
+  // difference from the embedded 4th order one. Expects k1_ at (time, state).
+  void Attempt(const TSystem& system,
+               const TState& state,
+               float time,
+               float h) {
+    stage_ = state + h * (1.0f / 5 * k1_);
+    system.ComputeTimeDerivative(stage_, time + h / 5, k2_);
+    stage_ = state + h * (3.0f / 40 * k1_ + 9.0f / 40 * k2_);
+    system.ComputeTimeDerivative(stage_, time + 3 * h / 10, k3_);
+    stage_ = state +
+             h * (44.0f / 45 * k1_ + -56.0f / 15 * k2_ + 32.0f / 9 * k3_);
+    system.ComputeTimeDerivative(stage_, time + 4 * h / 5, k4_);
+    stage_ = state + h * (19372.0f / 6561 * k1_ + -25360.0f / 2187 * k2_ +
+                          64448.0f / 6561 * k3_ + -212.0f / 729 * k4_);
+    system.ComputeTimeDerivative(stage_, time + 8 * h / 9, k5_);
+    stage_ = state + h * (9017.0f / 3168 * k1_ + -355.0f / 33 * k2_ +
+                          46732.0f / 5247 * k3_ + 49.0f / 176 * k4_ +
+                          -5103.0f / 18656 * k5_);
+    system.ComputeTimeDerivative(stage_, time + h, k6_);
+    next_ = state + h * (35.0f / 384 * k1_ + 500.0f / 1113 * k3_ +
+                         125.0f / 192 * k4_ + -2187.0f / 6784 * k5_ +
+                         11.0f / 84 * k6_);
+    // First same as last: k7 is the derivative at the new state and becomes
+    // k1 of the next substep once accepted.
+    system.ComputeTimeDerivative(next_, time + h, k7_);
+    error_ = h * (71.0f / 57600 * k1_ + -71.0f / 16695 * k3_ +
+                  71.0f / 1920 * k4_ + -17253.0f / 339200 * k5_ +
+                  22.0f / 525 * k6_ + -1.0f / 40 * k7_);
+  }
+
+  // Largest error component relative to its tolerance.
+  float ErrorNorm(const TState& state) const {
+    float norm = 0.0f;
+    size_t n = error_.BlockSize();
+    for (int block = 0; block < TState::kBlockCount; block++) {
+      const float* error = error_.BlockData(block);
+      const float* before = state.BlockData(block);
+      const float* after = next_.BlockData(block);
+      for (size_t i = 0; i < n; i++) {
+        float scale =
+            absolute_tolerance_ +
+            relative_tolerance_ *
+                std::max(std::fabs(before[i]), std::fabs(after[i]));
+        norm = std::max(norm, std::fabs(error[i]) / scale);
+      }
+    }
+    return norm;
+  }
+
+  float absolute_tolerance_;
+  float relative_tolerance_;
+  float min_step_;
+  float step_size_;
+  AdaptiveStepStats stats_;
+
+  // Stage buffers reused by Step so that steady-state steps do not allocate.
+  TState k1_;
+  TState k2_;
+  TState k3_;
+  TState k4_;
+  TState k5_;
+  TState k6_;
+  TState k7_;
+  TState stage_;
+  TState next_;
+  TState error_;
+};
+
+template <class TSystem, class TState>
+constexpr float DormandPrinceIntegrator<TSystem, TState>::kSafety;
+template <class TSystem, class TState>
+constexpr float DormandPrinceIntegrator<TSystem, TState>::kMaxGrowth;
+template <class TSystem, class TState>
+constexpr float DormandPrinceIntegrator<TSystem, TState>::kMaxShrink;
+}  // namespace GLOO
+
+#endif
@@ -11,13 +11,24 @@ class ForwardEulerIntegrator : public IntegratorBase<TSystem, TState> {
                    float start_time,
                    float dt) const override {
       //std::cout << "Dt: " << dt << std::endl;
-      ParticleState delta = dt * system.ComputeTimeDerivative(state, start_time + dt);
+      TState delta = dt * system.ComputeTimeDerivative(state, start_time + dt);
       //std::cout << "Delta: " << delta.positions[0].x << " " << delta.positions[0].y << " " << delta.positions[0].z << std::endl;
 
-      ParticleState end_state = state + delta;
+      TState end_state = state + delta;
 
       return end_state;
   }
+
+  void Step(const TSystem& system,
+            TState& state,
+            float start_time,
+            float dt) override {
+      system.ComputeTimeDerivative(state, start_time + dt, derivative_);
+      state += dt * derivative_;
+  }
+
+  // Reused by Step so that steady-state steps do not allocate.
+  TState derivative_;
 };
 }  // namespace GLOO
 
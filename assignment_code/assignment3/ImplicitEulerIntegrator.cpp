@@ -0,0 +1,135 @@
+#include "ImplicitEulerIntegrator.hpp"
+
+#include "gloo/debug/Tracer.hpp"
+
+namespace GLOO {
+namespace {
+float Dot(const std::vector<glm::vec3>& a, const std::vector<glm::vec3>& b) {
+  float sum = 0.0f;
+  for (size_t i = 0; i < a.size(); i++) {
+    sum += glm::dot(a[i], b[i]);
+  }
+  return sum;
+}
+}  // namespace
+
+ImplicitEulerIntegrator::ImplicitEulerIntegrator(int max_iterations,
+                                                 float tolerance)
+    : max_iterations_(max_iterations),
+      tolerance_(tolerance),
+      last_iteration_count_(0) {
+}
+
+ParticleState ImplicitEulerIntegrator::Integrate(const PendulumSystem& system,
+                                                 const ParticleState& state,
+                                                 float start_time,
+                                                 float dt) const {
+  ParticleState end_state = state;
+  ImplicitEulerIntegrator solver(max_iterations_, tolerance_);
+  solver.Step(system, end_state, start_time, dt);
+  return end_state;
+}
+
+void ImplicitEulerIntegrator::Step(const PendulumSystem& system,
+                                   ParticleState& state,
+                                   float start_time,
+                                   float dt) {
+  size_t n = state.Size();
+
+  // f0 = M a(x0, v0); fixed particles report zero acceleration.
+  system.ComputeTimeDerivative(state, start_time + dt, derivative_);
+  system.ComputeSpringJacobians(state, jacobians_);
+
+  // rhs = h (f0 + h K v0), with fixed particles treated as motionless.
+  product_.resize(n);
+  for (size_t i = 0; i < n; i++) {
+    product_[i] = system.IsFixed(int(i)) ? glm::vec3(0.f) : state.velocities[i];
+  }
+  system.MultiplyForceJacobian(jacobians_, product_, stiffness_product_);
+  rhs_.resize(n);
+  for (size_t i = 0; i < n; i++) {
+    glm::vec3 force = system.GetMass(int(i)) * derivative_.velocities[i];
+    rhs_[i] = dt * (force + dt * stiffness_product_[i]);
+  }
+  Filter(system, rhs_);
+
+  // Jacobi preconditioner from the diagonal of the system matrix.
+  system.ComputeForceJacobianDiagonal(jacobians_, inverse_diagonal_);
+  for (size_t i = 0; i < n; i++) {
+    float mass_term = system.GetMass(int(i)) + dt * system.GetDrag();
+    inverse_diagonal_[i] =
+        1.0f / (glm::vec3(mass_term) - dt * dt * inverse_diagonal_[i]);
+  }
+
+  // Warm start from the previous step's velocity change.
+  if (delta_v_.size() != n) {
+    delta_v_.assign(n, glm::vec3(0.f));
+  }
+  Filter(system, delta_v_);
+
+  MultiplySystemMatrix(system, dt, delta_v_, product_);
+  residual_.resize(n);
+  preconditioned_.resize(n);
+  direction_.resize(n);
+  for (size_t i = 0; i < n; i++) {
+    residual_[i] = rhs_[i] - product_[i];
+    preconditioned_[i] = inverse_diagonal_[i] * residual_[i];
+    direction_[i] = preconditioned_[i];
+  }
+
+  TraceScope trace("Conjugate gradient");
+  float threshold = tolerance_ * tolerance_ * Dot(rhs_, rhs_);
+  float rz = Dot(residual_, preconditioned_);
+  int iteration = 0;
+  while (iteration < max_iterations_ && Dot(residual_, residual_) > threshold) {
+    MultiplySystemMatrix(system, dt, direction_, product_);
+    float curvature = Dot(direction_, product_);
+    if (curvature <= 0.0f)
+      break;
+    float alpha = rz / curvature;
+    for (size_t i = 0; i < n; i++) {
+      delta_v_[i] += alpha * direction_[i];
+      residual_[i] -= alpha * product_[i];
+      preconditioned_[i] = inverse_diagonal_[i] * residual_[i];
+    }
+    float rz_next = Dot(residual_, preconditioned_);
+    float beta = rz_next / rz;
+    rz = rz_next;
+    for (size_t i = 0; i < n; i++) {
+      direction_[i] = preconditioned_[i] + beta * direction_[i];
+    }
+    iteration++;
+  }
+  last_iteration_count_ = iteration;
+
+  for (size_t i = 0; i < n; i++) {
+    if (system.IsFixed(int(i)))
+      continue;
+    state.velocities[i] += delta_v_[i];
+    state.positions[i] += dt * state.velocities[i];
+  }
+}
+
+void ImplicitEulerIntegrator::MultiplySystemMatrix(
+    const PendulumSystem& system,
+    float dt,
+    const std::vector<glm::vec3>& v,
+    std::vector<glm::vec3>& out) {
+  // (M - h D - h^2 K) v with D = -drag I.
+  system.MultiplyForceJacobian(jacobians_, v, stiffness_product_);
+  out.resize(v.size());
+  for (size_t i = 0; i < v.size(); i++) {
+    float mass_term = system.GetMass(int(i)) + dt * system.GetDrag();
+    out[i] = mass_term * v[i] - dt * dt * stiffness_product_[i];
+  }
+  Filter(system, out);
+}
+
+void ImplicitEulerIntegrator::Filter(const PendulumSystem& system,
+                                     std::vector<glm::vec3>& v) const {
+  for (size_t i = 0; i < v.size(); i++) {
+    if (system.IsFixed(int(i)))
+      v[i] = glm::vec3(0.f);
+  }
+}
+}  // namespace GLOO
@@ -4,6 +4,20 @@
 #include "ParticleSystemBase.hpp"
 
 namespace GLOO {
+// Bookkeeping reported by integrators that pick their own step sizes.
+struct AdaptiveStepStats {
+  long accepted_steps = 0;
+  long rejected_steps = 0;
+  float last_step_size = 0.0f;
+};
+
+// Error tolerances of integrators that pick their own step sizes: a step is
+// accepted when every component's error is below absolute + relative * |y|.
+struct AdaptiveTolerances {
+  float relative = 1e-3f;
+  float absolute = 1e-3f;
+};
+
 template <class TSystem, class TState>
 class IntegratorBase {
  public:
@@ -13,6 +27,28 @@ class IntegratorBase {
                            const TState& state,
                            float start_time,
                            float dt) const = 0;
+
+  // Advances state in place. Integrators that keep their own stage buffers
+  // override this so that a steady-state step performs no heap allocation.
+  virtual void Step(const TSystem& system,
+                    TState& state,
+                    float start_time,
+                    float dt) {
+    state = Integrate(system, state, start_time, dt);
+  }
+
+  // Tells the integrator that the state or the system changed since its
+  // last Step, so anything it kept from that step no longer holds.
+  // Integrators that keep nothing between steps ignore it.
+  virtual void Invalidate() {
+  }
+
+  // Adaptive integrators subdivide each Step on their own and return their
+  // statistics here; callers then step once per frame instead of at a fixed
+  // rate. Fixed-step integrators return nullptr.
+  virtual const AdaptiveStepStats* GetAdaptiveStats() const {
+    return nullptr;
+  }
 };
 }  // namespace GLOO
 
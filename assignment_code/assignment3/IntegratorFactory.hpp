@@ -4,8 +4,14 @@
 #include "IntegratorBase.hpp"
 #include "CircularSystem.hpp"
 #include "ForwardEulerIntegrator.hpp"
+#include "SymplecticEulerIntegrator.hpp"
+#include "VelocityVerletIntegrator.hpp"
 #include "TrapezoidalIntegrator.hpp"
 #include "RkFourIntegrator.hpp"
+#include "DormandPrinceIntegrator.hpp"
+#include "ImplicitEulerIntegrator.hpp"
+#include "XpbdIntegrator.hpp"
+#include "SoaLayoutIntegrator.hpp"
 
 #include <stdexcept>
 
@@ -16,21 +22,83 @@
 namespace GLOO {
 class IntegratorFactory {
  public:
+  // Integrators with a fixed step size ignore the tolerances.
   template <class TSystem, class TState>
   static std::unique_ptr<IntegratorBase<TSystem, TState>> CreateIntegrator(
-      IntegratorType type) {
+      IntegratorType type,
+      const AdaptiveTolerances& tolerances = AdaptiveTolerances()) {
     switch (type) {
       case IntegratorType::Euler:
           return make_unique<ForwardEulerIntegrator<TSystem, TState>>();
           break;
+      case IntegratorType::SymplecticEuler:
+          return make_unique<SymplecticEulerIntegrator<TSystem, TState>>();
+          break;
+      case IntegratorType::VelocityVerlet:
+          return make_unique<VelocityVerletIntegrator<TSystem, TState>>();
+          break;
       case IntegratorType::Trapezoidal:
           return make_unique<TrapezoidalIntegrator<TSystem, TState>>();
           break;
       case IntegratorType::RK4:
           return make_unique<RkFourIntegrator<TSystem, TState>>();
           break;
+      case IntegratorType::DormandPrince:
+          return make_unique<DormandPrinceIntegrator<TSystem, TState>>(
+              tolerances.absolute, tolerances.relative);
+          break;
+      case IntegratorType::ImplicitEuler:
+          return CreateImplicitEuler(static_cast<TSystem*>(nullptr),
+                                     static_cast<TState*>(nullptr));
+          break;
+      case IntegratorType::Xpbd:
+          return CreateXpbd(static_cast<TSystem*>(nullptr),
+                            static_cast<TState*>(nullptr));
+          break;
 
       }
+      throw std::runtime_error("Unknown integrator type!");
+  }
+
+  // An integrator of ParticleStates that steps them in the
+  // structure-of-arrays layout, see SoaLayoutIntegrator. The system must
+  // compute derivatives of SoaParticleStates. Implicit Euler and XPBD work
+  // on ParticleStates only and throw std::runtime_error.
+  template <class TSystem>
+  static std::unique_ptr<IntegratorBase<TSystem, ParticleState>>
+  CreateSoaLayoutIntegrator(
+      IntegratorType type,
+      const AdaptiveTolerances& tolerances = AdaptiveTolerances()) {
+    return make_unique<SoaLayoutIntegrator<TSystem>>(
+        CreateIntegrator<TSystem, SoaParticleState>(type, tolerances));
+  }
+
+ private:
+  // Implicit Euler needs PendulumSystem's spring Jacobians; the tag pointers
+  // pick the real overload for that system and the throwing one otherwise.
+  template <class TSystem, class TState>
+  static std::unique_ptr<IntegratorBase<TSystem, TState>> CreateImplicitEuler(
+      TSystem*, TState*) {
+    throw std::runtime_error(
+        "Implicit Euler is only available for PendulumSystem with "
+        "ParticleState!");
+  }
+  static std::unique_ptr<IntegratorBase<PendulumSystem, ParticleState>>
+  CreateImplicitEuler(PendulumSystem*, ParticleState*) {
+    return make_unique<ImplicitEulerIntegrator>();
+  }
+
+  // XPBD turns PendulumSystem's springs into constraints, so it has the same
+  // restriction.
+  template <class TSystem, class TState>
+  static std::unique_ptr<IntegratorBase<TSystem, TState>> CreateXpbd(TSystem*,
+                                                                    TState*) {
+    throw std::runtime_error(
+        "XPBD is only available for PendulumSystem with ParticleState!");
+  }
+  static std::unique_ptr<IntegratorBase<PendulumSystem, ParticleState>>
+  CreateXpbd(PendulumSystem*, ParticleState*) {
+    return make_unique<XpbdIntegrator>();
   }
 };
 }  // namespace GLOO
@@ -1,8 +1,55 @@
 #ifndef INTEGRATOR_TYPE_H_
 #define INTEGRATOR_TYPE_H_
 
+#include <stdexcept>
+#include <string>
+
 namespace GLOO {
-enum class IntegratorType { Euler, Trapezoidal, RK4 };
+enum class IntegratorType {
+  Euler,
+  SymplecticEuler,
+  VelocityVerlet,
+  Trapezoidal,
+  RK4,
+  DormandPrince,
+  ImplicitEuler,
+  Xpbd
+};
+
+// Usage text for the single-letter integrator codes accepted by the
+// executables.
+const char* const kIntegratorUsage =
+    "       e: Integrator: Forward Euler\n"
+    "       s: Integrator: Symplectic Euler\n"
+    "       v: Integrator: Velocity Verlet\n"
+    "       t: Integrator: Trapezoid\n"
+    "       r: Integrator: RK 4\n"
+    "       d: Integrator: Dormand-Prince RK45 (adaptive, timestep ignored)\n"
+    "       i: Integrator: Implicit Euler (cloth only)\n"
+    "       x: Integrator: XPBD constraints (cloth only)\n";
+
+inline IntegratorType ParseIntegratorType(char code) {
+  switch (code) {
+    case 'e':
+      return IntegratorType::Euler;
+    case 's':
+      return IntegratorType::SymplecticEuler;
+    case 'v':
+      return IntegratorType::VelocityVerlet;
+    case 't':
+      return IntegratorType::Trapezoidal;
+    case 'r':
+      return IntegratorType::RK4;
+    case 'd':
+      return IntegratorType::DormandPrince;
+    case 'i':
+      return IntegratorType::ImplicitEuler;
+    case 'x':
+      return IntegratorType::Xpbd;
+  }
+  throw std::runtime_error("Unrecognized integrator type: " +
+                           std::string(1, code) + ".");
 }
+}  // namespace GLOO
 
 #endif
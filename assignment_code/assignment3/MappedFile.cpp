@@ -0,0 +1,90 @@
+#include "MappedFile.hpp"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace GLOO {
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string& file_path)
+    : data_(nullptr),
+      size_(0),
+      file_handle_(INVALID_HANDLE_VALUE),
+      mapping_handle_(nullptr) {
+  file_handle_ = CreateFileA(file_path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                             nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                             nullptr);
+  if (file_handle_ == INVALID_HANDLE_VALUE) {
+    throw std::runtime_error("Unable to open " + file_path + "!");
+  }
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file_handle_, &size)) {
+    CloseHandle(file_handle_);
+    throw std::runtime_error("Unable to read the size of " + file_path + "!");
+  }
+  size_ = size_t(size.QuadPart);
+  // Empty files cannot be mapped; they are left with no data.
+  if (size_ == 0)
+    return;
+  mapping_handle_ =
+      CreateFileMappingA(file_handle_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping_handle_ != nullptr) {
+    data_ = static_cast<const char*>(
+        MapViewOfFile(mapping_handle_, FILE_MAP_READ, 0, 0, 0));
+  }
+  if (data_ == nullptr) {
+    if (mapping_handle_ != nullptr)
+      CloseHandle(mapping_handle_);
+    CloseHandle(file_handle_);
+    throw std::runtime_error("Unable to map " + file_path + "!");
+  }
+}
+
+MappedFile::~MappedFile() {
+  if (data_ != nullptr)
+    UnmapViewOfFile(data_);
+  if (mapping_handle_ != nullptr)
+    CloseHandle(mapping_handle_);
+  CloseHandle(file_handle_);
+}
+#else
+MappedFile::MappedFile(const std::string& file_path)
+    : data_(nullptr), size_(0) {
+  int fd = open(file_path.c_str(), O_RDONLY);
+  if (fd == -1) {
+    throw std::runtime_error("Unable to open " + file_path + "!");
+  }
+  struct stat status;
+  if (fstat(fd, &status) == -1) {
+    close(fd);
+    throw std::runtime_error("Unable to read the size of " + file_path + "!");
+  }
+  size_ = size_t(status.st_size);
+  // Empty files cannot be mapped; they are left with no data.
+  if (size_ > 0) {
+    void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      close(fd);
+      throw std::runtime_error("Unable to map " + file_path + "!");
+    }
+    data_ = static_cast<const char*>(data);
+  }
+  // The mapping keeps the file alive on its own.
+  close(fd);
+}
+
+MappedFile::~MappedFile() {
+  if (data_ != nullptr)
+    munmap(const_cast<char*>(data_), size_);
+}
+#endif
+}  // namespace GLOO
@@ -0,0 +1,37 @@
+#ifndef MAPPED_FILE_H_
+#define MAPPED_FILE_H_
+
+#include <cstddef>
+#include <string>
+
+namespace GLOO {
+// A whole file mapped read-only into memory. Pages are read in by the OS as
+// they are touched, so opening a large file costs nothing up front and data
+// can be used in place without copying it into a buffer first.
+class MappedFile {
+ public:
+  // Throws std::runtime_error if the file cannot be opened or mapped.
+  explicit MappedFile(const std::string& file_path);
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  void operator=(const MappedFile&) = delete;
+
+  const char* GetData() const {
+    return data_;
+  }
+  size_t GetSize() const {
+    return size_;
+  }
+
+ private:
+  const char* data_;
+  size_t size_;
+#ifdef _WIN32
+  void* file_handle_;
+  void* mapping_handle_;
+#endif
+};
+}  // namespace GLOO
+
+#endif
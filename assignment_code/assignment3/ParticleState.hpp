@@ -6,12 +6,67 @@
 
 #include <glm/glm.hpp>
 
+#include "StateExpression.hpp"
+
 namespace GLOO {
-struct ParticleState {
+static_assert(sizeof(glm::vec3) == 3 * sizeof(float),
+              "ParticleState blocks assume tightly packed glm::vec3.");
+
+struct ParticleState : public StateExpr<ParticleState> {
   // The state of a particle system: positions and velocities.
   std::vector<glm::vec3> positions;
   std::vector<glm::vec3> velocities;
 
+  ParticleState() {
+  }
+
+  // Arithmetic on states (state + dt * k1, ...) builds lazy expressions that
+  // are evaluated in one fused loop here; see StateExpression.hpp.
+  template <class E, class = EnableIfStateOf<E, ParticleState>>
+  ParticleState(const StateExpr<E>& expr) {
+    EvaluateInto(*this, expr);
+  }
+  template <class E>
+  ParticleState& operator=(const StateExpr<E>& expr) {
+    EvaluateInto(*this, expr);
+    return *this;
+  }
+  template <class E>
+  ParticleState& operator+=(const StateExpr<E>& expr) {
+    EvaluateInto(*this, *this + expr);
+    return *this;
+  }
+
+  size_t Size() const {
+    return positions.size();
+  }
+
+  // Keeps existing storage when the size is unchanged, so buffers reused
+  // across steps do not reallocate.
+  void Resize(size_t size) {
+    positions.resize(size);
+    velocities.resize(size);
+  }
+
+  // Expression interface: positions and velocities as two flat float blocks.
+  using StateType = ParticleState;
+  using Evaluator = LeafEvaluator;
+  static const int kBlockCount = 2;
+  size_t BlockSize() const {
+    return 3 * positions.size();
+  }
+  float* BlockData(int block) {
+    return reinterpret_cast<float*>(block == 0 ? positions.data()
+                                               : velocities.data());
+  }
+  const float* BlockData(int block) const {
+    return reinterpret_cast<const float*>(block == 0 ? positions.data()
+                                                     : velocities.data());
+  }
+  Evaluator Bind(int block) const {
+    return Evaluator{BlockData(block)};
+  }
+
   ParticleState& operator+=(const ParticleState& rhs) {
     if (positions.size() != rhs.positions.size() ||
         velocities.size() != rhs.velocities.size() ||
@@ -35,24 +90,6 @@ struct ParticleState {
     return *this;
   }
 };
-
-// Operators, optimized via overloading + std::move.
-inline ParticleState operator+(ParticleState s1, const ParticleState& s2) {
-  s1 += s2;
-  return s1;
-}
-inline ParticleState operator+(const ParticleState& s1, ParticleState&& s2) {
-  s2 += s1;
-  return std::move(s2);
-}
-inline ParticleState operator*(ParticleState s1, float k) {
-  s1 *= k;
-  return s1;
-}
-inline ParticleState operator*(float k, ParticleState s1) {
-  s1 *= k;
-  return s1;
-}
 }  // namespace GLOO
 
 #endif
@@ -6,8 +6,18 @@
 namespace GLOO {
 class ParticleSystemBase {
  public:
-  virtual ParticleState ComputeTimeDerivative(const ParticleState& state,
-                                              float time) const = 0;
+  // Writes the derivative of state into out, which must not alias state.
+  // out is resized to match state; its storage is reused across calls.
+  virtual void ComputeTimeDerivative(const ParticleState& state,
+                                     float time,
+                                     ParticleState& out) const = 0;
+
+  ParticleState ComputeTimeDerivative(const ParticleState& state,
+                                      float time) const {
+    ParticleState derivative;
+    ComputeTimeDerivative(state, time, derivative);
+    return derivative;
+  }
 };
 }  // namespace GLOO
 
@@ -7,16 +7,18 @@
 #include "gloo/shaders/PhongShader.hpp"
 #include "IntegratorFactory.hpp"
 #include "gloo/shaders/SimpleShader.hpp"
+#include "gloo/debug/Profiler.hpp"
+#include "SimulationClock.hpp"
 
 #include <algorithm>
 namespace GLOO {
-	PendulumNode::PendulumNode(float integration_step, IntegratorType integrator_type) : SceneNode() {
+	PendulumNode::PendulumNode(float integration_step, IntegratorType integrator_type, const AdaptiveTolerances& tolerances, SimulationThread& simulation_thread) : SceneNode() {
 		// Constructor
 		time_ = 0.0f;
 		integration_step_ = integration_step;
 		integrator_type_ = integrator_type;
 		rollover_time_ = 0.0f;
-		integrator_ = IntegratorFactory::CreateIntegrator<PendulumSystem, ParticleState>(integrator_type);
+		integrator_ = IntegratorFactory::CreateIntegrator<PendulumSystem, ParticleState>(integrator_type, tolerances);
 
 		// ---- Variables to set ----
 		float rest_length = .75f;
@@ -76,13 +78,40 @@ namespace GLOO {
 
 		system_.FixParticle(0);
 		system_.PopulateSpringData();
+
+		previous_positions_ = state_.positions;
+		snapshots_.Reset(PendulumSnapshot{ state_.positions, state_.positions, 1.0f });
+		simulation_thread.AddTask([this](int tick_count, double tick_seconds, float alpha) {
+			AdvanceSimulation(tick_count, tick_seconds, alpha);
+		});
 	}
 
-	void PendulumNode::Update(double delta_time) {
+	void PendulumNode::AdvanceSimulation(int tick_count, double tick_seconds, float alpha) {
+		ScopedTimer timer("Pendulum");
+		for (int i = 0; i < tick_count; i++) {
+			if (i == tick_count - 1) {
+				previous_positions_ = state_.positions;
+			}
+			AdvanceTick(tick_seconds);
+		}
+		PendulumSnapshot& snapshot = snapshots_.GetWriteBuffer();
+		snapshot.previous_positions = previous_positions_;
+		snapshot.positions = state_.positions;
+		snapshot.alpha = alpha;
+		snapshots_.Publish();
+	}
+
+	void PendulumNode::AdvanceTick(double delta_time) {
 		rollover_time_ += delta_time;
 		float dt = 0.0f;
 		int num_steps = 0;
-		if (float(delta_time) < integration_step_) {
+		if (integrator_->GetAdaptiveStats() != nullptr) {
+			// Adaptive integrators choose their own substeps, so hand them the whole frame
+			dt = float(delta_time);
+			num_steps = 1;
+			rollover_time_ = 0.0f;
+		}
+		else if (float(delta_time) < integration_step_) {
 			dt = float(delta_time);
 			num_steps = 1;
 			rollover_time_ = 0.0f;
@@ -93,16 +122,24 @@ namespace GLOO {
 			rollover_time_ -= dt * num_steps;
 		}
 		for (int i = 0; i < num_steps; i++) {
-			state_ = integrator_->Integrate(system_, state_, time_, dt);
+			integrator_->Step(system_, state_, time_, dt);
 			time_ += dt;
 		}
+	}
 
+	void PendulumNode::Update(double delta_time) {
+		if (!snapshots_.Update()) {
+			return;
+		}
+		const PendulumSnapshot& snapshot = snapshots_.GetReadBuffer();
+		InterpolatePositions(snapshot.previous_positions, snapshot.positions, snapshot.alpha, particles_);
+		const std::vector<glm::vec3>& particles = particles_;
 		for (int i = 0; i < sphere_ptrs_.size(); i++) {
-			sphere_ptrs_[i]->GetTransform().SetPosition(state_.positions[i]);
+			sphere_ptrs_[i]->GetTransform().SetPosition(particles[i]);
 			if (i > 0) {
 				auto positions = make_unique<PositionArray>();
-				positions->push_back(state_.positions[i - 1]);
-				positions->push_back(state_.positions[i]);
+				positions->push_back(particles[i - 1]);
+				positions->push_back(particles[i]);
 				line_ptrs_[i-1]->GetComponentPtr<RenderingComponent>()->GetVertexObjectPtr()->UpdatePositions(std::move(positions));
 			}
 		}
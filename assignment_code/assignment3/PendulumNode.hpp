@@ -7,21 +7,38 @@
 #include "ForwardEulerIntegrator.hpp"
 #include "gloo/shaders/ShaderProgram.hpp"
 #include "gloo/VertexObject.hpp"
+#include "SimulationThread.hpp"
+#include "TripleBuffer.hpp"
 
 namespace GLOO {
     class PendulumNode : public SceneNode {
     public:
-        // Constructor
-        PendulumNode(float integration_step, IntegratorType integrator_type);
+        // Constructor; the pendulum is stepped by simulation_thread, which must outlive the node
+        // Constructor; tolerances only matter for adaptive integrators
+        PendulumNode(float integration_step, IntegratorType integrator_type, const AdaptiveTolerances& tolerances, SimulationThread& simulation_thread);
         void Update(double delta_time) override;
     private:
+        // The states after the last two ticks and how far to blend between them
+        struct PendulumSnapshot {
+            std::vector<glm::vec3> previous_positions;
+            std::vector<glm::vec3> positions;
+            float alpha;
+        };
+        // Run on the simulation thread, which owns the state, system and integrator
+        void AdvanceSimulation(int tick_count, double tick_seconds, float alpha);
+        void AdvanceTick(double delta_time);
         ParticleState state_;
+        std::vector<glm::vec3> previous_positions_;
         // Set gravity and drag value for system calculations
         glm::vec3 gravity_{ 0.0f, -2.0f, 0.0f };
         float drag_ = .1f;
         PendulumSystem system_ = PendulumSystem(gravity_, drag_);
         std::unique_ptr<IntegratorBase<PendulumSystem, ParticleState>> integrator_;
 
+        TripleBuffer<PendulumSnapshot> snapshots_;
+        // Particle positions interpolated to the render time
+        std::vector<glm::vec3> particles_;
+
         std::vector<SceneNode*> sphere_ptrs_;
         std::vector<SceneNode*> line_ptrs_;
 
@@ -1,4 +1,7 @@
 #include "PendulumSystem.hpp"
+#include "gloo/utils.hpp"
+#include "gloo/debug/Tracer.hpp"
+#include <algorithm>
 #include <iostream>
 #include <stdexcept>
 
@@ -11,28 +14,32 @@ namespace GLOO {
 		wind_scalar_ = 5.0f;
 	}
 
-	ParticleState PendulumSystem::ComputeTimeDerivative(const ParticleState& state, float time) const {
-		std::vector<glm::vec3> accelerations;
-		std::vector<glm::vec3> velocities;
+	void PendulumSystem::ComputeTimeDerivative(const ParticleState& state, float time, ParticleState& out) const {
+		TraceScope trace("ComputeTimeDerivative");
+		out.Resize(state.Size());
+		glm::vec3 wind = ComputeWind(time);
+		ForEachRange(int(state.Size()), [&](int begin, int end) {
+			ComputeDerivativeRange(state, wind, out, begin, end);
+		});
+	}
+
+	void PendulumSystem::ComputeTimeDerivative(const SoaParticleState& state, float time, SoaParticleState& out) const {
+		TraceScope trace("ComputeTimeDerivative");
+		out.Resize(state.Size());
+		glm::vec3 wind = ComputeWind(time);
+		ForEachRange(int(state.Size()), [&](int begin, int end) {
+			ComputeDerivativeRange(state, wind, out, begin, end);
+		});
+	}
 
+	void PendulumSystem::ComputeDerivativeRange(const ParticleState& state, glm::vec3 wind, ParticleState& out, int begin, int end) const {
 		glm::vec3 gravity_force;
 		glm::vec3 drag_force;
 		glm::vec3 spring_force;
 		glm::vec3 acceleration;
 		glm::vec3 velocity;
 
-		glm::vec3 wind;
-
-		if (wind_on_) {
-			float windStrength = cos(time / 1) * wind_scalar_;
-			wind = glm::normalize(glm::vec3(sin(time / 2), sin(time / 1), cos(time / 3))) * windStrength;
-			//std::cout << wind.x << " " << wind.y << " " << wind.z << std::endl;
-		}
-		else {
-			wind = glm::vec3(0.f);
-		}
-
-		for (int i = 0; i < state.positions.size(); i++) {
+		for (int i = begin; i < end; i++) {
 			if (fixed_particles_[i]) {
 				// We use a zero acceleration to represent a fixed position particle
 				velocity = glm::vec3(0.f);
@@ -48,17 +55,10 @@ namespace GLOO {
 
 				// Calculate spring forces
 				glm::vec3 total_spring_force{ 0.f,0.f,0.f };
-				for (Spring spring : springs_per_particle_[i]) {
-					int end = 0;
-					if (spring.start == i) {
-						end = spring.end;
-					}
-					else if (spring.end == i) {
-						end = spring.start;
-					}
-					float k = spring.stiffness;
-					float r = spring.rest_length;
-					glm::vec3 d = state.positions[i] - state.positions[end];
+				for (int s = spring_offsets_[i]; s < spring_offsets_[i + 1]; s++) {
+					float k = spring_stiffnesses_[s];
+					float r = spring_rest_lengths_[s];
+					glm::vec3 d = state.positions[i] - state.positions[spring_neighbors_[s]];
 					float d_length = glm::length(d);
 					total_spring_force += glm::vec3(-k * (d_length - r) * (d / d_length));
 				}
@@ -66,16 +66,95 @@ namespace GLOO {
 
 				// Sum forces and store acceleration
 				acceleration = (gravity_force + drag_force + spring_force + wind) / particle_masses_[i];
-				
+			}
+			out.positions[i] = velocity;
+			out.velocities[i] = acceleration;
+		}
+	}
+
+	void PendulumSystem::ComputeDerivativeRange(const SoaParticleState& state, glm::vec3 wind, SoaParticleState& out, int begin, int end) const {
+		for (int i = begin; i < end; i++) {
+			if (fixed_particles_[i]) {
+				out.SetPosition(i, glm::vec3(0.f));
+				out.SetVelocity(i, glm::vec3(0.f));
+				continue;
+			}
+			glm::vec3 position = state.GetPosition(i);
+			glm::vec3 velocity = state.GetVelocity(i);
+
+			glm::vec3 total_spring_force{ 0.f,0.f,0.f };
+			for (int s = spring_offsets_[i]; s < spring_offsets_[i + 1]; s++) {
+				glm::vec3 d = position - state.GetPosition(spring_neighbors_[s]);
+				float d_length = glm::length(d);
+				total_spring_force += -spring_stiffnesses_[s] * (d_length - spring_rest_lengths_[s]) * (d / d_length);
+			}
+
+			glm::vec3 force = particle_masses_[i] * gravity_ - drag_ * velocity + total_spring_force + wind;
+			out.SetPosition(i, velocity);
+			out.SetVelocity(i, force / particle_masses_[i]);
+		}
+	}
 
-				
+	void PendulumSystem::SetThreadCount(int thread_count) {
+		if (thread_count <= 1) {
+			thread_pool_.reset();
+		}
+		else if (thread_pool_ == nullptr || thread_pool_->GetThreadCount() != thread_count) {
+			thread_pool_ = make_unique<ThreadPool>(thread_count);
+		}
+	}
+
+	int PendulumSystem::GetThreadCount() const {
+		return thread_pool_ == nullptr ? 1 : thread_pool_->GetThreadCount();
+	}
+
+	void PendulumSystem::ComputeSpringJacobians(const ParticleState& state, std::vector<glm::mat3>& jacobians) const {
+		jacobians.resize(springs_.size());
+		ForEachRange(int(springs_.size()), [&](int begin, int end) {
+			for (int s = begin; s < end; s++) {
+				const Spring& spring = springs_[s];
+				glm::vec3 d = state.positions[spring.start] - state.positions[spring.end];
+				float d_length = glm::length(d);
+				glm::vec3 n = d / d_length;
+				glm::mat3 nn = glm::outerProduct(n, n);
+				// Dropping the transverse term of compressed springs keeps K negative semi-definite (Baraff-Witkin)
+				float transverse = std::max(0.f, 1.f - spring.rest_length / d_length);
+				jacobians[s] = -spring.stiffness * (nn + transverse * (glm::mat3(1.f) - nn));
+			}
+		});
+	}
+
+	void PendulumSystem::MultiplyForceJacobian(const std::vector<glm::mat3>& jacobians, const std::vector<glm::vec3>& v, std::vector<glm::vec3>& out) const {
+		out.resize(v.size());
+		ForEachRange(int(v.size()), [&](int begin, int end) {
+			for (int i = begin; i < end; i++) {
+				glm::vec3 sum(0.f);
+				for (int s = spring_offsets_[i]; s < spring_offsets_[i + 1]; s++) {
+					sum += jacobians[spring_indices_[s]] * (v[i] - v[spring_neighbors_[s]]);
+				}
+				out[i] = sum;
 			}
-			velocities.push_back(velocity);
-			accelerations.push_back(acceleration);
-			
+		});
+	}
+
+	void PendulumSystem::ComputeForceJacobianDiagonal(const std::vector<glm::mat3>& jacobians, std::vector<glm::vec3>& out) const {
+		out.resize(particle_masses_.size());
+		for (int i = 0; i < int(particle_masses_.size()); i++) {
+			glm::vec3 diagonal(0.f);
+			for (int s = spring_offsets_[i]; s < spring_offsets_[i + 1]; s++) {
+				const glm::mat3& jacobian = jacobians[spring_indices_[s]];
+				diagonal += glm::vec3(jacobian[0][0], jacobian[1][1], jacobian[2][2]);
+			}
+			out[i] = diagonal;
 		}
-		ParticleState derived_state{ velocities, accelerations};
-		return derived_state;
+	}
+
+	glm::vec3 PendulumSystem::ComputeWind(float time) const {
+		if (!wind_on_) {
+			return glm::vec3(0.f);
+		}
+		float windStrength = cos(time / 1) * wind_scalar_;
+		return glm::normalize(glm::vec3(sin(time / 2), sin(time / 1), cos(time / 3))) * windStrength;
 	}
 
 	void PendulumSystem::AddParticle(float mass) {
@@ -105,12 +184,37 @@ namespace GLOO {
 	}
 
 	void PendulumSystem::PopulateSpringData() {
-		for (int i = 0; i < particle_masses_.size(); i++) {
-			springs_per_particle_.push_back(std::vector<Spring>());
+		// Count springs per particle, then prefix sum into row offsets
+		int num_particles = int(particle_masses_.size());
+		spring_offsets_.assign(num_particles + 1, 0);
+		for (const Spring& spring : springs_) {
+			spring_offsets_[spring.start + 1]++;
+			spring_offsets_[spring.end + 1]++;
 		}
-		for (Spring spring : springs_) {
-			springs_per_particle_[spring.start].push_back(spring);
-			springs_per_particle_[spring.end].push_back(spring);
+		for (int i = 0; i < num_particles; i++) {
+			spring_offsets_[i + 1] += spring_offsets_[i];
+		}
+
+		// Scatter both endpoints of each spring, keeping springs_ order within a row
+		int num_entries = spring_offsets_[num_particles];
+		spring_neighbors_.resize(num_entries);
+		spring_rest_lengths_.resize(num_entries);
+		spring_stiffnesses_.resize(num_entries);
+		spring_indices_.resize(num_entries);
+		std::vector<int> cursor(spring_offsets_.begin(), spring_offsets_.end() - 1);
+		for (int spring_index = 0; spring_index < int(springs_.size()); spring_index++) {
+			const Spring& spring = springs_[spring_index];
+			int a = cursor[spring.start]++;
+			spring_neighbors_[a] = spring.end;
+			spring_rest_lengths_[a] = spring.rest_length;
+			spring_stiffnesses_[a] = spring.stiffness;
+			spring_indices_[a] = spring_index;
+
+			int b = cursor[spring.end]++;
+			spring_neighbors_[b] = spring.start;
+			spring_rest_lengths_[b] = spring.rest_length;
+			spring_stiffnesses_[b] = spring.stiffness;
+			spring_indices_[b] = spring_index;
 		}
 	}
 
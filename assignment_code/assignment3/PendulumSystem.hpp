@@ -2,7 +2,10 @@
 #define PENDULUM_SYSTEM_H_
 
 #include "ParticleSystemBase.hpp"
+#include "SoaParticleState.hpp"
 #include "Spring.hpp"
+#include "ThreadPool.hpp"
+#include <memory>
 #include <vector>
 #include "IntegratorType.hpp"
 
@@ -11,7 +14,15 @@ namespace GLOO {
     public:
         // Constructor
         PendulumSystem(glm::vec3 gravity, float drag);
-        ParticleState ComputeTimeDerivative(const ParticleState& state, float time) const override;
+        using ParticleSystemBase::ComputeTimeDerivative;
+        void ComputeTimeDerivative(const ParticleState& state, float time, ParticleState& out) const override;
+        // Same derivative for the structure-of-arrays layout, selected by integrators instantiated with SoaParticleState
+        void ComputeTimeDerivative(const SoaParticleState& state, float time, SoaParticleState& out) const;
+        SoaParticleState ComputeTimeDerivative(const SoaParticleState& state, float time) const {
+            SoaParticleState derivative;
+            ComputeTimeDerivative(state, time, derivative);
+            return derivative;
+        }
         void AddParticle(float mass);
         void AddSpring(int start, int end, float rest_length, float stiffness);
         void FixParticle(int index);
@@ -26,27 +37,87 @@ namespace GLOO {
         }
 
         void PopulateSpringData();
+
+        // Splits ComputeTimeDerivative across a persistent pool of thread_count threads; 1 evaluates serially.
+        // Each particle is computed independently with the same arithmetic, so results match the serial path exactly.
+        void SetThreadCount(int thread_count);
+        int GetThreadCount() const;
+
+        // Force Jacobian support for implicit integration. ComputeSpringJacobians fills one 3x3 block
+        // df_start/dx_start per spring (in AddSpring order); MultiplyForceJacobian then applies
+        // K = df/dx to v matrix-free by walking the spring adjacency.
+        void ComputeSpringJacobians(const ParticleState& state, std::vector<glm::mat3>& jacobians) const;
+        void MultiplyForceJacobian(const std::vector<glm::mat3>& jacobians, const std::vector<glm::vec3>& v, std::vector<glm::vec3>& out) const;
+        void ComputeForceJacobianDiagonal(const std::vector<glm::mat3>& jacobians, std::vector<glm::vec3>& out) const;
+        float GetMass(int index) const {
+            return particle_masses_[index];
+        }
+        void SetMass(int index, float mass) {
+            particle_masses_[index] = mass;
+        }
+        // Changes a spring added earlier; call PopulateSpringData afterwards
+        void SetSpringParameters(int index, float rest_length, float stiffness) {
+            springs_[index].rest_length = rest_length;
+            springs_[index].stiffness = stiffness;
+        }
+        bool IsFixed(int index) const {
+            return fixed_particles_[index];
+        }
+        float GetDrag() const {
+            return drag_;
+        }
+        const std::vector<Spring>& GetSprings() const {
+            return springs_;
+        }
+        glm::vec3 GetGravity() const {
+            return gravity_;
+        }
+        glm::vec3 ComputeWind(float time) const;
+        // Runs task(begin, end) over [0, count), split across the thread pool when one is set
+        template <class Task>
+        void ForEachRange(int count, const Task& task) const {
+            if (thread_pool_ != nullptr) {
+                thread_pool_->ParallelFor(0, count, task);
+            }
+            else {
+                task(0, count);
+            }
+        }
         void UpdateGravity(glm::vec3 gravity) {
             gravity_ = gravity;
         }
         void ToggleWind() {
             wind_on_ = !wind_on_;
         }
-        float GetWindStrength() {
+        bool IsWindOn() const {
+            return wind_on_;
+        }
+        float GetWindStrength() const {
             return wind_scalar_;
         }
         void SetWindStrength(float value) {
             wind_scalar_ = value;
         }
     private:
-        std::vector<std::vector<Spring>> springs_per_particle_;
+        void ComputeDerivativeRange(const ParticleState& state, glm::vec3 wind, ParticleState& out, int begin, int end) const;
+        void ComputeDerivativeRange(const SoaParticleState& state, glm::vec3 wind, SoaParticleState& out, int begin, int end) const;
+
         std::vector<Spring> springs_;
+        // Compressed-sparse-row spring adjacency built by PopulateSpringData. The springs of particle i
+        // occupy [spring_offsets_[i], spring_offsets_[i + 1]) in the packed arrays below, with every
+        // spring stored once per endpoint.
+        std::vector<int> spring_offsets_;
+        std::vector<int> spring_neighbors_;
+        std::vector<float> spring_rest_lengths_;
+        std::vector<float> spring_stiffnesses_;
+        std::vector<int> spring_indices_;
         std::vector<bool> fixed_particles_;
         std::vector<float> particle_masses_;
         glm::vec3 gravity_;
         bool wind_on_;
         float drag_;
         float wind_scalar_;
+        std::unique_ptr<ThreadPool> thread_pool_;
 
     };
 }  // namespace GLOO
@@ -11,15 +11,37 @@ class RkFourIntegrator : public IntegratorBase<TSystem, TState> {
                    float start_time,
                    float dt) const override {
 
-      ParticleState k1 = system.ComputeTimeDerivative(state, start_time);
-      ParticleState k2 = system.ComputeTimeDerivative(state + dt / 2 * k1, start_time + dt / 2);
-      ParticleState k3 = system.ComputeTimeDerivative(state + dt / 2 * k2, start_time + dt / 2);
-      ParticleState k4 = system.ComputeTimeDerivative(state + dt * k3, start_time + dt);
+      TState k1 = system.ComputeTimeDerivative(state, start_time);
+      TState k2 = system.ComputeTimeDerivative(state + dt / 2 * k1, start_time + dt / 2);
+      TState k3 = system.ComputeTimeDerivative(state + dt / 2 * k2, start_time + dt / 2);
+      TState k4 = system.ComputeTimeDerivative(state + dt * k3, start_time + dt);
 
-      ParticleState end_state = state + dt/6 * (k1 + k2 + k3 + k4);
+      TState end_state = state + dt/6 * (k1 + 2 * k2 + 2 * k3 + k4);
 
       return end_state;
   }
+
+  void Step(const TSystem& system,
+            TState& state,
+            float start_time,
+            float dt) override {
+      system.ComputeTimeDerivative(state, start_time, k1_);
+      stage_ = state + dt / 2 * k1_;
+      system.ComputeTimeDerivative(stage_, start_time + dt / 2, k2_);
+      stage_ = state + dt / 2 * k2_;
+      system.ComputeTimeDerivative(stage_, start_time + dt / 2, k3_);
+      stage_ = state + dt * k3_;
+      system.ComputeTimeDerivative(stage_, start_time + dt, k4_);
+
+      state = state + dt / 6 * (k1_ + 2 * k2_ + 2 * k3_ + k4_);
+  }
+
+  // Stage buffers reused by Step so that steady-state steps do not allocate.
+  TState k1_;
+  TState k2_;
+  TState k3_;
+  TState k4_;
+  TState stage_;
 };
 }  // namespace GLOO
 
@@ -0,0 +1,369 @@
+#include "SceneConfig.hpp"
+
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include "gloo/parsers/ObjParser.hpp"
+#include "gloo/utils.hpp"
+
+namespace GLOO {
+namespace {
+enum class Block { None, Circular, Pendulum, Cloth };
+
+// Margins of scene colliders: planes keep particles as far off as the ground
+// does, other shapes as far as the ball does.
+const float kColliderMargin = .12f;
+const float kPlaneMargin = .05f;
+const float kDegreesToRadians = 3.14159265f / 180.0f;
+// Mesh fields hold exact distances this many cells beyond the margin.
+const float kFieldBandCells = 3.0f;
+
+// The axes of a box turned by angles degrees about the x, then the y, then
+// the z axis.
+glm::mat3 RotatedAxes(const glm::vec3& angles) {
+  glm::vec3 c, s;
+  for (int axis = 0; axis < 3; axis++) {
+    c[axis] = std::cos(angles[axis] * kDegreesToRadians);
+    s[axis] = std::sin(angles[axis] * kDegreesToRadians);
+  }
+  glm::mat3 x(glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, c.x, s.x),
+              glm::vec3(0.0f, -s.x, c.x));
+  glm::mat3 y(glm::vec3(c.y, 0.0f, -s.y), glm::vec3(0.0f, 1.0f, 0.0f),
+              glm::vec3(s.y, 0.0f, c.y));
+  glm::mat3 z(glm::vec3(c.z, s.z, 0.0f), glm::vec3(-s.z, c.z, 0.0f),
+              glm::vec3(0.0f, 0.0f, 1.0f));
+  return z * y * x;
+}
+
+class LineReader {
+ public:
+  LineReader(const std::string& file_path, int line_number, const std::string& line)
+      : file_path_(file_path), line_number_(line_number), stream_(line) {
+  }
+
+  std::string ReadKeyword() {
+    std::string keyword;
+    stream_ >> keyword;
+    return keyword;
+  }
+  float ReadFloat() {
+    float value;
+    if (!(stream_ >> value))
+      Fail("expected a number");
+    return value;
+  }
+  int ReadInt() {
+    int value;
+    if (!(stream_ >> value))
+      Fail("expected an integer");
+    return value;
+  }
+  glm::vec3 ReadVec3() {
+    float x = ReadFloat();
+    float y = ReadFloat();
+    float z = ReadFloat();
+    return glm::vec3(x, y, z);
+  }
+  IntegratorType ReadIntegratorType() {
+    std::string code;
+    if (!(stream_ >> code) || code.size() != 1)
+      Fail("expected an integrator letter");
+    return ParseIntegratorType(code[0]);
+  }
+  void ExpectEnd() {
+    std::string rest;
+    if (stream_ >> rest && rest[0] != '#')
+      Fail("unexpected '" + rest + "'");
+  }
+  [[noreturn]] void Fail(const std::string& message) const {
+    throw std::runtime_error(file_path_ + ":" + std::to_string(line_number_) +
+                             ": " + message + "!");
+  }
+
+ private:
+  const std::string& file_path_;
+  int line_number_;
+  std::stringstream stream_;
+};
+
+// The signed distance field of an OBJ mesh from the assets directory,
+// scaled about its origin and then moved by offset. It is cached next to
+// the mesh, and baked again whenever the mesh or the settings change.
+std::shared_ptr<const SignedDistanceField> LoadMeshField(
+    const LineReader& reader,
+    const std::string& file_name,
+    const glm::vec3& offset,
+    float scale,
+    float cell_size) {
+  std::string file_path = GetAssetDir() + file_name;
+  bool success;
+  ObjParser::ParsedData mesh = ObjParser::Parse(file_path, success);
+  if (!success || mesh.positions == nullptr || mesh.indices == nullptr ||
+      mesh.indices->empty())
+    reader.Fail("unable to load a triangle mesh from " + file_name);
+  std::vector<glm::vec3> positions;
+  for (const glm::vec3& position : *mesh.positions) {
+    positions.push_back(position * scale + offset);
+  }
+  std::vector<glm::ivec3> triangles;
+  const auto& indices = *mesh.indices;
+  for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+    triangles.push_back(glm::ivec3(indices[i], indices[i + 1], indices[i + 2]));
+  }
+  try {
+    return LoadOrBakeSignedDistanceField(
+        file_path + ".sdf", positions, triangles, cell_size,
+        kFieldBandCells * cell_size + kColliderMargin);
+  } catch (const std::runtime_error& e) {
+    // Fail adds its own exclamation mark.
+    std::string message = e.what();
+    if (!message.empty() && message.back() == '!')
+      message.pop_back();
+    reader.Fail(message);
+  }
+}
+
+// Keywords shared by every block. Returns false for other keywords.
+template <class TConfig>
+bool ReadObjectKeyword(LineReader& reader,
+                       const std::string& keyword,
+                       TConfig& config) {
+  if (keyword == "position") {
+    config.position = reader.ReadVec3();
+  } else if (keyword == "step") {
+    config.integration_step = reader.ReadFloat();
+    if (config.integration_step <= 0.0f)
+      reader.Fail("step must be positive");
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// The error tolerances of adaptive integrators.
+void ReadTolerances(LineReader& reader, AdaptiveTolerances& tolerances) {
+  tolerances.relative = reader.ReadFloat();
+  tolerances.absolute = reader.ReadFloat();
+  if (tolerances.relative <= 0.0f || tolerances.absolute <= 0.0f)
+    reader.Fail("tolerances must be positive");
+}
+
+void ReadClothKeyword(LineReader& reader,
+                      const std::string& keyword,
+                      ClothConfig& cloth,
+                      bool& pins_given) {
+  if (ReadObjectKeyword(reader, keyword, cloth))
+    return;
+  ClothParameters& parameters = cloth.parameters;
+  if (keyword == "integrator") {
+    cloth.integrator_type = reader.ReadIntegratorType();
+  } else if (keyword == "tolerance") {
+    ReadTolerances(reader, parameters.tolerances);
+  } else if (keyword == "soa_layout") {
+    parameters.soa_layout = true;
+  } else if (keyword == "resolution") {
+    parameters.resolution = reader.ReadInt();
+    if (parameters.resolution < 2)
+      reader.Fail("resolution must be at least 2");
+  } else if (keyword == "width") {
+    parameters.width = reader.ReadFloat();
+  } else if (keyword == "mass") {
+    parameters.mass = reader.ReadFloat();
+  } else if (keyword == "stiffness") {
+    parameters.stiffness = reader.ReadFloat();
+  } else if (keyword == "flex_scale") {
+    parameters.flex_scale = reader.ReadFloat();
+  } else if (keyword == "drag") {
+    parameters.drag = reader.ReadFloat();
+  } else if (keyword == "gravity") {
+    parameters.gravity = reader.ReadVec3();
+  } else if (keyword == "pin") {
+    // The first pin replaces the default corner pins.
+    if (!pins_given)
+      parameters.pins.clear();
+    pins_given = true;
+    int row = reader.ReadInt();
+    int col = reader.ReadInt();
+    parameters.pins.push_back(glm::ivec2(row, col));
+  } else if (keyword == "no_pins") {
+    parameters.pins.clear();
+    pins_given = true;
+  } else if (keyword == "ball") {
+    parameters.ball = true;
+    parameters.ball_position = reader.ReadVec3();
+    parameters.ball_radius = reader.ReadFloat();
+  } else if (keyword == "no_ball") {
+    parameters.ball = false;
+  } else if (keyword == "ground") {
+    parameters.ground_height = reader.ReadFloat();
+  } else if (keyword == "sphere") {
+    SphereCollider sphere;
+    sphere.center = reader.ReadVec3();
+    sphere.radius = reader.ReadFloat();
+    if (sphere.radius <= 0.0f)
+      reader.Fail("sphere radius must be positive");
+    parameters.colliders.AddSphere(sphere, kColliderMargin);
+  } else if (keyword == "capsule") {
+    CapsuleCollider capsule;
+    capsule.start = reader.ReadVec3();
+    capsule.end = reader.ReadVec3();
+    capsule.radius = reader.ReadFloat();
+    if (capsule.radius <= 0.0f)
+      reader.Fail("capsule radius must be positive");
+    parameters.colliders.AddCapsule(capsule, kColliderMargin);
+  } else if (keyword == "box") {
+    BoxCollider box;
+    box.center = reader.ReadVec3();
+    box.half_extents = reader.ReadVec3();
+    box.axes = RotatedAxes(reader.ReadVec3());
+    if (box.half_extents.x <= 0.0f || box.half_extents.y <= 0.0f ||
+        box.half_extents.z <= 0.0f)
+      reader.Fail("box half extents must be positive");
+    parameters.colliders.AddBox(box, kColliderMargin);
+  } else if (keyword == "mesh") {
+    std::string file_name = reader.ReadKeyword();
+    if (file_name.empty())
+      reader.Fail("expected an OBJ file");
+    glm::vec3 offset = reader.ReadVec3();
+    float scale = reader.ReadFloat();
+    float cell_size = reader.ReadFloat();
+    if (scale <= 0.0f || cell_size <= 0.0f)
+      reader.Fail("mesh scale and cell size must be positive");
+    parameters.colliders.AddField(
+        LoadMeshField(reader, file_name, offset, scale, cell_size),
+        kColliderMargin);
+  } else if (keyword == "plane") {
+    PlaneCollider plane;
+    plane.normal = reader.ReadVec3();
+    plane.offset = reader.ReadFloat();
+    if (glm::length(plane.normal) <= 0.0f)
+      reader.Fail("plane normal must not be zero");
+    parameters.colliders.AddPlane(plane, kPlaneMargin);
+  } else if (keyword == "self_collision") {
+    parameters.self_collision_thickness = reader.ReadFloat();
+    if (parameters.self_collision_thickness <= 0.0f)
+      reader.Fail("self_collision thickness must be positive");
+  } else if (keyword == "continuous_collision") {
+    parameters.continuous_collision = true;
+  } else if (keyword == "swept_spheres") {
+    parameters.swept_spheres = true;
+  } else if (keyword == "checkpoint") {
+    parameters.checkpoint = reader.ReadKeyword();
+    if (parameters.checkpoint.empty())
+      reader.Fail("expected a checkpoint file");
+  } else if (keyword == "record") {
+    cloth.record_path = reader.ReadKeyword();
+    if (cloth.record_path.empty())
+      reader.Fail("expected a trajectory file");
+  } else if (keyword == "playback") {
+    cloth.playback_path = reader.ReadKeyword();
+    if (cloth.playback_path.empty())
+      reader.Fail("expected a trajectory file");
+  } else {
+    reader.Fail("unknown cloth keyword '" + keyword + "'");
+  }
+}
+}  // namespace
+
+SceneConfig CreateDefaultSceneConfig(IntegratorType integrator_type,
+                                     float integration_step) {
+  SceneConfig config;
+  config.circulars.push_back(
+      CircularConfig{integration_step, glm::vec3(-10.5f, 0.0f, 0.0f)});
+  config.pendulums.push_back(PendulumConfig{
+      integrator_type, integration_step, glm::vec3(-7.5f, 0.0f, 0.0f)});
+  ClothConfig cloth;
+  cloth.integrator_type = integrator_type;
+  cloth.integration_step = integration_step;
+  cloth.position = glm::vec3(0.0f);
+  cloth.parameters.ground_height = config.ground_height;
+  config.cloths.push_back(cloth);
+  return config;
+}
+
+SceneConfig LoadSceneConfig(const std::string& file_path,
+                            IntegratorType integrator_type,
+                            float integration_step) {
+  std::ifstream fs(file_path);
+  if (!fs) {
+    throw std::runtime_error("Unable to open scene file " + file_path + "!");
+  }
+
+  SceneConfig config;
+  Block block = Block::None;
+  bool pins_given = false;
+  std::string line;
+  int line_number = 0;
+  while (std::getline(fs, line)) {
+    line_number++;
+    LineReader reader(file_path, line_number, line);
+    std::string keyword = reader.ReadKeyword();
+    if (keyword.empty() || keyword[0] == '#')
+      continue;
+
+    if (block == Block::None) {
+      if (keyword == "ground") {
+        config.ground_height = reader.ReadFloat();
+      } else if (keyword == "simulation_thread") {
+        config.simulation_thread = reader.ReadInt() != 0;
+      } else if (keyword == "simulation_rate") {
+        config.simulation_rate = reader.ReadFloat();
+        if (config.simulation_rate < 0.0f)
+          reader.Fail("simulation_rate must not be negative");
+      } else if (keyword == "deterministic") {
+        config.deterministic = reader.ReadInt() != 0;
+      } else if (keyword == "state_hash_interval") {
+        config.state_hash_interval = reader.ReadInt();
+        if (config.state_hash_interval < 0)
+          reader.Fail("state_hash_interval must not be negative");
+      } else if (keyword == "circular") {
+        config.circulars.push_back(
+            CircularConfig{integration_step, glm::vec3(0.0f)});
+        block = Block::Circular;
+      } else if (keyword == "pendulum") {
+        config.pendulums.push_back(
+            PendulumConfig{integrator_type, integration_step, glm::vec3(0.0f)});
+        block = Block::Pendulum;
+      } else if (keyword == "cloth") {
+        ClothConfig cloth;
+        cloth.integrator_type = integrator_type;
+        cloth.integration_step = integration_step;
+        cloth.position = glm::vec3(0.0f);
+        // Cloths collide with the scene's ground unless they set their own.
+        cloth.parameters.ground_height = config.ground_height;
+        config.cloths.push_back(cloth);
+        pins_given = false;
+        block = Block::Cloth;
+      } else {
+        reader.Fail("unknown keyword '" + keyword + "'");
+      }
+    } else if (keyword == "end") {
+      block = Block::None;
+    } else if (block == Block::Circular) {
+      if (!ReadObjectKeyword(reader, keyword, config.circulars.back()))
+        reader.Fail("unknown circular keyword '" + keyword + "'");
+    } else if (block == Block::Pendulum) {
+      PendulumConfig& pendulum = config.pendulums.back();
+      if (keyword == "integrator") {
+        pendulum.integrator_type = reader.ReadIntegratorType();
+      } else if (keyword == "tolerance") {
+        ReadTolerances(reader, pendulum.tolerances);
+      } else if (!ReadObjectKeyword(reader, keyword, pendulum)) {
+        reader.Fail("unknown pendulum keyword '" + keyword + "'");
+      }
+    } else {
+      ReadClothKeyword(reader, keyword, config.cloths.back(), pins_given);
+    }
+    reader.ExpectEnd();
+  }
+  if (block != Block::None) {
+    throw std::runtime_error("Missing 'end' in scene file " + file_path + "!");
+  }
+  // Scene-wide, so the line may come after the cloth blocks.
+  for (ClothConfig& cloth : config.cloths)
+    cloth.parameters.deterministic = config.deterministic;
+  return config;
+}
+}  // namespace GLOO
@@ -0,0 +1,81 @@
+#ifndef SCENE_CONFIG_H_
+#define SCENE_CONFIG_H_
+
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "ClothSimulation.hpp"
+#include "IntegratorType.hpp"
+
+namespace GLOO {
+struct CircularConfig {
+  float integration_step;
+  glm::vec3 position;
+};
+
+struct PendulumConfig {
+  IntegratorType integrator_type;
+  float integration_step;
+  glm::vec3 position;
+  AdaptiveTolerances tolerances;
+};
+
+struct ClothConfig {
+  IntegratorType integrator_type;
+  float integration_step;
+  glm::vec3 position;
+  ClothParameters parameters;
+  // Trajectory file every tick's positions are streamed to, empty for none.
+  std::string record_path;
+  // Trajectory file shown in place of simulating the cloth, empty for none.
+  std::string playback_path;
+};
+
+// The simulated objects of the scene and the ground they rest on.
+struct SceneConfig {
+  float ground_height = -12.0f;
+  // Step pendulums and cloths on their own thread, overlapping rendering.
+  // Off runs them inline in the frame, which is easier to debug.
+  bool simulation_thread = true;
+  // Ticks per second of the clock shared by pendulums and cloths, which are
+  // drawn interpolated between ticks. Zero ticks once per frame instead.
+  float simulation_rate = 240.0f;
+  // Step cloths deterministically, see ClothParameters::deterministic, and
+  // print a hash of each cloth's state every state_hash_interval steps if
+  // that is positive.
+  bool deterministic = false;
+  int state_hash_interval = 0;
+  std::vector<CircularConfig> circulars;
+  std::vector<PendulumConfig> pendulums;
+  std::vector<ClothConfig> cloths;
+};
+
+// The original scene: the circular motion demo, the pendulum and one 12x12
+// cloth, all with the given integrator and step.
+SceneConfig CreateDefaultSceneConfig(IntegratorType integrator_type,
+                                     float integration_step);
+
+// Reads a scene description. Objects use the given integrator and step
+// unless their block sets their own. The format is line based, with # for
+// comments:
+//
+//   ground <height>
+//   simulation_thread <0|1>
+//   simulation_rate <hz>
+//   circular | pendulum | cloth
+//     position <x> <y> <z>
+//     integrator <e|s|v|t|r|d|i|x>    (not for circular)
+//     tolerance <relative> <absolute> (not for circular)
+//     step <seconds>
+//     ...cloth keywords, see assets/scenes/default.scene
+//   end
+//
+// Throws std::runtime_error on unreadable files and malformed lines.
+SceneConfig LoadSceneConfig(const std::string& file_path,
+                            IntegratorType integrator_type,
+                            float integration_step);
+}  // namespace GLOO
+
+#endif
@@ -0,0 +1,450 @@
+#include "SignedDistanceField.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+#include "ContinuousCollision.hpp"
+#include "MappedFile.hpp"
+#include "StateHash.hpp"
+
+namespace GLOO {
+namespace {
+const char kMagic[8] = {'G', 'L', 'O', 'O', 'S', 'D', 'F', ' '};
+const uint64_t kAlignment = 8;
+// Samples along any axis; finer grids are refused rather than risking the
+// memory of their brick table.
+const int kMaxSamples = 1024;
+
+uint64_t Align(uint64_t offset) {
+  return (offset + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+// Twice the signed area of the triangle p, q, r projected along x, as the
+// cross product of their y and z coordinates.
+float EdgeFunction(const glm::vec3& p, const glm::vec3& q, const glm::vec3& r) {
+  return (q.y - p.y) * (r.z - p.z) - (q.z - p.z) * (r.y - p.y);
+}
+}  // namespace
+
+const int SignedDistanceField::kBrickSize;
+const int SignedDistanceField::kBrickSamples;
+const int32_t SignedDistanceField::kOutsideBrick;
+const int32_t SignedDistanceField::kInsideBrick;
+
+SignedDistanceField::SignedDistanceField(
+    const std::vector<glm::vec3>& positions,
+    const std::vector<glm::ivec3>& triangles,
+    float cell_size,
+    float band)
+    : cell_size_(cell_size),
+      band_(band),
+      source_hash_(HashMesh(positions, triangles, cell_size, band)) {
+  if (triangles.empty()) {
+    throw std::runtime_error(
+        "A signed distance field needs at least one triangle!");
+  }
+  if (!(cell_size > 0.0f) || !(band > 0.0f)) {
+    throw std::runtime_error(
+        "Signed distance field cell size and band must be positive!");
+  }
+  int vertex_count = int(positions.size());
+  glm::vec3 box_min(0.0f);
+  glm::vec3 box_max(0.0f);
+  for (size_t t = 0; t < triangles.size(); t++) {
+    for (int corner = 0; corner < 3; corner++) {
+      int vertex = triangles[t][corner];
+      if (vertex < 0 || vertex >= vertex_count) {
+        throw std::runtime_error("Mesh triangle index is out of range!");
+      }
+      if (t == 0 && corner == 0) {
+        box_min = box_max = positions[vertex];
+      }
+      box_min = glm::min(box_min, positions[vertex]);
+      box_max = glm::max(box_max, positions[vertex]);
+    }
+  }
+  // A cell beyond the band on every side, so the outermost samples are all
+  // outside the band.
+  glm::vec3 padding(band + cell_size);
+  origin_ = box_min - padding;
+  for (int axis = 0; axis < 3; axis++) {
+    float extent = box_max[axis] + padding[axis] - origin_[axis];
+    float count = std::ceil(extent / cell_size) + 1.0f;
+    if (count > float(kMaxSamples)) {
+      throw std::runtime_error(
+          "Signed distance field cell size is too fine for the mesh!");
+    }
+    sample_counts_[axis] = int(count);
+    brick_grid_[axis] = (sample_counts_[axis] + kBrickSize - 1) / kBrickSize;
+  }
+  brick_indices_.assign(
+      size_t(brick_grid_.x) * size_t(brick_grid_.y) * size_t(brick_grid_.z),
+      kOutsideBrick);
+
+  // Unsigned distances to the nearest triangle, at every sample within band
+  // of some triangle's bounding box.
+  for (const glm::ivec3& triangle : triangles) {
+    const glm::vec3& a = positions[triangle.x];
+    const glm::vec3& b = positions[triangle.y];
+    const glm::vec3& c = positions[triangle.z];
+    glm::vec3 low = (glm::min(glm::min(a, b), c) - glm::vec3(band) - origin_) /
+                    cell_size;
+    glm::vec3 high =
+        (glm::max(glm::max(a, b), c) + glm::vec3(band) - origin_) / cell_size;
+    glm::ivec3 first, last;
+    for (int axis = 0; axis < 3; axis++) {
+      first[axis] = std::max(0, int(std::ceil(low[axis])));
+      last[axis] =
+          std::min(sample_counts_[axis] - 1, int(std::floor(high[axis])));
+    }
+    for (int i = first.x; i <= last.x; i++) {
+      for (int j = first.y; j <= last.y; j++) {
+        for (int k = first.z; k <= last.z; k++) {
+          int32_t& brick = brick_indices_[BrickOf(i, j, k)];
+          if (brick < 0) {
+            brick = int32_t(samples_.size() / kBrickSamples);
+            samples_.resize(samples_.size() + kBrickSamples, band);
+          }
+          float& sample = samples_[size_t(brick) * kBrickSamples +
+                                   ((i % kBrickSize) * kBrickSize +
+                                    j % kBrickSize) * kBrickSize +
+                                   k % kBrickSize];
+          glm::vec3 p = origin_ + cell_size * glm::vec3(float(i), float(j),
+                                                        float(k));
+          glm::vec3 weights;
+          float distance =
+              glm::length(p - ClosestPointOnTriangle(p, a, b, c, weights));
+          sample = std::min(sample, distance);
+        }
+      }
+    }
+  }
+
+  // Signs from the number of times each row of samples along x crosses the
+  // surface before reaching a sample. A row through an edge or vertex
+  // shared by several triangles is counted for exactly one of them: the
+  // area on either side of each edge is computed from the edge's lower
+  // numbered vertex, so both triangles get the same value with opposite
+  // signs, and rows right on it go to the side the edge points towards.
+  std::vector<std::pair<int, float>> crossings;
+  int rows_z = sample_counts_.z;
+  for (const glm::ivec3& triangle : triangles) {
+    int corners[3] = {triangle.x, triangle.y, triangle.z};
+    const glm::vec3* p[3] = {&positions[corners[0]], &positions[corners[1]],
+                             &positions[corners[2]]};
+    float area = EdgeFunction(*p[0], *p[1], *p[2]);
+    if (area == 0.0f)
+      continue;
+    if (area < 0.0f) {
+      std::swap(corners[1], corners[2]);
+      std::swap(p[1], p[2]);
+      area = -area;
+    }
+    glm::vec3 low = glm::min(glm::min(*p[0], *p[1]), *p[2]);
+    glm::vec3 high = glm::max(glm::max(*p[0], *p[1]), *p[2]);
+    // Rounding can put a row a hair inside the triangle's box but outside
+    // the rows computed from it, so one more row on each side is tried.
+    int first_j = std::max(
+        0, int(std::floor((low.y - origin_.y) / cell_size)));
+    int last_j = std::min(sample_counts_.y - 1,
+                          int(std::ceil((high.y - origin_.y) / cell_size)));
+    int first_k = std::max(
+        0, int(std::floor((low.z - origin_.z) / cell_size)));
+    int last_k = std::min(sample_counts_.z - 1,
+                          int(std::ceil((high.z - origin_.z) / cell_size)));
+    for (int j = first_j; j <= last_j; j++) {
+      for (int k = first_k; k <= last_k; k++) {
+        glm::vec3 row(0.0f, origin_.y + cell_size * float(j),
+                      origin_.z + cell_size * float(k));
+        // weights[e] is the area opposite corner e, on the far side of the
+        // edge from corner e + 1 to corner e + 2.
+        float weights[3];
+        bool inside = true;
+        for (int e = 0; e < 3 && inside; e++) {
+          int from = (e + 1) % 3;
+          int to = (e + 2) % 3;
+          bool flipped = corners[from] > corners[to];
+          const glm::vec3& start = flipped ? *p[to] : *p[from];
+          const glm::vec3& end = flipped ? *p[from] : *p[to];
+          float weight = EdgeFunction(start, end, row);
+          if (flipped)
+            weight = -weight;
+          if (weight == 0.0f) {
+            const glm::vec3& edge_from = *p[from];
+            const glm::vec3& edge_to = *p[to];
+            inside = edge_to.z > edge_from.z ||
+                     (edge_to.z == edge_from.z && edge_to.y < edge_from.y);
+          } else {
+            inside = weight > 0.0f;
+          }
+          weights[e] = weight;
+        }
+        if (!inside)
+          continue;
+        float x = (weights[0] * p[0]->x + weights[1] * p[1]->x +
+                   weights[2] * p[2]->x) /
+                  (weights[0] + weights[1] + weights[2]);
+        crossings.push_back(std::make_pair(j * rows_z + k, x));
+      }
+    }
+  }
+  std::sort(crossings.begin(), crossings.end());
+  // Crossings of row r are crossings[row_starts[r]] to
+  // crossings[row_starts[r + 1] - 1], in increasing x.
+  std::vector<int> row_starts(size_t(sample_counts_.y) * rows_z + 1, 0);
+  for (const auto& crossing : crossings) {
+    row_starts[crossing.first + 1]++;
+  }
+  for (size_t r = 1; r < row_starts.size(); r++) {
+    row_starts[r] += row_starts[r - 1];
+  }
+  auto is_inside = [&](int i, int j, int k) {
+    int row = j * rows_z + k;
+    float x = origin_.x + cell_size * float(i);
+    auto begin = crossings.begin() + row_starts[row];
+    auto end = crossings.begin() + row_starts[row + 1];
+    auto after = std::lower_bound(
+        begin, end, x, [](const std::pair<int, float>& crossing, float x) {
+          return crossing.second < x;
+        });
+    return (after - begin) % 2 == 1;
+  };
+
+  for (int bi = 0; bi < brick_grid_.x; bi++) {
+    for (int bj = 0; bj < brick_grid_.y; bj++) {
+      for (int bk = 0; bk < brick_grid_.z; bk++) {
+        int i0 = bi * kBrickSize;
+        int j0 = bj * kBrickSize;
+        int k0 = bk * kBrickSize;
+        int32_t& brick = brick_indices_[BrickOf(i0, j0, k0)];
+        if (brick < 0) {
+          // No triangle is near, so the whole brick is on the side of its
+          // first sample.
+          brick = is_inside(i0, j0, k0) ? kInsideBrick : kOutsideBrick;
+          continue;
+        }
+        float* samples = &samples_[size_t(brick) * kBrickSamples];
+        int end_i = std::min(kBrickSize, sample_counts_.x - i0);
+        int end_j = std::min(kBrickSize, sample_counts_.y - j0);
+        int end_k = std::min(kBrickSize, sample_counts_.z - k0);
+        for (int i = 0; i < end_i; i++) {
+          for (int j = 0; j < end_j; j++) {
+            for (int k = 0; k < end_k; k++) {
+              if (is_inside(i0 + i, j0 + j, k0 + k)) {
+                float& sample =
+                    samples[(i * kBrickSize + j) * kBrickSize + k];
+                sample = -sample;
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+SignedDistanceField::SignedDistanceField(const std::string& file_path) {
+  MappedFile file(file_path);
+  if (file.GetSize() < sizeof(SignedDistanceFieldHeader)) {
+    throw std::runtime_error(file_path +
+                             " is too short for a signed distance field!");
+  }
+  SignedDistanceFieldHeader header;
+  std::memcpy(&header, file.GetData(), sizeof(header));
+  if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+    throw std::runtime_error(file_path + " is not a signed distance field!");
+  }
+  if (header.version != kSignedDistanceFieldVersion) {
+    throw std::runtime_error(
+        file_path + " has unsupported signed distance field version " +
+        std::to_string(header.version) + "!");
+  }
+
+  uint64_t brick_cells = 1;
+  for (int axis = 0; axis < 3; axis++) {
+    if (header.sample_counts[axis] < 2 ||
+        header.sample_counts[axis] > kMaxSamples ||
+        header.brick_grid[axis] !=
+            (header.sample_counts[axis] + kBrickSize - 1) / kBrickSize) {
+      throw std::runtime_error(file_path + " has an invalid grid!");
+    }
+    brick_cells *= uint64_t(header.brick_grid[axis]);
+  }
+  uint64_t file_size = file.GetSize();
+  uint64_t sample_count = uint64_t(header.brick_count) * kBrickSamples;
+  if (header.file_size != file_size || header.bricks_offset % kAlignment ||
+      header.samples_offset % kAlignment ||
+      header.bricks_offset > file_size ||
+      brick_cells > (file_size - header.bricks_offset) / sizeof(int32_t) ||
+      header.samples_offset > file_size ||
+      sample_count > (file_size - header.samples_offset) / sizeof(float)) {
+    throw std::runtime_error(file_path + " is truncated or corrupt!");
+  }
+
+  origin_ = glm::vec3(header.origin[0], header.origin[1], header.origin[2]);
+  cell_size_ = header.cell_size;
+  band_ = header.band;
+  sample_counts_ = glm::ivec3(header.sample_counts[0], header.sample_counts[1],
+                              header.sample_counts[2]);
+  brick_grid_ = glm::ivec3(header.brick_grid[0], header.brick_grid[1],
+                           header.brick_grid[2]);
+  source_hash_ = header.source_hash;
+  brick_indices_.resize(brick_cells);
+  std::memcpy(brick_indices_.data(), file.GetData() + header.bricks_offset,
+              brick_cells * sizeof(int32_t));
+  samples_.resize(sample_count);
+  std::memcpy(samples_.data(), file.GetData() + header.samples_offset,
+              sample_count * sizeof(float));
+  for (int32_t brick : brick_indices_) {
+    if (brick < kInsideBrick || brick >= int32_t(header.brick_count)) {
+      throw std::runtime_error(file_path + " is truncated or corrupt!");
+    }
+  }
+}
+
+void SignedDistanceField::Save(const std::string& file_path) const {
+  SignedDistanceFieldHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kSignedDistanceFieldVersion;
+  header.brick_count = uint32_t(samples_.size() / kBrickSamples);
+  header.source_hash = source_hash_;
+  for (int axis = 0; axis < 3; axis++) {
+    header.origin[axis] = origin_[axis];
+    header.sample_counts[axis] = sample_counts_[axis];
+    header.brick_grid[axis] = brick_grid_[axis];
+  }
+  header.cell_size = cell_size_;
+  header.band = band_;
+  header.bricks_offset = Align(sizeof(header));
+  header.samples_offset = Align(header.bricks_offset +
+                                brick_indices_.size() * sizeof(int32_t));
+  header.file_size = header.samples_offset + samples_.size() * sizeof(float);
+
+  std::ofstream fs(file_path, std::ios::binary | std::ios::trunc);
+  if (!fs) {
+    throw std::runtime_error("Unable to create signed distance field " +
+                             file_path + "!");
+  }
+  static const char zeros[kAlignment] = {};
+  fs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  fs.write(zeros, std::streamsize(header.bricks_offset - sizeof(header)));
+  fs.write(reinterpret_cast<const char*>(brick_indices_.data()),
+           std::streamsize(brick_indices_.size() * sizeof(int32_t)));
+  fs.write(zeros, std::streamsize(header.samples_offset -
+                                  uint64_t(fs.tellp())));
+  fs.write(reinterpret_cast<const char*>(samples_.data()),
+           std::streamsize(samples_.size() * sizeof(float)));
+  if (!fs.flush()) {
+    throw std::runtime_error("Unable to write signed distance field " +
+                             file_path + "!");
+  }
+}
+
+float SignedDistanceField::Evaluate(const glm::vec3& p,
+                                    glm::vec3& gradient) const {
+  glm::vec3 u = (p - origin_) / cell_size_;
+  glm::ivec3 cell;
+  glm::vec3 f;
+  for (int axis = 0; axis < 3; axis++) {
+    if (!(u[axis] >= 0.0f && u[axis] <= float(sample_counts_[axis] - 1))) {
+      gradient = glm::vec3(0.0f);
+      return band_;
+    }
+    cell[axis] = std::min(int(u[axis]), sample_counts_[axis] - 2);
+    f[axis] = u[axis] - float(cell[axis]);
+  }
+  // c[x][y][z] is the sample at the corner offset by x, y and z cells.
+  float c[2][2][2];
+  for (int x = 0; x < 2; x++) {
+    for (int y = 0; y < 2; y++) {
+      for (int z = 0; z < 2; z++) {
+        c[x][y][z] = Sample(cell.x + x, cell.y + y, cell.z + z);
+      }
+    }
+  }
+  // Interpolated along z, then y, then x, with the derivatives along the
+  // way.
+  float along_z[2][2];
+  float dz[2][2];
+  for (int x = 0; x < 2; x++) {
+    for (int y = 0; y < 2; y++) {
+      along_z[x][y] = c[x][y][0] + f.z * (c[x][y][1] - c[x][y][0]);
+      dz[x][y] = c[x][y][1] - c[x][y][0];
+    }
+  }
+  float along_y[2];
+  float dy[2];
+  float dz_y[2];
+  for (int x = 0; x < 2; x++) {
+    along_y[x] = along_z[x][0] + f.y * (along_z[x][1] - along_z[x][0]);
+    dy[x] = along_z[x][1] - along_z[x][0];
+    dz_y[x] = dz[x][0] + f.y * (dz[x][1] - dz[x][0]);
+  }
+  gradient = glm::vec3(along_y[1] - along_y[0],
+                       dy[0] + f.x * (dy[1] - dy[0]),
+                       dz_y[0] + f.x * (dz_y[1] - dz_y[0])) /
+             cell_size_;
+  return along_y[0] + f.x * (along_y[1] - along_y[0]);
+}
+
+uint64_t SignedDistanceField::HashMesh(
+    const std::vector<glm::vec3>& positions,
+    const std::vector<glm::ivec3>& triangles,
+    float cell_size,
+    float band) {
+  float settings[2] = {cell_size, band};
+  uint64_t hash = HashBytes(settings, sizeof(settings));
+  hash = HashBytes(positions.data(), positions.size() * sizeof(glm::vec3),
+                   hash);
+  return HashBytes(triangles.data(), triangles.size() * sizeof(glm::ivec3),
+                   hash);
+}
+
+float SignedDistanceField::Sample(int i, int j, int k) const {
+  int32_t brick = brick_indices_[BrickOf(i, j, k)];
+  if (brick == kOutsideBrick)
+    return band_;
+  if (brick == kInsideBrick)
+    return -band_;
+  return samples_[size_t(brick) * kBrickSamples +
+                  ((i % kBrickSize) * kBrickSize + j % kBrickSize) *
+                      kBrickSize +
+                  k % kBrickSize];
+}
+
+int SignedDistanceField::BrickOf(int i, int j, int k) const {
+  return ((i / kBrickSize) * brick_grid_.y + j / kBrickSize) * brick_grid_.z +
+         k / kBrickSize;
+}
+
+std::shared_ptr<const SignedDistanceField> LoadOrBakeSignedDistanceField(
+    const std::string& cache_path,
+    const std::vector<glm::vec3>& positions,
+    const std::vector<glm::ivec3>& triangles,
+    float cell_size,
+    float band) {
+  uint64_t hash =
+      SignedDistanceField::HashMesh(positions, triangles, cell_size, band);
+  try {
+    auto field = std::make_shared<const SignedDistanceField>(cache_path);
+    if (field->GetSourceHash() == hash)
+      return field;
+  } catch (const std::runtime_error&) {
+    // Missing or unreadable caches are baked again, like stale ones.
+  }
+  auto field = std::make_shared<const SignedDistanceField>(
+      positions, triangles, cell_size, band);
+  try {
+    field->Save(cache_path);
+  } catch (const std::runtime_error& e) {
+    std::cerr << e.what() << std::endl;
+  }
+  return field;
+}
+}  // namespace GLOO
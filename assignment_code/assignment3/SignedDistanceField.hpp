@@ -0,0 +1,133 @@
+#ifndef SIGNED_DISTANCE_FIELD_H_
+#define SIGNED_DISTANCE_FIELD_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace GLOO {
+// Version 1 of the signed distance field format: this header, followed by
+// the arrays at the offsets it gives, each 8-byte aligned, in the writing
+// machine's byte order. Bump kSignedDistanceFieldVersion whenever the layout
+// or the baking changes, so stale caches are baked again.
+const uint32_t kSignedDistanceFieldVersion = 1;
+
+struct SignedDistanceFieldHeader {
+  // "GLOOSDF ", unterminated.
+  char magic[8];
+  uint32_t version;
+  uint32_t brick_count;
+  // HashMesh of the mesh and settings the field was baked from.
+  uint64_t source_hash;
+  float origin[3];
+  float cell_size;
+  float band;
+  int32_t sample_counts[3];
+  int32_t brick_grid[3];
+  uint32_t padding;
+
+  // int32_t[brick_grid[0] * brick_grid[1] * brick_grid[2]].
+  uint64_t bricks_offset;
+  // float[brick_count * kBrickSamples].
+  uint64_t samples_offset;
+  uint64_t file_size;
+};
+static_assert(sizeof(SignedDistanceFieldHeader) == 96,
+              "SignedDistanceFieldHeader must not gain padding.");
+
+// The signed distance to a closed triangle mesh, negative inside, sampled
+// on a grid only near the surface. Samples come in bricks of 8 x 8 x 8, and
+// only bricks within band of a triangle are stored, so memory grows with
+// the surface area over the squared cell size rather than with the volume.
+// Looking up the distance costs the same however many triangles the mesh
+// has.
+class SignedDistanceField {
+ public:
+  static const int kBrickSize = 8;
+  static const int kBrickSamples = kBrickSize * kBrickSize * kBrickSize;
+
+  // Bakes the field of triangles, given as indices into positions, with
+  // samples cell_size apart and exact distances up to band from the
+  // surface. Inside is told from outside by counting the surface crossings
+  // along x, so the mesh must be closed. Throws std::runtime_error for an
+  // empty mesh, sizes that are not positive, or a grid too fine for the
+  // mesh.
+  SignedDistanceField(const std::vector<glm::vec3>& positions,
+                      const std::vector<glm::ivec3>& triangles,
+                      float cell_size,
+                      float band);
+  // Reads a field written by Save. Throws std::runtime_error for files that
+  // are not valid fields.
+  explicit SignedDistanceField(const std::string& file_path);
+
+  // Throws std::runtime_error if the file cannot be written.
+  void Save(const std::string& file_path) const;
+
+  // The distance at p, interpolated trilinearly between the eight samples
+  // around it, and the gradient of that interpolation. Beyond the band the
+  // distance is band, or -band deep inside, with a zero gradient.
+  float Evaluate(const glm::vec3& p, glm::vec3& gradient) const;
+
+  // The sampled box; everything outside it is further than band outside.
+  glm::vec3 GetBoxMin() const {
+    return origin_;
+  }
+  glm::vec3 GetBoxMax() const {
+    return origin_ + cell_size_ * glm::vec3(float(sample_counts_.x - 1),
+                                            float(sample_counts_.y - 1),
+                                            float(sample_counts_.z - 1));
+  }
+  float GetBand() const {
+    return band_;
+  }
+  uint64_t GetSourceHash() const {
+    return source_hash_;
+  }
+  // Bytes of samples stored, for judging how sparse the field is.
+  size_t GetSampleBytes() const {
+    return samples_.size() * sizeof(float);
+  }
+
+  // A hash of everything a bake depends on, for telling whether a saved
+  // field still matches.
+  static uint64_t HashMesh(const std::vector<glm::vec3>& positions,
+                           const std::vector<glm::ivec3>& triangles,
+                           float cell_size,
+                           float band);
+
+ private:
+  // Values of brick_indices_ for bricks without samples.
+  static const int32_t kOutsideBrick = -1;
+  static const int32_t kInsideBrick = -2;
+
+  float Sample(int i, int j, int k) const;
+  int BrickOf(int i, int j, int k) const;
+
+  glm::vec3 origin_;
+  float cell_size_;
+  float band_;
+  glm::ivec3 sample_counts_;
+  glm::ivec3 brick_grid_;
+  uint64_t source_hash_;
+  // Per brick of the grid, with z varying fastest, the index of its samples
+  // in samples_, or whether it lies wholly outside or inside the mesh.
+  std::vector<int32_t> brick_indices_;
+  // kBrickSamples per stored brick, with z varying fastest.
+  std::vector<float> samples_;
+};
+
+// The field of the mesh from cache_path if a field of the same mesh and
+// settings was saved there, or else a newly baked one, which is saved there
+// for next time. Failing to save only costs the next run another bake.
+std::shared_ptr<const SignedDistanceField> LoadOrBakeSignedDistanceField(
+    const std::string& cache_path,
+    const std::vector<glm::vec3>& positions,
+    const std::vector<glm::ivec3>& triangles,
+    float cell_size,
+    float band);
+}  // namespace GLOO
+
+#endif
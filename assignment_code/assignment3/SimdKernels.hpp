@@ -0,0 +1,69 @@
+#ifndef SIMD_KERNELS_H_
+#define SIMD_KERNELS_H_
+
+#include <cstddef>
+
+#if defined(__AVX2__) || defined(__AVX__)
+#include <immintrin.h>
+#define GLOO_SIMD_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GLOO_SIMD_SSE
+#endif
+
+namespace GLOO {
+// Number of floats processed per iteration by the kernels below. Arrays passed
+// to them must be aligned to kSimdAlignment bytes and padded to a multiple of
+// kSimdWidth elements.
+const size_t kSimdWidth = 8;
+const size_t kSimdAlignment = 32;
+
+inline size_t PadToSimdWidth(size_t n) {
+  return (n + kSimdWidth - 1) / kSimdWidth * kSimdWidth;
+}
+
+// y += a * x
+inline void SimdAxpy(float a, const float* x, float* y, size_t n) {
+#if defined(GLOO_SIMD_AVX)
+  __m256 va = _mm256_set1_ps(a);
+  for (size_t i = 0; i < n; i += 8) {
+    __m256 vy = _mm256_load_ps(y + i);
+    __m256 vx = _mm256_load_ps(x + i);
+    _mm256_store_ps(y + i, _mm256_add_ps(vy, _mm256_mul_ps(va, vx)));
+  }
+#elif defined(GLOO_SIMD_SSE)
+  __m128 va = _mm_set1_ps(a);
+  for (size_t i = 0; i < n; i += 4) {
+    __m128 vy = _mm_load_ps(y + i);
+    __m128 vx = _mm_load_ps(x + i);
+    _mm_store_ps(y + i, _mm_add_ps(vy, _mm_mul_ps(va, vx)));
+  }
+#else
+  for (size_t i = 0; i < n; i++) {
+    y[i] += a * x[i];
+  }
+#endif
+}
+
+// y *= k
+inline void SimdScale(float k, float* y, size_t n) {
+#if defined(GLOO_SIMD_AVX)
+  __m256 vk = _mm256_set1_ps(k);
+  for (size_t i = 0; i < n; i += 8) {
+    _mm256_store_ps(y + i, _mm256_mul_ps(vk, _mm256_load_ps(y + i)));
+  }
+#elif defined(GLOO_SIMD_SSE)
+  __m128 vk = _mm_set1_ps(k);
+  for (size_t i = 0; i < n; i += 4) {
+    _mm_store_ps(y + i, _mm_mul_ps(vk, _mm_load_ps(y + i)));
+  }
+#else
+  for (size_t i = 0; i < n; i++) {
+    y[i] *= k;
+  }
+#endif
+}
+}  // namespace GLOO
+
+#endif
@@ -15,25 +15,30 @@
 #include "gloo/cameras/ArcBallCameraNode.hpp"
 #include "gloo/debug/AxisNode.hpp"
 #include "gloo/debug/PrimitiveFactory.hpp"
+#include "gloo/debug/ProfilerPanel.hpp"
 #include <string>
 #define _USE_MATH_DEFINES
 #include <math.h>
 #include <Raycaster.hpp>
 
 namespace GLOO {
+namespace {
+const char* const kCheckpointFile = "cloth.ckpt";
+}  // namespace
+
 SimulationApp::SimulationApp(const std::string& app_name,
                              glm::ivec2 window_size,
-                             IntegratorType integrator_type,
-                             float integration_step)
+                             const SceneConfig& scene_config,
+                             int thread_count)
     : Application(app_name, window_size),
-      integrator_type_(integrator_type),
-      integration_step_(integration_step) {
-  // TODO: remove the following two lines and use integrator type and step to
-  // create integrators; the lines below exist only to suppress compiler
-  // warnings.
-  UNUSED(integrator_type_);
-  UNUSED(integration_step_);
-  std::cout << "Integration Step: " << integration_step_ << std::endl;
+      scene_config_(scene_config),
+      thread_count_(thread_count),
+      simulation_thread_(make_unique<SimulationThread>(
+          scene_config.simulation_rate > 0.0f
+              ? 1.0 / scene_config.simulation_rate
+              : 0.0,
+          scene_config.simulation_thread)),
+      cloth_node_(nullptr) {
   shader_ = std::make_shared<CheckerShader>();
 
 }
@@ -67,22 +72,41 @@ void SimulationApp::SetupScene() {
 
  
 
-  auto circular_node = make_unique<CircularNode>(integration_step_);
-  circular_node->GetTransform().SetPosition(glm::vec3(-10.5f, 0.0f, 0.0f));
-  root.AddChild(std::move(circular_node));
+  for (const CircularConfig& circular : scene_config_.circulars) {
+    auto circular_node = make_unique<CircularNode>(circular.integration_step);
+    circular_node->GetTransform().SetPosition(circular.position);
+    root.AddChild(std::move(circular_node));
+  }
 
-  auto pendulum_node = make_unique<PendulumNode>(integration_step_, integrator_type_);
-  pendulum_node->GetTransform().SetPosition(glm::vec3(-7.5f, 0.0f, 0.0f));
-  root.AddChild(std::move(pendulum_node));
+  for (const PendulumConfig& pendulum : scene_config_.pendulums) {
+    auto pendulum_node = make_unique<PendulumNode>(pendulum.integration_step, pendulum.integrator_type, pendulum.tolerances, *simulation_thread_);
+    pendulum_node->GetTransform().SetPosition(pendulum.position);
+    root.AddChild(std::move(pendulum_node));
+  }
 
 
   auto raycaster_node = make_unique<Raycaster>(scene_.get(), camera_ptr);
   auto raycast_node = raycaster_node.get();
   root.AddChild(std::move(raycaster_node));
 
-  auto cloth_node = make_unique<ClothNode>(integration_step_, integrator_type_, raycast_node);
-  cloth_node_ = cloth_node.get();
-  root.AddChild(std::move(cloth_node));
+  for (const ClothConfig& cloth : scene_config_.cloths) {
+    auto cloth_node = make_unique<ClothNode>(cloth.integration_step, cloth.integrator_type, cloth.parameters, raycast_node, *simulation_thread_);
+    cloth_node->GetTransform().SetPosition(cloth.position);
+    cloth_node->SetThreadCount(thread_count_);
+    if (!cloth.record_path.empty()) {
+      cloth_node->StartRecording(cloth.record_path);
+    }
+    if (!cloth.playback_path.empty()) {
+      cloth_node->StartPlayback(cloth.playback_path);
+    }
+    if (scene_config_.state_hash_interval > 0) {
+      cloth_node->SetStateHashInterval(scene_config_.state_hash_interval);
+    }
+    if (cloth_node_ == nullptr) {
+      cloth_node_ = cloth_node.get();
+    }
+    root.AddChild(std::move(cloth_node));
+  }
 
 
   auto ground_node = make_unique<SceneNode>();
@@ -94,7 +118,7 @@ void SimulationApp::SetupScene() {
   ground_node->GetComponentPtr<MaterialComponent>()->GetMaterial().SetDiffuseColor(ground_color);
   ground_node->GetComponentPtr<MaterialComponent>()->GetMaterial().SetAmbientColor(ground_color);
   ground_node->CreateComponent<TextureComponent>(std::make_shared<Texture>("grass.png", 10.f));
-  ground_node->GetTransform().SetPosition(glm::vec3(0.f,-12.0f,0.f));
+  ground_node->GetTransform().SetPosition(glm::vec3(0.f, scene_config_.ground_height, 0.f));
   float pi = atan(1) * 4;
   ground_node->GetTransform().SetRotation(glm::vec3(1.0f, 0.f, 0.f), pi/2);
   ground_node->GetTransform().SetScale(glm::vec3(100.0f));
@@ -104,13 +128,71 @@ void SimulationApp::SetupScene() {
   
 }
 
+void SimulationApp::UpdateScene(double delta_time) {
+  // The simulation thread steps this frame while the nodes draw the state it
+  // published last.
+  simulation_thread_->PostFrame(delta_time);
+  Application::UpdateScene(delta_time);
+}
+
 void SimulationApp::DrawGUI() {
     ImGui::Begin("Control Panel");    
     ImGui::Text("Press R to reset simulation");
+    if (cloth_node_ != nullptr) {
+        DrawClothControls();
+    }
+    ImGui::End();
+
+    if (simulation_thread_->IsThreaded()) {
+        simulation_thread_->UpdateProfile();
+        ProfilerPanelChanges changes = DrawProfilerPanel(Profiler::GetInstance(), simulation_thread_->GetProfile(), "Simulation");
+        // The simulation thread's profiler is only touched on that thread.
+        if (changes.enabled_changed) {
+            bool enabled = changes.enabled;
+            simulation_thread_->PostCommand([enabled]() { Profiler::GetInstance().SetEnabled(enabled); });
+        }
+        if (changes.reset) {
+            simulation_thread_->PostCommand([]() { Profiler::GetInstance().Reset(); });
+        }
+    }
+    else {
+        DrawProfilerPanel(Profiler::GetInstance());
+    }
+    }
+
+void SimulationApp::DrawClothControls() {
     ImGui::Text("Press N to inspect cloth normals: %s", cloth_node_->GetNormalsState() ? "ON" : "OFF");
     ImGui::Text("Press T to inspect cloth wireframe: %s", cloth_node_->GetWireframeState() ? "ON" : "OFF");
 
+    if (cloth_node_->IsPlayingBack()) {
+        DrawPlaybackControls();
+    }
+    else {
+        DrawPhysicsControls();
+    }
+
+    if (ImGui::Button("Toggle Diffuse Map")) {
+        cloth_node_->ToggleClothDiffuse();
+    }
+    if (ImGui::Button("Toggle Normal Map")) {
+        cloth_node_->ToggleClothNormal();
+    }
+    if (ImGui::Button("Toggle Visualize Normals")) {
+        cloth_node_->ToggleClothNormalsVis();
+    }
+    if (ImGui::Button("Next map")) {
+        cloth_node_->NextTexture();
+    }
+    }
+
+void SimulationApp::DrawPhysicsControls() {
     ImGui::Text("Press B to toggle ball: %s", cloth_node_->GetBallState() ? "ON" : "OFF");
+    const AdaptiveStepStats* step_stats = cloth_node_->GetAdaptiveStats();
+    if (step_stats != nullptr) {
+        ImGui::Text("Adaptive steps: %ld accepted, %ld rejected",
+                    step_stats->accepted_steps, step_stats->rejected_steps);
+        ImGui::Text("Last step size: %.5f s", step_stats->last_step_size);
+    }
     glm::vec3 gravity = cloth_node_->GetGravity();
     ImGui::SliderFloat("X Gravity", &gravity.x, -100.f, 100.f);
     ImGui::SliderFloat("Y Gravity", &gravity.y, -100.f, 100.f);
@@ -122,6 +204,16 @@ void SimulationApp::DrawGUI() {
     if (ImGui::Button("Toggle Pinning")) {
         cloth_node_->TogglePins();
     }
+    // A cloth block's "checkpoint" line can start from this file
+    if (ImGui::Button("Save Checkpoint")) {
+        cloth_node_->SaveCheckpoint(kCheckpointFile);
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Load Checkpoint")) {
+        cloth_node_->LoadCheckpoint(kCheckpointFile);
+    }
+    ImGui::SameLine();
+    ImGui::Text("%s", kCheckpointFile);
     
     bool wind_on = cloth_node_->GetWindState();
     bool temp = wind_on;
@@ -134,19 +226,19 @@ void SimulationApp::DrawGUI() {
         ImGui::SliderFloat("Wind Strength", &wind_strength, 1.f, 20.f);
         cloth_node_->SetWindStrength(wind_strength);
     }
+}
 
-    if (ImGui::Button("Toggle Diffuse Map")) {
-        cloth_node_->ToggleClothDiffuse();
-    }
-    if (ImGui::Button("Toggle Normal Map")) {
-        cloth_node_->ToggleClothNormal();
-    }
-    if (ImGui::Button("Toggle Visualize Normals")) {
-        cloth_node_->ToggleClothNormalsVis();
-    }
-    if (ImGui::Button("Next map")) {
-        cloth_node_->NextTexture();
+void SimulationApp::DrawPlaybackControls() {
+    // Dragging the slider seeks; the player decodes from the keyframe before the new time
+    float playback_time = float(cloth_node_->GetPlaybackTime());
+    if (ImGui::SliderFloat("Playback Time", &playback_time,
+                           float(cloth_node_->GetPlaybackStartTime()),
+                           float(cloth_node_->GetPlaybackEndTime()), "%.3f s")) {
+        cloth_node_->SeekPlayback(playback_time);
     }
-    ImGui::End();
+    bool paused = cloth_node_->GetPlaybackPaused();
+    if (ImGui::Button(paused ? "Play" : "Pause")) {
+        cloth_node_->SetPlaybackPaused(!paused);
     }
+}
 }  // namespace GLOO
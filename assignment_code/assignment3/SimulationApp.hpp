@@ -4,23 +4,35 @@
 #include "gloo/Application.hpp"
 
 #include "IntegratorType.hpp"
+#include "SceneConfig.hpp"
 #include "CircularNode.hpp"
 #include "PendulumNode.hpp"
 #include "ClothNode.hpp"
+#include "SimulationThread.hpp"
 
 namespace GLOO {
 class SimulationApp : public Application {
  public:
   SimulationApp(const std::string& app_name,
                 glm::ivec2 window_size,
-                IntegratorType integrator_type,
-                float integration_step);
+                const SceneConfig& scene_config,
+                int thread_count);
   void SetupScene() override;
 
+ protected:
+  void UpdateScene(double delta_time) override;
+
  private:
-  IntegratorType integrator_type_;
-  float integration_step_;
+  SceneConfig scene_config_;
+  int thread_count_;
+  // Steps the pendulums and cloths; destroyed, and so joined, before the
+  // scene and its nodes.
+  std::unique_ptr<SimulationThread> simulation_thread_;
   void DrawGUI() override;
+  void DrawClothControls();
+  void DrawPhysicsControls();
+  void DrawPlaybackControls();
+  // The first cloth of the scene, which the control panel drives, or nullptr
   ClothNode* cloth_node_;
   SceneNode* point_light_node_;
   std::shared_ptr<ShaderProgram> shader_;
@@ -0,0 +1,67 @@
+#ifndef SIMULATION_CLOCK_H_
+#define SIMULATION_CLOCK_H_
+
+#include <algorithm>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace GLOO {
+// Turns variable frame times into a whole number of fixed-length ticks, so
+// the physics rate no longer follows the display rate. Time short of a full
+// tick is carried over to the next frame. The render time then lies between
+// the last two ticks, GetAlpha of a tick past the older one, and drawing
+// the states of those ticks blended by alpha keeps motion smooth at any
+// refresh rate.
+class SimulationClock {
+ public:
+  // Frames longer than this, e.g. after a stall in a debugger, are cut
+  // short instead of being caught up on tick by tick.
+  static constexpr double kMaxFrameSeconds = .25;
+
+  // A tick of zero makes every frame a single tick of its own length.
+  explicit SimulationClock(double tick_seconds)
+      : tick_seconds_(tick_seconds), last_frame_seconds_(0.0), accumulator_(0.0) {
+  }
+
+  // Adds a frame of delta_time seconds and returns the number of ticks due.
+  int Advance(double delta_time) {
+    if (tick_seconds_ == 0.0) {
+      last_frame_seconds_ = delta_time;
+      return delta_time > 0.0 ? 1 : 0;
+    }
+    accumulator_ += std::min(delta_time, double(kMaxFrameSeconds));
+    int ticks = int(accumulator_ / tick_seconds_);
+    accumulator_ -= ticks * tick_seconds_;
+    return ticks;
+  }
+
+  double GetTickSeconds() const {
+    return tick_seconds_ == 0.0 ? last_frame_seconds_ : tick_seconds_;
+  }
+  bool IsFixed() const {
+    return tick_seconds_ != 0.0;
+  }
+  // Blend factor from the previous tick's state to the latest one.
+  float GetAlpha() const {
+    return tick_seconds_ == 0.0 ? 1.0f : float(accumulator_ / tick_seconds_);
+  }
+
+ private:
+  double tick_seconds_;
+  double last_frame_seconds_;
+  double accumulator_;
+};
+
+// Blends two ticks' particle positions for drawing, reusing out's storage.
+inline void InterpolatePositions(const std::vector<glm::vec3>& previous,
+                                 const std::vector<glm::vec3>& current,
+                                 float alpha,
+                                 std::vector<glm::vec3>& out) {
+  out.resize(current.size());
+  for (size_t i = 0; i < current.size(); i++)
+    out[i] = previous[i] + (current[i] - previous[i]) * alpha;
+}
+}  // namespace GLOO
+
+#endif
@@ -0,0 +1,94 @@
+#include "SimulationThread.hpp"
+
+#include "gloo/debug/Tracer.hpp"
+
+namespace GLOO {
+SimulationThread::SimulationThread(double tick_seconds, bool threaded)
+    : threaded_(threaded),
+      clock_(tick_seconds),
+      pending_time_(0.0),
+      stopping_(false) {
+}
+
+SimulationThread::~SimulationThread() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_one();
+  if (thread_.joinable())
+    thread_.join();
+}
+
+void SimulationThread::AddTask(Task task) {
+  tasks_.push_back(std::move(task));
+}
+
+void SimulationThread::PostFrame(double delta_time) {
+  if (!threaded_) {
+    std::vector<Command> commands;
+    commands.swap(pending_commands_);
+    RunPass(delta_time, commands);
+    return;
+  }
+
+  // The thread starts with the first frame, once every task is in place.
+  if (!thread_.joinable())
+    thread_ = std::thread(&SimulationThread::Loop, this);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_time_ += delta_time;
+  }
+  wake_.notify_one();
+}
+
+void SimulationThread::PostCommand(Command command) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_commands_.push_back(std::move(command));
+  }
+  if (threaded_)
+    wake_.notify_one();
+}
+
+void SimulationThread::Loop() {
+  Tracer::SetThreadName("Simulation");
+  std::vector<Command> commands;
+  while (true) {
+    double delta_time;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      wake_.wait(lock, [this] {
+        return stopping_ || pending_time_ > 0.0 || !pending_commands_.empty();
+      });
+      if (stopping_)
+        return;
+      delta_time = pending_time_;
+      pending_time_ = 0.0;
+      commands.swap(pending_commands_);
+    }
+
+    RunPass(delta_time, commands);
+
+    Profiler& profiler = Profiler::GetInstance();
+    profiler.EndFrame();
+    profiles_.GetWriteBuffer() = profiler;
+    profiles_.Publish();
+  }
+}
+
+void SimulationThread::RunPass(double delta_time,
+                               std::vector<Command>& commands) {
+  // Commands run outside the pass's scope, since they may reset the
+  // profiler.
+  for (Command& command : commands)
+    command();
+  commands.clear();
+  ScopedTimer timer("Simulation pass");
+  int tick_count = clock_.Advance(delta_time);
+  double tick_seconds = clock_.GetTickSeconds();
+  float alpha = clock_.GetAlpha();
+  for (Task& task : tasks_)
+    task(tick_count, tick_seconds, alpha);
+}
+}  // namespace GLOO
@@ -0,0 +1,79 @@
+#ifndef SIMULATION_THREAD_H_
+#define SIMULATION_THREAD_H_
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "gloo/debug/Profiler.hpp"
+#include "SimulationClock.hpp"
+#include "TripleBuffer.hpp"
+
+namespace GLOO {
+// Steps the simulations on a thread of their own so that physics overlaps
+// with rendering. Each frame the render thread posts the frame's duration;
+// the simulation thread then runs the posted commands, turns the time
+// posted since its last pass into fixed ticks of a SimulationClock shared by
+// all tasks, and has every task take those ticks. Tasks publish their last
+// two ticks' states through TripleBuffers, so the render thread never waits
+// on a step and draws them interpolated. The render thread only holds the
+// hand-off mutex while posting.
+class SimulationThread {
+ public:
+  // Advances one simulation by tick_count ticks of tick_seconds each, which
+  // may be none, and publishes its state with alpha, the clock's blend
+  // factor from the state before the last tick to the current one.
+  using Task =
+      std::function<void(int tick_count, double tick_seconds, float alpha)>;
+  // Changes a simulation's settings or state between passes.
+  using Command = std::function<void()>;
+
+  // Ticks are tick_seconds long; zero makes each pass one tick of the time
+  // posted for it. With threaded false, PostFrame runs the commands and tasks
+  // right away on the calling thread instead.
+  explicit SimulationThread(double tick_seconds, bool threaded = true);
+  ~SimulationThread();
+
+  SimulationThread(const SimulationThread&) = delete;
+  void operator=(const SimulationThread&) = delete;
+
+  // Tasks must all be added before the first frame is posted.
+  void AddTask(Task task);
+  void PostFrame(double delta_time);
+  void PostCommand(Command command);
+
+  // The simulation thread's profiler as of its last pass. Read it from the
+  // render thread after calling UpdateProfile.
+  void UpdateProfile() {
+    profiles_.Update();
+  }
+  const Profiler& GetProfile() const {
+    return profiles_.GetReadBuffer();
+  }
+  bool IsThreaded() const {
+    return threaded_;
+  }
+
+ private:
+  void Loop();
+  void RunPass(double delta_time, std::vector<Command>& commands);
+
+  bool threaded_;
+  // Only used by the thread running the passes.
+  SimulationClock clock_;
+  std::vector<Task> tasks_;
+  std::thread thread_;
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  double pending_time_;
+  std::vector<Command> pending_commands_;
+  bool stopping_;
+
+  TripleBuffer<Profiler> profiles_;
+};
+}  // namespace GLOO
+
+#endif
@@ -0,0 +1,158 @@
+#ifndef SOA_PARTICLE_STATE_H_
+#define SOA_PARTICLE_STATE_H_
+
+#include <vector>
+#include <stdexcept>
+
+#include <glm/glm.hpp>
+
+#include "AlignedAllocator.hpp"
+#include "ParticleState.hpp"
+#include "SimdKernels.hpp"
+
+namespace GLOO {
+// Structure-of-arrays counterpart of ParticleState. Each coordinate lives in
+// its own aligned float array padded to kSimdWidth, so that the state
+// arithmetic used by the integrators runs through full SIMD lanes. Padding
+// entries are kept at zero.
+struct SoaParticleState : public StateExpr<SoaParticleState> {
+  using FloatArray = std::vector<float, AlignedAllocator<float, kSimdAlignment>>;
+
+  // positions[axis][i] is the axis-th coordinate of particle i.
+  FloatArray positions[3];
+  FloatArray velocities[3];
+
+  SoaParticleState() {
+  }
+
+  template <class E, class = EnableIfStateOf<E, SoaParticleState>>
+  SoaParticleState(const StateExpr<E>& expr) {
+    EvaluateInto(*this, expr);
+  }
+  template <class E>
+  SoaParticleState& operator=(const StateExpr<E>& expr) {
+    EvaluateInto(*this, expr);
+    return *this;
+  }
+  template <class E>
+  SoaParticleState& operator+=(const StateExpr<E>& expr) {
+    EvaluateInto(*this, *this + expr);
+    return *this;
+  }
+
+  size_t Size() const {
+    return size_;
+  }
+
+  size_t PaddedSize() const {
+    return positions[0].size();
+  }
+
+  // Entries that already existed keep their values and new ones start at
+  // zero. Storage is reused when the padded size does not change.
+  void Resize(size_t size) {
+    size_t padded = PadToSimdWidth(size);
+    for (int axis = 0; axis < 3; axis++) {
+      positions[axis].resize(padded, 0.0f);
+      velocities[axis].resize(padded, 0.0f);
+      for (size_t i = size; i < padded; i++) {
+        positions[axis][i] = 0.0f;
+        velocities[axis][i] = 0.0f;
+      }
+    }
+    size_ = size;
+  }
+
+  // Expression interface: one block per coordinate array, padding included.
+  using StateType = SoaParticleState;
+  using Evaluator = LeafEvaluator;
+  static const int kBlockCount = 6;
+  size_t BlockSize() const {
+    return PaddedSize();
+  }
+  float* BlockData(int block) {
+    return block < 3 ? positions[block].data() : velocities[block - 3].data();
+  }
+  const float* BlockData(int block) const {
+    return block < 3 ? positions[block].data() : velocities[block - 3].data();
+  }
+  Evaluator Bind(int block) const {
+    return Evaluator{BlockData(block)};
+  }
+
+  glm::vec3 GetPosition(size_t i) const {
+    return glm::vec3(positions[0][i], positions[1][i], positions[2][i]);
+  }
+  glm::vec3 GetVelocity(size_t i) const {
+    return glm::vec3(velocities[0][i], velocities[1][i], velocities[2][i]);
+  }
+  void SetPosition(size_t i, const glm::vec3& p) {
+    positions[0][i] = p.x;
+    positions[1][i] = p.y;
+    positions[2][i] = p.z;
+  }
+  void SetVelocity(size_t i, const glm::vec3& v) {
+    velocities[0][i] = v.x;
+    velocities[1][i] = v.y;
+    velocities[2][i] = v.z;
+  }
+
+  static SoaParticleState FromAos(const ParticleState& state) {
+    SoaParticleState result;
+    result.Resize(state.positions.size());
+    for (size_t i = 0; i < state.positions.size(); i++) {
+      result.SetPosition(i, state.positions[i]);
+      result.SetVelocity(i, state.velocities[i]);
+    }
+    return result;
+  }
+
+  ParticleState ToAos() const {
+    ParticleState result;
+    result.positions.resize(size_);
+    result.velocities.resize(size_);
+    for (size_t i = 0; i < size_; i++) {
+      result.positions[i] = GetPosition(i);
+      result.velocities[i] = GetVelocity(i);
+    }
+    return result;
+  }
+
+  SoaParticleState& operator+=(const SoaParticleState& rhs) {
+    return Axpy(1.0f, rhs);
+  }
+
+  // state += a * rhs maps straight onto the SIMD kernel.
+  SoaParticleState& operator+=(const StateScaled<SoaParticleState>& rhs) {
+    return Axpy(rhs.k, rhs.expr);
+  }
+
+  // this += a * rhs, one SIMD pass per coordinate array.
+  SoaParticleState& Axpy(float a, const SoaParticleState& rhs) {
+    if (size_ != rhs.size_) {
+      throw std::runtime_error(
+          "Cannot add particle states with inconsistent sizes!");
+    }
+    size_t n = PaddedSize();
+    for (int axis = 0; axis < 3; axis++) {
+      SimdAxpy(a, rhs.positions[axis].data(), positions[axis].data(), n);
+      SimdAxpy(a, rhs.velocities[axis].data(), velocities[axis].data(), n);
+    }
+    return *this;
+  }
+
+  SoaParticleState& operator*=(float k) {
+    size_t n = PaddedSize();
+    for (int axis = 0; axis < 3; axis++) {
+      SimdScale(k, positions[axis].data(), n);
+      SimdScale(k, velocities[axis].data(), n);
+    }
+    return *this;
+  }
+
+ private:
+  size_t size_ = 0;
+};
+}  // namespace GLOO
+
+#endif
@@ -0,0 +1,90 @@
+#include "SpatialHash.hpp"
+
+#include <algorithm>
+
+namespace GLOO {
+namespace {
+const int kMaxCellsPerAxis = 16;
+}  // namespace
+
+SpatialHash::SpatialHash() : inverse_cell_size_(1.0f), bucket_mask_(0) {
+  bucket_starts_.assign(2, 0);
+}
+
+void SpatialHash::StartBuild(float cell_size, size_t expected_entries) {
+  inverse_cell_size_ = 1.0f / cell_size;
+  // Twice as many buckets as entries keeps collisions rare.
+  uint32_t bucket_count = 1;
+  while (bucket_count < 2 * expected_entries)
+    bucket_count *= 2;
+  bucket_mask_ = bucket_count - 1;
+  entry_buckets_.clear();
+  entry_items_.clear();
+}
+
+void SpatialHash::BuildPoints(const std::vector<glm::vec3>& points,
+                              float cell_size) {
+  StartBuild(cell_size, points.size());
+  entry_buckets_.resize(points.size());
+  entry_items_.resize(points.size());
+  for (size_t i = 0; i < points.size(); i++) {
+    entry_buckets_[i] = BucketOf(CellOf(points[i]));
+    entry_items_[i] = int(i);
+  }
+  FinishBuild();
+}
+
+void SpatialHash::BuildTriangles(const std::vector<glm::vec3>& points,
+                                 const std::vector<glm::ivec3>& triangles,
+                                 float cell_size,
+                                 float margin) {
+  // Cloth triangles are about a cell across, so each lands in a handful.
+  StartBuild(cell_size, 8 * triangles.size());
+  std::vector<uint32_t>& buckets = triangle_buckets_;
+  for (size_t t = 0; t < triangles.size(); t++) {
+    const glm::ivec3& triangle = triangles[t];
+    const glm::vec3& a = points[triangle.x];
+    const glm::vec3& b = points[triangle.y];
+    const glm::vec3& c = points[triangle.z];
+    glm::vec3 box_min = glm::min(glm::min(a, b), c) - glm::vec3(margin);
+    glm::vec3 box_max = glm::max(glm::max(a, b), c) + glm::vec3(margin);
+    glm::ivec3 first = CellOf(box_min);
+    // A triangle stretched over more cells than this is an unstable cloth;
+    // it is only listed in the first ones rather than stalling the build.
+    glm::ivec3 last = glm::min(CellOf(box_max),
+                               first + glm::ivec3(kMaxCellsPerAxis - 1));
+    buckets.clear();
+    for (int x = first.x; x <= last.x; x++) {
+      for (int y = first.y; y <= last.y; y++) {
+        for (int z = first.z; z <= last.z; z++) {
+          buckets.push_back(BucketOf(glm::ivec3(x, y, z)));
+        }
+      }
+    }
+    // Cells sharing a bucket would otherwise list the triangle twice.
+    std::sort(buckets.begin(), buckets.end());
+    buckets.erase(std::unique(buckets.begin(), buckets.end()), buckets.end());
+    for (uint32_t bucket : buckets) {
+      entry_buckets_.push_back(bucket);
+      entry_items_.push_back(int(t));
+    }
+  }
+  FinishBuild();
+}
+
+void SpatialHash::FinishBuild() {
+  // Count entries per bucket, then prefix sum into bucket starts
+  size_t bucket_count = size_t(bucket_mask_) + 1;
+  bucket_starts_.assign(bucket_count + 1, 0);
+  for (uint32_t bucket : entry_buckets_)
+    bucket_starts_[bucket + 1]++;
+  for (size_t b = 0; b < bucket_count; b++)
+    bucket_starts_[b + 1] += bucket_starts_[b];
+
+  // Scatter in entry order, which keeps each bucket's items ascending
+  items_.resize(entry_items_.size());
+  scatter_cursor_.assign(bucket_starts_.begin(), bucket_starts_.end() - 1);
+  for (size_t e = 0; e < entry_items_.size(); e++)
+    items_[scatter_cursor_[entry_buckets_[e]]++] = entry_items_[e];
+}
+}  // namespace GLOO
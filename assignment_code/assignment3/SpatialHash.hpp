@@ -0,0 +1,95 @@
+#ifndef SPATIAL_HASH_H_
+#define SPATIAL_HASH_H_
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace GLOO {
+// A uniform grid of cubic cells hashed into a table of buckets, for finding
+// what lies near a point in time linear in the number of items. Items are
+// ints, e.g. particle or triangle indices. Build sorts them into their
+// buckets with a counting sort, so rebuilding every step costs a few passes
+// over the items and no allocations once the vectors have grown, and the
+// items of a bucket stay in ascending order. Distinct cells may share a
+// bucket, so queries can report items from far away; callers check the
+// actual distance.
+class SpatialHash {
+ public:
+  SpatialHash();
+
+  // Puts each point in the cell containing it; items are point indices.
+  void BuildPoints(const std::vector<glm::vec3>& points, float cell_size);
+  // Puts each triangle in every cell its bounding box, grown by margin on
+  // every side, overlaps; items are indices into triangles.
+  void BuildTriangles(const std::vector<glm::vec3>& points,
+                      const std::vector<glm::ivec3>& triangles,
+                      float cell_size,
+                      float margin);
+
+  // Calls visit(item) once for every item in the 27 cells around point's.
+  // After BuildPoints this covers every point within cell_size of point.
+  template <class Visit>
+  void ForEachNear(const glm::vec3& point, const Visit& visit) const {
+    glm::ivec3 cell = CellOf(point);
+    uint32_t visited[27];
+    int visited_count = 0;
+    for (int dx = -1; dx <= 1; dx++) {
+      for (int dy = -1; dy <= 1; dy++) {
+        for (int dz = -1; dz <= 1; dz++) {
+          uint32_t bucket = BucketOf(cell + glm::ivec3(dx, dy, dz));
+          // Neighboring cells that share a bucket are visited once.
+          bool seen = false;
+          for (int k = 0; k < visited_count && !seen; k++)
+            seen = visited[k] == bucket;
+          if (seen)
+            continue;
+          visited[visited_count++] = bucket;
+          for (int e = bucket_starts_[bucket]; e < bucket_starts_[bucket + 1];
+               e++) {
+            visit(items_[e]);
+          }
+        }
+      }
+    }
+  }
+
+  // Calls visit(item) once for every item in point's cell. After
+  // BuildTriangles this covers every triangle within margin of point.
+  template <class Visit>
+  void ForEachInCell(const glm::vec3& point, const Visit& visit) const {
+    uint32_t bucket = BucketOf(CellOf(point));
+    for (int e = bucket_starts_[bucket]; e < bucket_starts_[bucket + 1]; e++)
+      visit(items_[e]);
+  }
+
+ private:
+  glm::ivec3 CellOf(const glm::vec3& point) const {
+    return glm::ivec3(glm::floor(point * inverse_cell_size_));
+  }
+  uint32_t BucketOf(const glm::ivec3& cell) const {
+    uint32_t hash = (uint32_t(cell.x) * 73856093u) ^
+                    (uint32_t(cell.y) * 19349663u) ^
+                    (uint32_t(cell.z) * 83492791u);
+    return hash & bucket_mask_;
+  }
+  // Sizes the table for the entries gathered so far.
+  void StartBuild(float cell_size, size_t expected_entries);
+  // Counting sort of the gathered (bucket, item) entries into items_.
+  void FinishBuild();
+
+  float inverse_cell_size_;
+  uint32_t bucket_mask_;
+  std::vector<uint32_t> entry_buckets_;
+  std::vector<int> entry_items_;
+  // Bucket b holds items_[bucket_starts_[b]] up to bucket_starts_[b + 1].
+  std::vector<int> bucket_starts_;
+  std::vector<int> items_;
+  // Scratch space kept between builds.
+  std::vector<int> scatter_cursor_;
+  std::vector<uint32_t> triangle_buckets_;
+};
+}  // namespace GLOO
+
+#endif
@@ -0,0 +1,144 @@
+#ifndef STATE_EXPRESSION_H_
+#define STATE_EXPRESSION_H_
+
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+
+namespace GLOO {
+// Lazy linear combinations of particle states. Writing
+//
+//   stage = state + dt / 2 * k1;
+//
+// builds a small expression tree instead of temporaries; assigning it to a
+// state evaluates the whole combination in one pass over memory.
+//
+// A state type takes part by deriving from StateExpr<itself> and providing:
+//   using StateType = <itself>;
+//   using Evaluator = LeafEvaluator;
+//   static const int kBlockCount;       number of contiguous float blocks
+//   size_t Size() const;                number of particles
+//   size_t BlockSize() const;           floats per block
+//   const float* BlockData(int) const;  and a non-const overload
+//   void Resize(size_t);
+// Every block of a state has the same length, and element i of a block only
+// ever combines with element i of the same block in other states. The first
+// kBlockCount / 2 blocks hold positions and the rest the matching velocities,
+// which the symplectic integrators rely on to update the two separately.
+template <class E>
+struct StateExpr {
+  const E& Self() const {
+    return static_cast<const E&>(*this);
+  }
+};
+
+// Restricts converting constructors to expressions over the same layout, so
+// overloads taking different state types stay unambiguous.
+template <class E, class TState>
+using EnableIfStateOf = typename std::enable_if<
+    std::is_same<typename E::StateType, TState>::value>::type;
+
+struct LeafEvaluator {
+  const float* data;
+  float operator[](size_t i) const {
+    return data[i];
+  }
+};
+
+// States are captured by reference, sub-expressions by value. Expressions
+// must therefore be consumed within the full-expression that creates them.
+template <class E>
+struct ExprOperand {
+  using type = typename std::conditional<
+      std::is_same<E, typename E::StateType>::value, const E&, const E>::type;
+};
+
+template <class L, class R>
+struct StateSum : public StateExpr<StateSum<L, R>> {
+  using StateType = typename L::StateType;
+  static_assert(std::is_same<StateType, typename R::StateType>::value,
+                "Cannot combine particle states with different layouts!");
+
+  struct Evaluator {
+    typename L::Evaluator lhs;
+    typename R::Evaluator rhs;
+    float operator[](size_t i) const {
+      return lhs[i] + rhs[i];
+    }
+  };
+
+  StateSum(const L& l, const R& r) : lhs(l), rhs(r) {
+  }
+  size_t Size() const {
+    if (lhs.Size() != rhs.Size()) {
+      throw std::runtime_error(
+          "Cannot add particle states with inconsistent sizes!");
+    }
+    return lhs.Size();
+  }
+  Evaluator Bind(int block) const {
+    return Evaluator{lhs.Bind(block), rhs.Bind(block)};
+  }
+
+  typename ExprOperand<L>::type lhs;
+  typename ExprOperand<R>::type rhs;
+};
+
+template <class E>
+struct StateScaled : public StateExpr<StateScaled<E>> {
+  using StateType = typename E::StateType;
+
+  struct Evaluator {
+    float k;
+    typename E::Evaluator expr;
+    float operator[](size_t i) const {
+      return k * expr[i];
+    }
+  };
+
+  StateScaled(float scale, const E& e) : k(scale), expr(e) {
+  }
+  size_t Size() const {
+    return expr.Size();
+  }
+  Evaluator Bind(int block) const {
+    return Evaluator{k, expr.Bind(block)};
+  }
+
+  float k;
+  typename ExprOperand<E>::type expr;
+};
+
+template <class L, class R>
+StateSum<L, R> operator+(const StateExpr<L>& lhs, const StateExpr<R>& rhs) {
+  return StateSum<L, R>(lhs.Self(), rhs.Self());
+}
+template <class E>
+StateScaled<E> operator*(float k, const StateExpr<E>& expr) {
+  return StateScaled<E>(k, expr.Self());
+}
+template <class E>
+StateScaled<E> operator*(const StateExpr<E>& expr, float k) {
+  return StateScaled<E>(k, expr.Self());
+}
+
+// Evaluates expr into dst in a single fused loop per block. dst may appear in
+// expr, since every element only reads the same index of its operands.
+template <class TState, class E>
+void EvaluateInto(TState& dst, const StateExpr<E>& expr) {
+  static_assert(std::is_same<TState, typename E::StateType>::value,
+                "Cannot assign an expression to a different state layout!");
+  const E& e = expr.Self();
+  dst.Resize(e.Size());
+  size_t n = dst.BlockSize();
+  for (int block = 0; block < TState::kBlockCount; block++) {
+    typename E::Evaluator eval = e.Bind(block);
+    float* out = dst.BlockData(block);
+    for (size_t i = 0; i < n; i++) {
+      out[i] = eval[i];
+    }
+  }
+}
+}  // namespace GLOO
+
+#endif
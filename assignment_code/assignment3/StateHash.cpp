@@ -0,0 +1,98 @@
+#include "StateHash.hpp"
+
+#include <cstring>
+
+namespace GLOO {
+namespace {
+const uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+const uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+const uint64_t kPrime3 = 0x165667B19E3779F9ULL;
+const uint64_t kPrime4 = 0x85EBCA77C2B2AE63ULL;
+const uint64_t kPrime5 = 0x27D4EB2F165667C5ULL;
+
+uint64_t RotateLeft(uint64_t value, int bits) {
+  return (value << bits) | (value >> (64 - bits));
+}
+
+// Unaligned little-endian reads; memcpy compiles to a single load.
+uint64_t Read64(const unsigned char* p) {
+  uint64_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+uint32_t Read32(const unsigned char* p) {
+  uint32_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+uint64_t Round(uint64_t accumulator, uint64_t input) {
+  accumulator += input * kPrime2;
+  accumulator = RotateLeft(accumulator, 31);
+  return accumulator * kPrime1;
+}
+
+uint64_t MergeRound(uint64_t hash, uint64_t lane) {
+  hash ^= Round(0, lane);
+  return hash * kPrime1 + kPrime4;
+}
+}  // namespace
+
+uint64_t HashBytes(const void* data, size_t size, uint64_t seed) {
+  const unsigned char* p = static_cast<const unsigned char*>(data);
+  const unsigned char* end = p + size;
+  uint64_t hash;
+  if (size >= 32) {
+    // Four independent lanes keep the multipliers busy.
+    uint64_t lane1 = seed + kPrime1 + kPrime2;
+    uint64_t lane2 = seed + kPrime2;
+    uint64_t lane3 = seed;
+    uint64_t lane4 = seed - kPrime1;
+    const unsigned char* limit = end - 32;
+    do {
+      lane1 = Round(lane1, Read64(p));
+      lane2 = Round(lane2, Read64(p + 8));
+      lane3 = Round(lane3, Read64(p + 16));
+      lane4 = Round(lane4, Read64(p + 24));
+      p += 32;
+    } while (p <= limit);
+    hash = RotateLeft(lane1, 1) + RotateLeft(lane2, 7) +
+           RotateLeft(lane3, 12) + RotateLeft(lane4, 18);
+    hash = MergeRound(hash, lane1);
+    hash = MergeRound(hash, lane2);
+    hash = MergeRound(hash, lane3);
+    hash = MergeRound(hash, lane4);
+  } else {
+    hash = seed + kPrime5;
+  }
+  hash += uint64_t(size);
+
+  for (; p + 8 <= end; p += 8) {
+    hash ^= Round(0, Read64(p));
+    hash = RotateLeft(hash, 27) * kPrime1 + kPrime4;
+  }
+  if (p + 4 <= end) {
+    hash ^= uint64_t(Read32(p)) * kPrime1;
+    hash = RotateLeft(hash, 23) * kPrime2 + kPrime3;
+    p += 4;
+  }
+  for (; p < end; p++) {
+    hash ^= uint64_t(*p) * kPrime5;
+    hash = RotateLeft(hash, 11) * kPrime1;
+  }
+
+  hash ^= hash >> 33;
+  hash *= kPrime2;
+  hash ^= hash >> 29;
+  hash *= kPrime3;
+  hash ^= hash >> 32;
+  return hash;
+}
+
+uint64_t HashParticleState(const ParticleState& state) {
+  uint64_t hash = HashBytes(state.positions.data(),
+                            state.positions.size() * sizeof(glm::vec3));
+  return HashBytes(state.velocities.data(),
+                   state.velocities.size() * sizeof(glm::vec3), hash);
+}
+}  // namespace GLOO
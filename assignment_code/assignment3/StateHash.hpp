@@ -0,0 +1,20 @@
+#ifndef STATE_HASH_H_
+#define STATE_HASH_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "ParticleState.hpp"
+
+namespace GLOO {
+// XXH64 of size bytes, for telling apart states that differ in any bit. Runs
+// at several bytes per cycle, so hashing even a large cloth every step costs
+// little next to the step itself.
+uint64_t HashBytes(const void* data, size_t size, uint64_t seed = 0);
+
+// Hash of the exact bits of all positions and then all velocities. Equal
+// states hash equally on machines of the same byte order; -0 and +0 differ.
+uint64_t HashParticleState(const ParticleState& state);
+}  // namespace GLOO
+
+#endif
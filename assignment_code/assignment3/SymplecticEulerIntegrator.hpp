@@ -0,0 +1,51 @@
+#ifndef SYMPLECTIC_EULER_INTEGRATOR_H_
+#define SYMPLECTIC_EULER_INTEGRATOR_H_
+
+#include "IntegratorBase.hpp"
+
+namespace GLOO {
+// Semi-implicit Euler: velocities are advanced with the current forces and
+// positions with the new velocities,
+//
+//   v' = v + dt a(x, v),    x' = x + dt v'.
+//
+// With the derivative d = (dx, dv) of the system this is x' = x + dt dx +
+// dt^2 dv, so it also holds for particles the system pins by reporting a zero
+// derivative. One force evaluation per step, updated in place.
+template <class TSystem, class TState>
+class SymplecticEulerIntegrator : public IntegratorBase<TSystem, TState> {
+  TState Integrate(const TSystem& system,
+                   const TState& state,
+                   float start_time,
+                   float dt) const override {
+      TState end_state = state;
+      SymplecticEulerIntegrator stepper;
+      stepper.Step(system, end_state, start_time, dt);
+      return end_state;
+  }
+
+  void Step(const TSystem& system,
+            TState& state,
+            float start_time,
+            float dt) override {
+      system.ComputeTimeDerivative(state, start_time, derivative_);
+      const int half = TState::kBlockCount / 2;
+      size_t n = state.BlockSize();
+      for (int block = 0; block < half; block++) {
+          float* x = state.BlockData(block);
+          float* v = state.BlockData(block + half);
+          const float* dx = derivative_.BlockData(block);
+          const float* dv = derivative_.BlockData(block + half);
+          for (size_t i = 0; i < n; i++) {
+              x[i] += dt * (dx[i] + dt * dv[i]);
+              v[i] += dt * dv[i];
+          }
+      }
+  }
+
+  // Reused by Step so that steady-state steps do not allocate.
+  TState derivative_;
+};
+}  // namespace GLOO
+
+#endif
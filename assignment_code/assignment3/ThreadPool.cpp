@@ -0,0 +1,91 @@
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+
+#include "gloo/debug/Tracer.hpp"
+
+namespace GLOO {
+ThreadPool::ThreadPool(int num_threads)
+    : function_(nullptr),
+      task_(nullptr),
+      begin_(0),
+      end_(0),
+      chunk_size_(0),
+      generation_(0),
+      pending_(0),
+      stopping_(false) {
+  for (int i = 0; i < num_threads - 1; i++) {
+    workers_.emplace_back(&ThreadPool::WorkerLoop, this, i);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  work_ready_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+void ThreadPool::Run(int begin,
+                     int end,
+                     ChunkFunction function,
+                     const void* task) {
+  if (workers_.empty() || end - begin < 2) {
+    function(task, begin, end);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    function_ = function;
+    task_ = task;
+    begin_ = begin;
+    end_ = end;
+    chunk_size_ = (end - begin + GetThreadCount() - 1) / GetThreadCount();
+    pending_ = int(workers_.size());
+    generation_++;
+  }
+  work_ready_.notify_all();
+
+  RunChunk(0);
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  work_done_.wait(lock, [this] { return pending_ == 0; });
+  function_ = nullptr;
+  task_ = nullptr;
+}
+
+void ThreadPool::WorkerLoop(int worker_index) {
+  Tracer::SetThreadName("ThreadPool worker");
+  unsigned int seen_generation = 0;
+  while (true) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    work_ready_.wait(lock, [this, seen_generation] {
+      return stopping_ || generation_ != seen_generation;
+    });
+    if (stopping_)
+      return;
+    seen_generation = generation_;
+    lock.unlock();
+
+    RunChunk(worker_index + 1);
+
+    lock.lock();
+    if (--pending_ == 0)
+      work_done_.notify_one();
+  }
+}
+
+void ThreadPool::RunChunk(int chunk_index) {
+  int chunk_begin = begin_ + chunk_index * chunk_size_;
+  int chunk_end = std::min(chunk_begin + chunk_size_, end_);
+  if (chunk_begin < chunk_end) {
+    TraceScope trace("ParallelFor chunk");
+    function_(task_, chunk_begin, chunk_end);
+  }
+}
+}  // namespace GLOO
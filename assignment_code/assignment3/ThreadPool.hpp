@@ -0,0 +1,64 @@
+#ifndef THREAD_POOL_H_
+#define THREAD_POOL_H_
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace GLOO {
+// Persistent pool of worker threads for data-parallel loops. Workers sleep
+// between calls, so a ParallelFor costs one wake-up instead of thread
+// creation.
+class ThreadPool {
+ public:
+  // Spawns num_threads - 1 workers; the calling thread takes part in every
+  // ParallelFor as well.
+  explicit ThreadPool(int num_threads);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  void operator=(const ThreadPool&) = delete;
+
+  int GetThreadCount() const {
+    return int(workers_.size()) + 1;
+  }
+
+  // Splits [begin, end) into one contiguous chunk per thread, calls
+  // task(chunk_begin, chunk_end) for each and blocks until all are done.
+  // Chunk boundaries depend only on the range and the thread count. The task
+  // is passed through a plain function pointer, so dispatch never allocates.
+  template <class Task>
+  void ParallelFor(int begin, int end, const Task& task) {
+    Run(begin, end, &InvokeTask<Task>, &task);
+  }
+
+ private:
+  using ChunkFunction = void (*)(const void* task, int begin, int end);
+
+  template <class Task>
+  static void InvokeTask(const void* task, int begin, int end) {
+    (*static_cast<const Task*>(task))(begin, end);
+  }
+
+  void Run(int begin, int end, ChunkFunction function, const void* task);
+  void WorkerLoop(int worker_index);
+  void RunChunk(int chunk_index);
+
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable work_ready_;
+  std::condition_variable work_done_;
+
+  ChunkFunction function_;
+  const void* task_;
+  int begin_;
+  int end_;
+  int chunk_size_;
+  unsigned int generation_;
+  int pending_;
+  bool stopping_;
+};
+}  // namespace GLOO
+
+#endif
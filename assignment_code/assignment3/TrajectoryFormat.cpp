@@ -0,0 +1,86 @@
+#include "TrajectoryFormat.hpp"
+
+#include <algorithm>
+
+namespace GLOO {
+namespace {
+const float kQuantizationMax = float((1 << kTrajectoryQuantizationBits) - 1);
+
+// Folds signed differences into unsigned ones with small magnitudes kept
+// small: 0, -1, 1, -2, ... become 0, 1, 2, 3, ...
+uint32_t ZigZag(int32_t value) {
+  return (uint32_t(value) << 1) ^ uint32_t(value >> 31);
+}
+int32_t UnZigZag(uint32_t value) {
+  return int32_t(value >> 1) ^ -int32_t(value & 1);
+}
+}  // namespace
+
+void QuantizePositions(const std::vector<glm::vec3>& positions,
+                       const glm::vec3& box_min,
+                       const glm::vec3& box_max,
+                       std::vector<uint16_t>& out) {
+  glm::vec3 scale = kQuantizationMax / (box_max - box_min);
+  out.resize(3 * positions.size());
+  for (size_t i = 0; i < positions.size(); i++) {
+    glm::vec3 q = (positions[i] - box_min) * scale;
+    for (int axis = 0; axis < 3; axis++) {
+      float value = std::min(std::max(q[axis], 0.0f), kQuantizationMax);
+      out[3 * i + axis] = uint16_t(value + .5f);
+    }
+  }
+}
+
+void DequantizePositions(const std::vector<uint16_t>& quantized,
+                         const glm::vec3& box_min,
+                         const glm::vec3& box_max,
+                         std::vector<glm::vec3>& out) {
+  glm::vec3 scale = (box_max - box_min) / kQuantizationMax;
+  out.resize(quantized.size() / 3);
+  for (size_t i = 0; i < out.size(); i++) {
+    glm::vec3 q(float(quantized[3 * i]), float(quantized[3 * i + 1]),
+                float(quantized[3 * i + 2]));
+    out[i] = box_min + q * scale;
+  }
+}
+
+void EncodeTrajectoryFrame(const std::vector<uint16_t>& previous,
+                           const std::vector<uint16_t>& current,
+                           bool keyframe,
+                           std::vector<uint8_t>& out) {
+  for (size_t i = 0; i < current.size(); i++) {
+    int32_t base = keyframe ? 0 : int32_t(previous[i]);
+    uint32_t value = ZigZag(int32_t(current[i]) - base);
+    // Seven bits per byte, low bits first; the high bit marks continuation.
+    while (value >= 0x80) {
+      out.push_back(uint8_t(value | 0x80));
+      value >>= 7;
+    }
+    out.push_back(uint8_t(value));
+  }
+}
+
+bool DecodeTrajectoryFrame(const uint8_t* payload,
+                           size_t payload_size,
+                           bool keyframe,
+                           std::vector<uint16_t>& previous) {
+  const uint8_t* end = payload + payload_size;
+  for (size_t i = 0; i < previous.size(); i++) {
+    uint32_t value = 0;
+    int shift = 0;
+    while (true) {
+      // A 16-bit difference zigzags to at most 17 bits, three bytes.
+      if (payload == end || shift > 14)
+        return false;
+      uint8_t byte = *payload++;
+      value |= uint32_t(byte & 0x7f) << shift;
+      shift += 7;
+      if ((byte & 0x80) == 0)
+        break;
+    }
+    int32_t base = keyframe ? 0 : int32_t(previous[i]);
+    previous[i] = uint16_t(base + UnZigZag(value));
+  }
+  return payload == end;
+}
+}  // namespace GLOO
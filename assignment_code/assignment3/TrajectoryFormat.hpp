@@ -0,0 +1,90 @@
+#ifndef TRAJECTORY_FORMAT_H_
+#define TRAJECTORY_FORMAT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace GLOO {
+// Version 1 of the trajectory format, written by TrajectoryRecorder:
+//
+//   TrajectoryHeader
+//   per frame: TrajectoryFrameHeader, then payload_size bytes of payload
+//   once closed: TrajectoryIndexEntry per keyframe, then TrajectoryTrailer
+//
+// Positions are quantized to 16 bits per axis within the header's box.
+// A payload holds, for each particle and axis in order, the difference to
+// the previous frame's quantized value as a zigzag varint, so a particle
+// that barely moved costs three bytes. Keyframes are coded against zero
+// and start every keyframe_interval frames, so readers can begin decoding
+// there. A file without a trailer, from a run that did not close it, is
+// still readable front to back. Values are in the writer's byte order.
+const uint32_t kTrajectoryVersion = 1;
+const int kTrajectoryQuantizationBits = 16;
+
+struct TrajectoryHeader {
+  // "GLOOTRAJ", unterminated.
+  char magic[8];
+  uint32_t version;
+  uint32_t particle_count;
+  uint32_t keyframe_interval;
+  uint32_t quantization_bits;
+  float box_min[3];
+  float box_max[3];
+};
+static_assert(sizeof(TrajectoryHeader) == 48,
+              "TrajectoryHeader must not gain padding.");
+
+struct TrajectoryFrameHeader {
+  double time;
+  uint32_t payload_size;
+  // 1 if the payload is coded against zero instead of the previous frame.
+  uint32_t keyframe;
+};
+static_assert(sizeof(TrajectoryFrameHeader) == 16,
+              "TrajectoryFrameHeader must not gain padding.");
+
+struct TrajectoryIndexEntry {
+  uint64_t frame;
+  // File offset of the keyframe's TrajectoryFrameHeader.
+  uint64_t offset;
+};
+
+struct TrajectoryTrailer {
+  uint64_t index_offset;
+  uint64_t index_count;
+  uint64_t frame_count;
+  // "GLOOTEND", unterminated.
+  char magic[8];
+};
+static_assert(sizeof(TrajectoryTrailer) == 32,
+              "TrajectoryTrailer must not gain padding.");
+
+// Maps positions to and from the header's box, three values per particle.
+// Positions outside the box are clamped to it.
+void QuantizePositions(const std::vector<glm::vec3>& positions,
+                       const glm::vec3& box_min,
+                       const glm::vec3& box_max,
+                       std::vector<uint16_t>& out);
+void DequantizePositions(const std::vector<uint16_t>& quantized,
+                         const glm::vec3& box_min,
+                         const glm::vec3& box_max,
+                         std::vector<glm::vec3>& out);
+
+// Appends the payload of current coded against previous, which is ignored
+// for keyframes.
+void EncodeTrajectoryFrame(const std::vector<uint16_t>& previous,
+                           const std::vector<uint16_t>& current,
+                           bool keyframe,
+                           std::vector<uint8_t>& out);
+// Decodes a payload in place over previous, which must hold the previous
+// frame, or anything for keyframes. Returns false for malformed payloads.
+bool DecodeTrajectoryFrame(const uint8_t* payload,
+                           size_t payload_size,
+                           bool keyframe,
+                           std::vector<uint16_t>& previous);
+}  // namespace GLOO
+
+#endif
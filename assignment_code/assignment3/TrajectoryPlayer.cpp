@@ -0,0 +1,98 @@
+#include "TrajectoryPlayer.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+
+#include "gloo/debug/Tracer.hpp"
+
+namespace GLOO {
+namespace {
+const uint64_t kNoFrame = std::numeric_limits<uint64_t>::max();
+}  // namespace
+
+TrajectoryPlayer::TrajectoryPlayer(const std::string& file_path,
+                                   int prefetch_frames)
+    : reader_(file_path),
+      slots_(prefetch_frames),
+      requested_frame_(0),
+      stopping_(false),
+      failed_(false) {
+  if (prefetch_frames < 1) {
+    throw std::runtime_error("Trajectory prefetch must be positive!");
+  }
+  for (Frame& slot : slots_)
+    slot.frame = kNoFrame;
+  // Start on the first frames right away.
+  decoder_ = std::thread(&TrajectoryPlayer::DecoderLoop, this);
+}
+
+TrajectoryPlayer::~TrajectoryPlayer() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  frame_requested_.notify_one();
+  decoder_.join();
+}
+
+bool TrajectoryPlayer::GetFrame(uint64_t frame,
+                                std::vector<glm::vec3>& positions) {
+  bool ready;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    requested_frame_ = frame;
+    const Frame& slot = slots_[frame % slots_.size()];
+    ready = slot.frame == frame;
+    if (ready)
+      positions = slot.positions;
+  }
+  frame_requested_.notify_one();
+  return ready;
+}
+
+bool TrajectoryPlayer::FindMissingFrame(uint64_t& frame) const {
+  uint64_t end = std::min<uint64_t>(requested_frame_ + slots_.size(),
+                                    reader_.GetFrameCount());
+  for (uint64_t f = requested_frame_; f < end; f++) {
+    if (slots_[f % slots_.size()].frame != f) {
+      frame = f;
+      return true;
+    }
+  }
+  return false;
+}
+
+void TrajectoryPlayer::DecoderLoop() {
+  Tracer::SetThreadName("Trajectory decoder");
+  while (true) {
+    uint64_t frame;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      frame_requested_.wait(lock, [this, &frame] {
+        return stopping_ || (!failed_ && FindMissingFrame(frame));
+      });
+      if (stopping_)
+        return;
+    }
+
+    // Decoded outside the lock; a seek meanwhile only changes which frame
+    // is missing next.
+    try {
+      TraceScope trace("Decode trajectory frame");
+      reader_.ReadFrame(frame, decoded_positions_);
+    } catch (const std::runtime_error& error) {
+      std::cerr << error.what() << std::endl;
+      std::lock_guard<std::mutex> lock(mutex_);
+      failed_ = true;
+      continue;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    Frame& slot = slots_[frame % slots_.size()];
+    slot.frame = frame;
+    slot.positions.swap(decoded_positions_);
+  }
+}
+}  // namespace GLOO
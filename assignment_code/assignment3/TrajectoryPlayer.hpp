@@ -0,0 +1,78 @@
+#ifndef TRAJECTORY_PLAYER_H_
+#define TRAJECTORY_PLAYER_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "TrajectoryReader.hpp"
+
+namespace GLOO {
+// Plays a trajectory file back for display. A decoder thread of the
+// player's own keeps the frames from the last one asked for up to
+// prefetch_frames ahead decoded, so playing forward finds each frame ready
+// and a seek only waits for the decode from the keyframe before it.
+class TrajectoryPlayer {
+ public:
+  // Throws std::runtime_error if the file cannot be read, see
+  // TrajectoryReader.
+  explicit TrajectoryPlayer(const std::string& file_path,
+                            int prefetch_frames = 32);
+  ~TrajectoryPlayer();
+
+  TrajectoryPlayer(const TrajectoryPlayer&) = delete;
+  void operator=(const TrajectoryPlayer&) = delete;
+
+  size_t GetParticleCount() const {
+    return reader_.GetParticleCount();
+  }
+  uint64_t GetFrameCount() const {
+    return reader_.GetFrameCount();
+  }
+  double GetStartTime() const {
+    return reader_.GetStartTime();
+  }
+  double GetEndTime() const {
+    return reader_.GetEndTime();
+  }
+  uint64_t FindFrame(double time) const {
+    return reader_.FindFrame(time);
+  }
+
+  // Makes frame the one to decode first and prefetch from. Copies it into
+  // positions and returns true if it is decoded already; otherwise returns
+  // false, and the caller keeps showing what it has until a later call
+  // finds the frame ready.
+  bool GetFrame(uint64_t frame, std::vector<glm::vec3>& positions);
+
+ private:
+  struct Frame {
+    uint64_t frame;
+    std::vector<glm::vec3> positions;
+  };
+
+  void DecoderLoop();
+  // The first frame from requested_frame_ on that its slot does not hold.
+  bool FindMissingFrame(uint64_t& frame) const;
+
+  // Only the decoder thread reads frames once it runs.
+  TrajectoryReader reader_;
+  std::vector<glm::vec3> decoded_positions_;
+
+  // Frame f is kept in slot f % slots_.size().
+  std::vector<Frame> slots_;
+  std::mutex mutex_;
+  std::condition_variable frame_requested_;
+  uint64_t requested_frame_;
+  bool stopping_;
+  bool failed_;
+  std::thread decoder_;
+};
+}  // namespace GLOO
+
+#endif
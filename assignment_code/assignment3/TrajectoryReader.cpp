@@ -0,0 +1,187 @@
+#include "TrajectoryReader.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace GLOO {
+TrajectoryReader::TrajectoryReader(const std::string& file_path)
+    : file_(file_path),
+      file_path_(file_path),
+      frame_count_(0),
+      frames_end_(0),
+      end_time_(0.0),
+      next_frame_(0),
+      next_offset_(0),
+      cursor_valid_(false) {
+  if (file_.GetSize() < sizeof(TrajectoryHeader)) {
+    throw std::runtime_error(file_path + " is too short for a trajectory!");
+  }
+  TrajectoryHeader header;
+  std::memcpy(&header, file_.GetData(), sizeof(header));
+  if (std::memcmp(header.magic, "GLOOTRAJ", sizeof(header.magic)) != 0) {
+    throw std::runtime_error(file_path + " is not a trajectory!");
+  }
+  if (header.version != kTrajectoryVersion) {
+    throw std::runtime_error(file_path + " has unsupported trajectory version " +
+                             std::to_string(header.version) + "!");
+  }
+  if (header.quantization_bits != uint32_t(kTrajectoryQuantizationBits) ||
+      header.particle_count == 0) {
+    throw std::runtime_error(file_path + " is truncated or corrupt!");
+  }
+  particle_count_ = header.particle_count;
+  for (int axis = 0; axis < 3; axis++) {
+    box_min_[axis] = header.box_min[axis];
+    box_max_[axis] = header.box_max[axis];
+  }
+
+  if (!ReadIndex())
+    ScanFrames();
+  if (frame_count_ == 0 || keyframes_.empty() || keyframes_[0].frame != 0) {
+    throw std::runtime_error(file_path + " has no frames!");
+  }
+  for (Keyframe& keyframe : keyframes_) {
+    TrajectoryFrameHeader frame_header = ReadFrameHeader(keyframe.offset);
+    if (frame_header.keyframe == 0 || keyframe.frame >= frame_count_) {
+      throw std::runtime_error(file_path + " is truncated or corrupt!");
+    }
+    keyframe.time = frame_header.time;
+  }
+
+  // Only keyframe times are kept; the last frame's is found by walking the
+  // headers after the last keyframe.
+  uint64_t offset = keyframes_.back().offset;
+  for (uint64_t frame = keyframes_.back().frame;; frame++) {
+    TrajectoryFrameHeader frame_header = ReadFrameHeader(offset);
+    end_time_ = frame_header.time;
+    if (frame == frame_count_ - 1)
+      break;
+    offset += sizeof(frame_header) + frame_header.payload_size;
+  }
+  quantized_.resize(3 * particle_count_);
+}
+
+TrajectoryFrameHeader TrajectoryReader::ReadFrameHeader(uint64_t offset) const {
+  TrajectoryFrameHeader header;
+  if (offset < sizeof(TrajectoryHeader) ||
+      offset + sizeof(header) > frames_end_) {
+    throw std::runtime_error(file_path_ + " is truncated or corrupt!");
+  }
+  std::memcpy(&header, file_.GetData() + offset, sizeof(header));
+  if (offset + sizeof(header) + header.payload_size > frames_end_) {
+    throw std::runtime_error(file_path_ + " is truncated or corrupt!");
+  }
+  return header;
+}
+
+bool TrajectoryReader::ReadIndex() {
+  size_t size = file_.GetSize();
+  if (size < sizeof(TrajectoryHeader) + sizeof(TrajectoryTrailer))
+    return false;
+  TrajectoryTrailer trailer;
+  std::memcpy(&trailer, file_.GetData() + size - sizeof(trailer),
+              sizeof(trailer));
+  if (std::memcmp(trailer.magic, "GLOOTEND", sizeof(trailer.magic)) != 0)
+    return false;
+  uint64_t index_size = trailer.index_count * sizeof(TrajectoryIndexEntry);
+  if (trailer.index_offset < sizeof(TrajectoryHeader) ||
+      trailer.index_count > size / sizeof(TrajectoryIndexEntry) ||
+      trailer.index_offset + index_size + sizeof(trailer) != size) {
+    throw std::runtime_error(file_path_ + " is truncated or corrupt!");
+  }
+
+  frames_end_ = trailer.index_offset;
+  frame_count_ = trailer.frame_count;
+  keyframes_.resize(trailer.index_count);
+  for (size_t i = 0; i < keyframes_.size(); i++) {
+    TrajectoryIndexEntry entry;
+    std::memcpy(&entry,
+                file_.GetData() + trailer.index_offset + i * sizeof(entry),
+                sizeof(entry));
+    if (i > 0 && entry.frame <= keyframes_[i - 1].frame) {
+      throw std::runtime_error(file_path_ + " is truncated or corrupt!");
+    }
+    keyframes_[i] = Keyframe{entry.frame, entry.offset, 0.0};
+  }
+  return true;
+}
+
+void TrajectoryReader::ScanFrames() {
+  frames_end_ = file_.GetSize();
+  uint64_t offset = sizeof(TrajectoryHeader);
+  while (offset + sizeof(TrajectoryFrameHeader) <= frames_end_) {
+    TrajectoryFrameHeader header;
+    std::memcpy(&header, file_.GetData() + offset, sizeof(header));
+    uint64_t next_offset = offset + sizeof(header) + header.payload_size;
+    // The run stopped while this frame was being written.
+    if (next_offset > frames_end_)
+      break;
+    if (header.keyframe != 0)
+      keyframes_.push_back(Keyframe{frame_count_, offset, 0.0});
+    frame_count_++;
+    offset = next_offset;
+  }
+  frames_end_ = offset;
+}
+
+uint64_t TrajectoryReader::FindFrame(double time) const {
+  if (time <= GetStartTime())
+    return 0;
+  if (time >= end_time_)
+    return frame_count_ - 1;
+  auto after = std::upper_bound(
+      keyframes_.begin(), keyframes_.end(), time,
+      [](double t, const Keyframe& keyframe) { return t < keyframe.time; });
+  const Keyframe& keyframe = *(after - 1);
+  uint64_t last_frame = frame_count_ - 1;
+  double last_time = end_time_;
+  if (after != keyframes_.end()) {
+    last_frame = after->frame;
+    last_time = after->time;
+  }
+  if (!(last_time > keyframe.time))
+    return keyframe.frame;
+  // Frames between keyframes are assumed evenly spaced in time.
+  double fraction = (time - keyframe.time) / (last_time - keyframe.time);
+  uint64_t frame =
+      keyframe.frame + uint64_t(fraction * double(last_frame - keyframe.frame));
+  return std::min(frame, last_frame);
+}
+
+double TrajectoryReader::ReadFrame(uint64_t frame,
+                                   std::vector<glm::vec3>& positions) {
+  if (frame >= frame_count_) {
+    throw std::runtime_error("Trajectory frame " + std::to_string(frame) +
+                             " is out of range!");
+  }
+  auto after = std::upper_bound(
+      keyframes_.begin(), keyframes_.end(), frame,
+      [](uint64_t f, const Keyframe& keyframe) { return f < keyframe.frame; });
+  const Keyframe& keyframe = *(after - 1);
+  // Going on from the last read is cheaper than starting over, unless a
+  // keyframe lies in between.
+  if (!cursor_valid_ || next_frame_ > frame || next_frame_ < keyframe.frame) {
+    next_frame_ = keyframe.frame;
+    next_offset_ = keyframe.offset;
+  }
+
+  double time = 0.0;
+  cursor_valid_ = false;
+  while (next_frame_ <= frame) {
+    TrajectoryFrameHeader header = ReadFrameHeader(next_offset_);
+    const uint8_t* payload = reinterpret_cast<const uint8_t*>(
+        file_.GetData() + next_offset_ + sizeof(header));
+    if (!DecodeTrajectoryFrame(payload, header.payload_size,
+                               header.keyframe != 0, quantized_)) {
+      throw std::runtime_error(file_path_ + " is truncated or corrupt!");
+    }
+    time = header.time;
+    next_offset_ += sizeof(header) + header.payload_size;
+    next_frame_++;
+  }
+  cursor_valid_ = true;
+  DequantizePositions(quantized_, box_min_, box_max_, positions);
+  return time;
+}
+}  // namespace GLOO
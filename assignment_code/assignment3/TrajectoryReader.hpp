@@ -0,0 +1,80 @@
+#ifndef TRAJECTORY_READER_H_
+#define TRAJECTORY_READER_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "MappedFile.hpp"
+#include "TrajectoryFormat.hpp"
+
+namespace GLOO {
+// Random access to the frames of a trajectory file, see TrajectoryFormat.hpp.
+// The file is memory-mapped, so only the frames that are read get paged in.
+// Reading the frame after the last one read continues decoding where it
+// left off; any other frame is decoded forward from the keyframe before it.
+class TrajectoryReader {
+ public:
+  // Throws std::runtime_error if the file cannot be read or is not a
+  // trajectory of this version. Files without a keyframe index, from runs
+  // that did not close them, are scanned for their frames instead.
+  explicit TrajectoryReader(const std::string& file_path);
+
+  TrajectoryReader(const TrajectoryReader&) = delete;
+  void operator=(const TrajectoryReader&) = delete;
+
+  size_t GetParticleCount() const {
+    return particle_count_;
+  }
+  uint64_t GetFrameCount() const {
+    return frame_count_;
+  }
+  double GetStartTime() const {
+    return keyframes_.front().time;
+  }
+  double GetEndTime() const {
+    return end_time_;
+  }
+
+  // The last frame recorded at or before time, exact for frames recorded at
+  // a fixed rate and estimated from the keyframe times otherwise. Safe to
+  // call while another thread reads frames.
+  uint64_t FindFrame(double time) const;
+  // Decodes a frame into positions and returns its time. Throws
+  // std::runtime_error for frames out of range or malformed payloads.
+  double ReadFrame(uint64_t frame, std::vector<glm::vec3>& positions);
+
+ private:
+  struct Keyframe {
+    uint64_t frame;
+    uint64_t offset;
+    double time;
+  };
+
+  TrajectoryFrameHeader ReadFrameHeader(uint64_t offset) const;
+  bool ReadIndex();
+  void ScanFrames();
+
+  MappedFile file_;
+  std::string file_path_;
+  size_t particle_count_;
+  glm::vec3 box_min_;
+  glm::vec3 box_max_;
+  uint64_t frame_count_;
+  // Frames end where the index starts, or at the end of the file without one.
+  uint64_t frames_end_;
+  std::vector<Keyframe> keyframes_;
+  double end_time_;
+
+  // The frame the next sequential read decodes and where it starts;
+  // quantized_ holds the frame before it.
+  uint64_t next_frame_;
+  uint64_t next_offset_;
+  bool cursor_valid_;
+  std::vector<uint16_t> quantized_;
+};
+}  // namespace GLOO
+
+#endif
@@ -0,0 +1,157 @@
+#include "TrajectoryRecorder.hpp"
+
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include "gloo/debug/Tracer.hpp"
+
+namespace GLOO {
+TrajectoryRecorder::TrajectoryRecorder(const std::string& file_path,
+                                       size_t particle_count,
+                                       const glm::vec3& box_min,
+                                       const glm::vec3& box_max,
+                                       int keyframe_interval,
+                                       int max_pending_frames)
+    : file_path_(file_path),
+      particle_count_(particle_count),
+      box_min_(box_min),
+      box_max_(box_max),
+      keyframe_interval_(keyframe_interval),
+      dropped_frames_(0),
+      slots_(max_pending_frames),
+      first_pending_(0),
+      pending_count_(0),
+      stopping_(false),
+      write_failed_(false),
+      frame_count_(0) {
+  for (int axis = 0; axis < 3; axis++) {
+    if (!(box_max[axis] > box_min[axis]))
+      throw std::runtime_error("Trajectory box must not be empty!");
+  }
+  if (keyframe_interval < 1 || max_pending_frames < 1) {
+    throw std::runtime_error("Trajectory intervals must be positive!");
+  }
+  file_.open(file_path, std::ios::binary | std::ios::trunc);
+  if (!file_) {
+    throw std::runtime_error("Unable to create trajectory " + file_path + "!");
+  }
+
+  TrajectoryHeader header;
+  std::memcpy(header.magic, "GLOOTRAJ", sizeof(header.magic));
+  header.version = kTrajectoryVersion;
+  header.particle_count = uint32_t(particle_count);
+  header.keyframe_interval = uint32_t(keyframe_interval);
+  header.quantization_bits = kTrajectoryQuantizationBits;
+  for (int axis = 0; axis < 3; axis++) {
+    header.box_min[axis] = box_min[axis];
+    header.box_max[axis] = box_max[axis];
+  }
+  file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+  for (Frame& slot : slots_)
+    slot.positions.reserve(3 * particle_count);
+  writer_ = std::thread(&TrajectoryRecorder::WriterLoop, this);
+}
+
+TrajectoryRecorder::~TrajectoryRecorder() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  frame_ready_.notify_one();
+  writer_.join();
+  WriteIndex();
+  if (dropped_frames_ > 0) {
+    std::cerr << "Trajectory " << file_path_ << " dropped " << dropped_frames_
+              << " frames the writer could not keep up with" << std::endl;
+  }
+}
+
+void TrajectoryRecorder::RecordFrame(double time,
+                                     const std::vector<glm::vec3>& positions) {
+  if (positions.size() != particle_count_) {
+    throw std::runtime_error("Trajectory frame has the wrong particle count!");
+  }
+  int slot_index;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (pending_count_ == int(slots_.size())) {
+      dropped_frames_++;
+      return;
+    }
+    slot_index = (first_pending_ + pending_count_) % int(slots_.size());
+  }
+
+  Frame& slot = slots_[slot_index];
+  slot.time = time;
+  QuantizePositions(positions, box_min_, box_max_, slot.positions);
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_count_++;
+  }
+  frame_ready_.notify_one();
+}
+
+void TrajectoryRecorder::WriterLoop() {
+  Tracer::SetThreadName("Trajectory writer");
+  while (true) {
+    int slot_index;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      frame_ready_.wait(lock,
+                        [this] { return stopping_ || pending_count_ > 0; });
+      // Frames recorded before stopping are still written.
+      if (pending_count_ == 0)
+        return;
+      slot_index = first_pending_;
+    }
+
+    WriteFrame(slots_[slot_index]);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    first_pending_ = (first_pending_ + 1) % int(slots_.size());
+    pending_count_--;
+  }
+}
+
+void TrajectoryRecorder::WriteFrame(const Frame& frame) {
+  TraceScope trace("Write trajectory frame");
+  bool keyframe = frame_count_ % uint64_t(keyframe_interval_) == 0;
+  if (keyframe) {
+    index_.push_back(
+        TrajectoryIndexEntry{frame_count_, uint64_t(file_.tellp())});
+  }
+  payload_.clear();
+  EncodeTrajectoryFrame(previous_positions_, frame.positions, keyframe,
+                        payload_);
+  previous_positions_ = frame.positions;
+  frame_count_++;
+
+  TrajectoryFrameHeader header;
+  header.time = frame.time;
+  header.payload_size = uint32_t(payload_.size());
+  header.keyframe = keyframe ? 1 : 0;
+  file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file_.write(reinterpret_cast<const char*>(payload_.data()),
+              std::streamsize(payload_.size()));
+  if (!file_ && !write_failed_) {
+    write_failed_ = true;
+    std::cerr << "Unable to write trajectory " << file_path_ << "!"
+              << std::endl;
+  }
+}
+
+void TrajectoryRecorder::WriteIndex() {
+  TrajectoryTrailer trailer;
+  trailer.index_offset = uint64_t(file_.tellp());
+  trailer.index_count = index_.size();
+  trailer.frame_count = frame_count_;
+  std::memcpy(trailer.magic, "GLOOTEND", sizeof(trailer.magic));
+  file_.write(reinterpret_cast<const char*>(index_.data()),
+              std::streamsize(index_.size() * sizeof(TrajectoryIndexEntry)));
+  file_.write(reinterpret_cast<const char*>(&trailer), sizeof(trailer));
+  file_.flush();
+}
+}  // namespace GLOO
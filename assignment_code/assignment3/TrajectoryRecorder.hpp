@@ -0,0 +1,87 @@
+#ifndef TRAJECTORY_RECORDER_H_
+#define TRAJECTORY_RECORDER_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "TrajectoryFormat.hpp"
+
+namespace GLOO {
+// Streams particle positions to a trajectory file, see TrajectoryFormat.hpp,
+// for offline analysis of long runs. RecordFrame only quantizes the
+// positions into a free frame slot; a writer thread of the recorder's own
+// delta-codes and writes the frames, so the recording loop never waits on
+// the disk. If the writer falls max_pending_frames behind, new frames are
+// dropped and counted rather than blocking the caller.
+class TrajectoryRecorder {
+ public:
+  // Writes the file header; throws std::runtime_error if the file cannot be
+  // created or the box is empty.
+  TrajectoryRecorder(const std::string& file_path,
+                     size_t particle_count,
+                     const glm::vec3& box_min,
+                     const glm::vec3& box_max,
+                     int keyframe_interval = 256,
+                     int max_pending_frames = 64);
+  // Writes the frames still pending and the keyframe index.
+  ~TrajectoryRecorder();
+
+  TrajectoryRecorder(const TrajectoryRecorder&) = delete;
+  void operator=(const TrajectoryRecorder&) = delete;
+
+  // Call from one thread at a time.
+  void RecordFrame(double time, const std::vector<glm::vec3>& positions);
+
+  long GetDroppedFrames() const {
+    return dropped_frames_;
+  }
+  const std::string& GetPath() const {
+    return file_path_;
+  }
+
+ private:
+  struct Frame {
+    double time;
+    std::vector<uint16_t> positions;
+  };
+
+  void WriterLoop();
+  void WriteFrame(const Frame& frame);
+  void WriteIndex();
+
+  std::string file_path_;
+  size_t particle_count_;
+  glm::vec3 box_min_;
+  glm::vec3 box_max_;
+  int keyframe_interval_;
+  long dropped_frames_;
+
+  // A ring of frame slots. The recording thread fills the slot at
+  // (first_pending_ + pending_count_) and the writer drains from
+  // first_pending_; each only touches a slot while the other cannot.
+  std::vector<Frame> slots_;
+  std::mutex mutex_;
+  std::condition_variable frame_ready_;
+  int first_pending_;
+  int pending_count_;
+  bool stopping_;
+
+  // Used by the writer thread alone once it runs.
+  std::ofstream file_;
+  bool write_failed_;
+  uint64_t frame_count_;
+  std::vector<uint16_t> previous_positions_;
+  std::vector<uint8_t> payload_;
+  std::vector<TrajectoryIndexEntry> index_;
+  std::thread writer_;
+};
+}  // namespace GLOO
+
+#endif
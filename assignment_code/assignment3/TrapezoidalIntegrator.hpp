@@ -11,13 +11,29 @@ class TrapezoidalIntegrator : public IntegratorBase<TSystem, TState> {
                    float start_time,
                    float dt) const override {
 
-      ParticleState f_0 = system.ComputeTimeDerivative(state, start_time);
-      ParticleState f_1 = system.ComputeTimeDerivative(state + dt * f_0, start_time + dt);
+      TState f_0 = system.ComputeTimeDerivative(state, start_time);
+      TState f_1 = system.ComputeTimeDerivative(state + dt * f_0, start_time + dt);
 
-      ParticleState end_state = state + dt/2 * (f_0 + f_1);
+      TState end_state = state + dt/2 * (f_0 + f_1);
 
       return end_state;
   }
+
+  void Step(const TSystem& system,
+            TState& state,
+            float start_time,
+            float dt) override {
+      system.ComputeTimeDerivative(state, start_time, f_0_);
+      stage_ = state + dt * f_0_;
+      system.ComputeTimeDerivative(stage_, start_time + dt, f_1_);
+
+      state = state + dt / 2 * (f_0_ + f_1_);
+  }
+
+  // Stage buffers reused by Step so that steady-state steps do not allocate.
+  TState f_0_;
+  TState f_1_;
+  TState stage_;
 };
 }  // namespace GLOO
 
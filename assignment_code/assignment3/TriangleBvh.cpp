@@ -0,0 +1,155 @@
+#include "TriangleBvh.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace GLOO {
+namespace {
+const float kPi = 3.14159265f;
+
+// The smallest cone holding two cones, each given as an axis and the angle
+// around it.
+void MergeCones(const glm::vec3& axis_a,
+                float angle_a,
+                const glm::vec3& axis_b,
+                float angle_b,
+                glm::vec3& axis,
+                float& angle) {
+  if (angle_a >= kPi || angle_b >= kPi) {
+    axis = axis_a;
+    angle = kPi;
+    return;
+  }
+  float between = std::acos(glm::clamp(glm::dot(axis_a, axis_b), -1.0f, 1.0f));
+  if (between + angle_b <= angle_a) {
+    axis = axis_a;
+    angle = angle_a;
+    return;
+  }
+  if (between + angle_a <= angle_b) {
+    axis = axis_b;
+    angle = angle_b;
+    return;
+  }
+  angle = 0.5f * (between + angle_a + angle_b);
+  if (angle >= kPi || std::sin(between) <= 0.0f) {
+    axis = axis_a;
+    angle = kPi;
+    return;
+  }
+  // Turn axis_a towards axis_b, in their plane, until the cone's edge meets
+  // the far edge of cone b.
+  float turn = angle - angle_a;
+  axis = (std::sin(between - turn) * axis_a + std::sin(turn) * axis_b) /
+         std::sin(between);
+}
+}  // namespace
+
+void TriangleBvh::Build(const std::vector<glm::ivec3>& triangles,
+                        const std::vector<glm::vec3>& positions) {
+  if (triangles.empty()) {
+    throw std::runtime_error("A triangle BVH needs at least one triangle!");
+  }
+  triangles_ = triangles;
+  std::vector<glm::vec3> centroids(triangles.size());
+  std::vector<int> order(triangles.size());
+  for (size_t t = 0; t < triangles.size(); t++) {
+    const glm::ivec3& triangle = triangles[t];
+    centroids[t] = (positions[triangle.x] + positions[triangle.y] +
+                    positions[triangle.z]) / 3.0f;
+    order[t] = int(t);
+  }
+  nodes_.clear();
+  // A binary tree with a leaf per triangle has this many nodes.
+  nodes_.reserve(2 * triangles.size() - 1);
+  BuildRange(order, centroids, 0, int(order.size()));
+}
+
+int TriangleBvh::BuildRange(std::vector<int>& order,
+                            const std::vector<glm::vec3>& centroids,
+                            int begin,
+                            int end) {
+  int index = int(nodes_.size());
+  nodes_.push_back(
+      Node{glm::vec3(0.f), -1, glm::vec3(0.f), -1, glm::vec3(0.f), kPi, false,
+           false});
+  if (end - begin == 1) {
+    nodes_[index].triangle = order[begin];
+    return index;
+  }
+
+  glm::vec3 centroid_min = centroids[order[begin]];
+  glm::vec3 centroid_max = centroid_min;
+  for (int i = begin + 1; i < end; i++) {
+    centroid_min = glm::min(centroid_min, centroids[order[i]]);
+    centroid_max = glm::max(centroid_max, centroids[order[i]]);
+  }
+  glm::vec3 extent = centroid_max - centroid_min;
+  int axis = 0;
+  if (extent.y > extent[axis])
+    axis = 1;
+  if (extent.z > extent[axis])
+    axis = 2;
+  // Ties are broken by index so the tree does not depend on the library's
+  // nth_element.
+  int middle = begin + (end - begin) / 2;
+  std::nth_element(order.begin() + begin, order.begin() + middle,
+                   order.begin() + end, [&](int a, int b) {
+                     if (centroids[a][axis] != centroids[b][axis])
+                       return centroids[a][axis] < centroids[b][axis];
+                     return a < b;
+                   });
+  BuildRange(order, centroids, begin, middle);
+  nodes_[index].right = BuildRange(order, centroids, middle, end);
+  return index;
+}
+
+void TriangleBvh::Refit(const std::vector<glm::vec3>& start,
+                        const std::vector<glm::vec3>& end,
+                        const std::vector<uint8_t>& resting,
+                        float margin) {
+  // Children come after their parent, so going backwards visits them first.
+  for (int i = int(nodes_.size()) - 1; i >= 0; i--) {
+    Node& node = nodes_[i];
+    if (node.triangle >= 0) {
+      const glm::ivec3& triangle = triangles_[node.triangle];
+      glm::vec3 box_min = start[triangle.x];
+      glm::vec3 box_max = box_min;
+      for (int corner = 0; corner < 3; corner++) {
+        box_min = glm::min(glm::min(box_min, start[triangle[corner]]),
+                           end[triangle[corner]]);
+        box_max = glm::max(glm::max(box_max, start[triangle[corner]]),
+                           end[triangle[corner]]);
+      }
+      node.box_min = box_min - glm::vec3(margin);
+      node.box_max = box_max + glm::vec3(margin);
+      node.resting = resting[node.triangle] != 0;
+
+      glm::vec3 start_normal =
+          glm::cross(start[triangle.y] - start[triangle.x],
+                     start[triangle.z] - start[triangle.x]);
+      glm::vec3 end_normal = glm::cross(end[triangle.y] - end[triangle.x],
+                                        end[triangle.z] - end[triangle.x]);
+      float start_length = glm::length(start_normal);
+      float end_length = glm::length(end_normal);
+      if (start_length > 0.0f && end_length > 0.0f) {
+        MergeCones(start_normal / start_length, 0.0f, end_normal / end_length,
+                   0.0f, node.cone_axis, node.cone_angle);
+      } else {
+        // A collapsed triangle could face any way.
+        node.cone_angle = kPi;
+      }
+    } else {
+      const Node& left = nodes_[i + 1];
+      const Node& right = nodes_[node.right];
+      node.box_min = glm::min(left.box_min, right.box_min);
+      node.box_max = glm::max(left.box_max, right.box_max);
+      node.resting = left.resting && right.resting;
+      MergeCones(left.cone_axis, left.cone_angle, right.cone_axis,
+                 right.cone_angle, node.cone_axis, node.cone_angle);
+    }
+    node.flat = node.cone_angle < 0.5f * kPi;
+  }
+}
+}  // namespace GLOO
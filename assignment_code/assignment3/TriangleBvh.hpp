@@ -0,0 +1,124 @@
+#ifndef TRIANGLE_BVH_H_
+#define TRIANGLE_BVH_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace GLOO {
+// A bounding-volume hierarchy of axis-aligned boxes over a fixed set of
+// triangles, for finding which triangles of a deforming mesh may touch.
+// Build splits the triangles once from a rest pose; after that only the
+// boxes change, and Refit recomputes them bottom-up in one linear pass
+// without touching the tree's shape. Nodes are stored in depth-first order,
+// so a node's children always come after it.
+//
+// Each node also keeps a cone around the normals of its triangles. A patch
+// whose normals all lie within 90 degrees of one direction cannot fold onto
+// itself (Volino and Magnenat-Thalmann), so pairs within such a subtree are
+// skipped, which leaves a smooth cloth with few pairs to test beyond the
+// seams between subtrees. The test ignores the patch's outline, which for
+// the compact patches of a cloth's grid only matters if it is crumpled.
+class TriangleBvh {
+ public:
+  TriangleBvh() = default;
+
+  // Builds the tree over triangles, which index into positions, by median
+  // splits of their centroids along the longest axis. Boxes are left empty
+  // until the first Refit.
+  void Build(const std::vector<glm::ivec3>& triangles,
+             const std::vector<glm::vec3>& positions);
+  // Fits every box around its triangles' corners at both start and end,
+  // grown by margin on every side, so it holds the triangles throughout
+  // a step that moves each particle linearly from start to end. Normal
+  // cones hold the normals at start and end. Triangles t with resting[t]
+  // set are held in place, such as cloth lying on the ground, and are not
+  // paired with each other.
+  void Refit(const std::vector<glm::vec3>& start,
+             const std::vector<glm::vec3>& end,
+             const std::vector<uint8_t>& resting,
+             float margin);
+
+  // Calls visit(t, u) with t < u once for every pair of distinct triangles
+  // whose boxes overlap, other than pairs within a flat subtree and pairs
+  // of resting triangles, in an order that depends only on the tree. Uses
+  // scratch space of the tree, so one traversal runs at a time.
+  template <class Visit>
+  void ForEachOverlappingPair(const Visit& visit) const {
+    if (nodes_.empty())
+      return;
+    pair_stack_.clear();
+    pair_stack_.push_back(std::make_pair(0, 0));
+    while (!pair_stack_.empty()) {
+      int a = pair_stack_.back().first;
+      int b = pair_stack_.back().second;
+      pair_stack_.pop_back();
+      const Node& node_a = nodes_[a];
+      const Node& node_b = nodes_[b];
+      if (a == b) {
+        // Pairs within a subtree: within each child and across the two.
+        if (node_a.triangle >= 0 || node_a.flat || node_a.resting)
+          continue;
+        pair_stack_.push_back(std::make_pair(a + 1, node_a.right));
+        pair_stack_.push_back(std::make_pair(node_a.right, node_a.right));
+        pair_stack_.push_back(std::make_pair(a + 1, a + 1));
+        continue;
+      }
+      if ((node_a.resting && node_b.resting) || !Overlap(node_a, node_b))
+        continue;
+      if (node_a.triangle >= 0 && node_b.triangle >= 0) {
+        visit(std::min(node_a.triangle, node_b.triangle),
+              std::max(node_a.triangle, node_b.triangle));
+      } else if (node_a.triangle < 0) {
+        pair_stack_.push_back(std::make_pair(node_a.right, b));
+        pair_stack_.push_back(std::make_pair(a + 1, b));
+      } else {
+        pair_stack_.push_back(std::make_pair(a, node_b.right));
+        pair_stack_.push_back(std::make_pair(a, b + 1));
+      }
+    }
+  }
+
+ private:
+  struct Node {
+    glm::vec3 box_min;
+    // Second child of an internal node; the first is the next node.
+    int right;
+    glm::vec3 box_max;
+    // Index into the triangles for a leaf, -1 for an internal node.
+    int triangle;
+    // Every normal is within cone_angle radians of cone_axis. An angle of
+    // pi or more stands for any direction.
+    glm::vec3 cone_axis;
+    float cone_angle;
+    // Whether cone_angle is below 90 degrees.
+    bool flat;
+    // Whether every triangle below is resting.
+    bool resting;
+  };
+
+  static bool Overlap(const Node& a, const Node& b) {
+    for (int axis = 0; axis < 3; axis++) {
+      if (a.box_max[axis] < b.box_min[axis] ||
+          b.box_max[axis] < a.box_min[axis]) {
+        return false;
+      }
+    }
+    return true;
+  }
+  // Appends the subtree over order[begin, end) and returns its root.
+  int BuildRange(std::vector<int>& order,
+                 const std::vector<glm::vec3>& centroids,
+                 int begin,
+                 int end);
+
+  std::vector<glm::ivec3> triangles_;
+  std::vector<Node> nodes_;
+  mutable std::vector<std::pair<int, int>> pair_stack_;
+};
+}  // namespace GLOO
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef TRIPLE_BUFFER_H_
+#define TRIPLE_BUFFER_H_
+
+#include <atomic>
+
+namespace GLOO {
+// Hands the latest value from one producer thread to one consumer thread
+// without locks. The producer fills GetWriteBuffer() and calls Publish(); the
+// consumer calls Update() and reads GetReadBuffer(). Each side owns one of
+// the three buffers and they swap through the third, so neither side ever
+// waits for the other and values the consumer missed are simply skipped.
+template <class T>
+class TripleBuffer {
+ public:
+  TripleBuffer() : write_(0), middle_(1), read_(2) {
+  }
+
+  // Sets all three buffers. Only call before the producer starts.
+  void Reset(const T& value) {
+    for (T& buffer : buffers_)
+      buffer = value;
+    middle_.store(middle_.load() & kIndexMask);
+  }
+
+  // Holds an older value after each Publish, so overwrite it in full.
+  T& GetWriteBuffer() {
+    return buffers_[write_];
+  }
+  void Publish() {
+    write_ = middle_.exchange(write_ | kFresh, std::memory_order_acq_rel) &
+             kIndexMask;
+  }
+
+  // Makes the most recently published value readable. Returns false if
+  // nothing was published since the last call.
+  bool Update() {
+    if ((middle_.load(std::memory_order_relaxed) & kFresh) == 0)
+      return false;
+    read_ = middle_.exchange(read_, std::memory_order_acq_rel) & kIndexMask;
+    return true;
+  }
+  const T& GetReadBuffer() const {
+    return buffers_[read_];
+  }
+
+ private:
+  // middle_ holds a buffer index, plus kFresh while it is unread.
+  static const int kIndexMask = 3;
+  static const int kFresh = 4;
+
+  T buffers_[3];
+  int write_;
+  std::atomic<int> middle_;
+  int read_;
+};
+}  // namespace GLOO
+
+#endif
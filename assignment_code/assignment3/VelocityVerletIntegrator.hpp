@@ -0,0 +1,77 @@
+#ifndef VELOCITY_VERLET_INTEGRATOR_H_
+#define VELOCITY_VERLET_INTEGRATOR_H_
+
+#include "IntegratorBase.hpp"
+
+namespace GLOO {
+// Velocity Verlet, updated in place:
+//
+//   x' = x + dt v + dt^2 / 2 a
+//   v' = v + dt / 2 (a + a')
+//
+// where a' is evaluated at x' and the half-step velocity. The forces at the
+// end of a step are kept for the start of the next, so a step costs one
+// force evaluation. The integrator cannot tell whether they still hold:
+// callers that change the state between steps (collisions, dragging) or the
+// system (gravity, wind, pins, masses), or that start a step at another time
+// than the last one ended, must call Invalidate first, and the next step
+// evaluates them again.
+template <class TSystem, class TState>
+class VelocityVerletIntegrator : public IntegratorBase<TSystem, TState> {
+  TState Integrate(const TSystem& system,
+                   const TState& state,
+                   float start_time,
+                   float dt) const override {
+      TState end_state = state;
+      VelocityVerletIntegrator stepper;
+      stepper.Step(system, end_state, start_time, dt);
+      return end_state;
+  }
+
+  void Step(const TSystem& system,
+            TState& state,
+            float start_time,
+            float dt) override {
+      if (!forces_valid_ || derivative_.BlockSize() != state.BlockSize()) {
+          system.ComputeTimeDerivative(state, start_time, derivative_);
+      }
+      const int half = TState::kBlockCount / 2;
+      size_t n = state.BlockSize();
+      for (int block = 0; block < half; block++) {
+          float* x = state.BlockData(block);
+          float* v = state.BlockData(block + half);
+          const float* dx = derivative_.BlockData(block);
+          const float* dv = derivative_.BlockData(block + half);
+          for (size_t i = 0; i < n; i++) {
+              x[i] += dt * (dx[i] + dt / 2 * dv[i]);
+              v[i] += dt / 2 * dv[i];
+          }
+      }
+
+      system.ComputeTimeDerivative(state, start_time + dt, derivative_);
+      for (int block = 0; block < half; block++) {
+          float* v = state.BlockData(block + half);
+          float* dx = derivative_.BlockData(block);
+          const float* dv = derivative_.BlockData(block + half);
+          for (size_t i = 0; i < n; i++) {
+              v[i] += dt / 2 * dv[i];
+              // dx was evaluated at the half-step velocity; bring it to the
+              // end of the step so the next one can start from it.
+              dx[i] += dt / 2 * dv[i];
+          }
+      }
+      forces_valid_ = true;
+  }
+
+  void Invalidate() override {
+      forces_valid_ = false;
+  }
+
+  // Reused by Step so that steady-state steps do not allocate.
+  TState derivative_;
+  // Whether derivative_ holds the forces at the end of the last step.
+  bool forces_valid_ = false;
+};
+}  // namespace GLOO
+
+#endif
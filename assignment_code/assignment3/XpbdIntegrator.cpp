@@ -0,0 +1,148 @@
+#include "XpbdIntegrator.hpp"
+
+#include <algorithm>
+
+#include "gloo/debug/Tracer.hpp"
+
+namespace GLOO {
+XpbdIntegrator::XpbdIntegrator(int iterations)
+    : iterations_(iterations), built_spring_count_(0) {
+}
+
+ParticleState XpbdIntegrator::Integrate(const PendulumSystem& system,
+                                        const ParticleState& state,
+                                        float start_time,
+                                        float dt) const {
+  ParticleState end_state = state;
+  XpbdIntegrator solver(iterations_);
+  solver.Step(system, end_state, start_time, dt);
+  return end_state;
+}
+
+void XpbdIntegrator::Step(const PendulumSystem& system,
+                          ParticleState& state,
+                          float start_time,
+                          float dt) {
+  if (color_offsets_.empty() ||
+      built_spring_count_ != system.GetSprings().size()) {
+    BuildConstraints(system);
+  }
+  size_t n = state.Size();
+
+  // Predict positions from the external forces. Fixed particles get zero
+  // inverse mass, so the constraints never move them.
+  glm::vec3 gravity = system.GetGravity();
+  glm::vec3 wind = system.ComputeWind(start_time);
+  float drag = system.GetDrag();
+  inverse_masses_.resize(n);
+  previous_positions_.assign(state.positions.begin(), state.positions.end());
+  for (size_t i = 0; i < n; i++) {
+    if (system.IsFixed(int(i))) {
+      inverse_masses_[i] = 0.0f;
+      continue;
+    }
+    float inverse_mass = 1.0f / system.GetMass(int(i));
+    inverse_masses_[i] = inverse_mass;
+    glm::vec3 force = wind - drag * state.velocities[i];
+    state.velocities[i] += dt * (gravity + inverse_mass * force);
+    state.positions[i] += dt * state.velocities[i];
+  }
+
+  std::fill(lambdas_.begin(), lambdas_.end(), 0.0f);
+  for (int iteration = 0; iteration < iterations_; iteration++) {
+    TraceScope trace("XPBD iteration");
+    for (int color = 0; color < GetColorCount(); color++) {
+      int offset = color_offsets_[color];
+      int count = color_offsets_[color + 1] - offset;
+      system.ForEachRange(count, [&](int begin, int end) {
+        SolveConstraintRange(state, dt, offset + begin, offset + end);
+      });
+    }
+  }
+
+  for (size_t i = 0; i < n; i++) {
+    state.velocities[i] = inverse_masses_[i] == 0.0f
+                              ? glm::vec3(0.f)
+                              : (state.positions[i] - previous_positions_[i]) / dt;
+  }
+}
+
+void XpbdIntegrator::SolveConstraintRange(ParticleState& state,
+                                          float dt,
+                                          int begin,
+                                          int end) {
+  float inverse_dt2 = 1.0f / (dt * dt);
+  for (int c = begin; c < end; c++) {
+    int a = constraint_starts_[c];
+    int b = constraint_ends_[c];
+    float w_a = inverse_masses_[a];
+    float w_b = inverse_masses_[b];
+    float alpha = compliances_[c] * inverse_dt2;
+    float denominator = w_a + w_b + alpha;
+    glm::vec3 d = state.positions[a] - state.positions[b];
+    float d_length = glm::length(d);
+    if (denominator == 0.0f || d_length == 0.0f)
+      continue;
+
+    float violation = d_length - rest_lengths_[c];
+    float delta_lambda = (-violation - alpha * lambdas_[c]) / denominator;
+    lambdas_[c] += delta_lambda;
+    glm::vec3 correction = delta_lambda * (d / d_length);
+    state.positions[a] += w_a * correction;
+    state.positions[b] -= w_b * correction;
+  }
+}
+
+void XpbdIntegrator::BuildConstraints(const PendulumSystem& system) {
+  const std::vector<Spring>& springs = system.GetSprings();
+  int num_springs = int(springs.size());
+
+  // Greedy coloring: each spring takes the smallest color not yet used by a
+  // spring at either endpoint.
+  std::vector<std::vector<int>> particle_colors;
+  std::vector<int> spring_colors(num_springs);
+  int num_colors = 0;
+  for (int s = 0; s < num_springs; s++) {
+    int largest = std::max(springs[s].start, springs[s].end);
+    if (int(particle_colors.size()) <= largest) {
+      particle_colors.resize(largest + 1);
+    }
+    std::vector<int>& start_colors = particle_colors[springs[s].start];
+    std::vector<int>& end_colors = particle_colors[springs[s].end];
+    int color = 0;
+    while (std::find(start_colors.begin(), start_colors.end(), color) !=
+               start_colors.end() ||
+           std::find(end_colors.begin(), end_colors.end(), color) !=
+               end_colors.end()) {
+      color++;
+    }
+    start_colors.push_back(color);
+    end_colors.push_back(color);
+    spring_colors[s] = color;
+    num_colors = std::max(num_colors, color + 1);
+  }
+
+  // Counting sort by color, keeping spring order within a color.
+  color_offsets_.assign(num_colors + 1, 0);
+  for (int s = 0; s < num_springs; s++) {
+    color_offsets_[spring_colors[s] + 1]++;
+  }
+  for (int c = 0; c < num_colors; c++) {
+    color_offsets_[c + 1] += color_offsets_[c];
+  }
+  constraint_starts_.resize(num_springs);
+  constraint_ends_.resize(num_springs);
+  rest_lengths_.resize(num_springs);
+  compliances_.resize(num_springs);
+  lambdas_.resize(num_springs);
+  std::vector<int> cursor(color_offsets_.begin(), color_offsets_.end() - 1);
+  for (int s = 0; s < num_springs; s++) {
+    int c = cursor[spring_colors[s]]++;
+    constraint_starts_[c] = springs[s].start;
+    constraint_ends_[c] = springs[s].end;
+    rest_lengths_[c] = springs[s].rest_length;
+    compliances_[c] = 1.0f / springs[s].stiffness;
+  }
+  built_spring_count_ = springs.size();
+}
+}  // namespace GLOO
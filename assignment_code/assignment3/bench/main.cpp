@@ -0,0 +1,406 @@
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ClothSimulation.hpp"
+#include "IntegratorFactory.hpp"
+
+using namespace GLOO;
+
+// Microbenchmarks for the cloth force evaluation and every integrator, over
+// a grid of cloth resolutions and thread counts, in the ParticleState layout
+// and, where supported, the SoaParticleState one. Results go out as JSON so
+// runs before and after a change can be compared by script.
+
+namespace {
+// Every heap allocation in the process goes through these, so the
+// allocations made while stepping can be counted.
+std::atomic<long> allocation_count(0);
+}  // namespace
+
+void* operator new(size_t size) {
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  void* ptr = std::malloc(size == 0 ? 1 : size);
+  if (ptr == nullptr)
+    throw std::bad_alloc();
+  return ptr;
+}
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+void operator delete(void* ptr) noexcept {
+  std::free(ptr);
+}
+void operator delete[](void* ptr) noexcept {
+  std::free(ptr);
+}
+void operator delete(void* ptr, size_t) noexcept {
+  std::free(ptr);
+}
+void operator delete[](void* ptr, size_t) noexcept {
+  std::free(ptr);
+}
+
+namespace {
+struct Options {
+  std::vector<int> resolutions{12, 32, 128, 512, 1024};
+  std::vector<int> thread_counts;
+  std::vector<char> kernels{'f', 'e', 's', 'v', 't', 'r', 'd', 'i', 'x'};
+  std::vector<std::string> layouts{"aos", "soa"};
+  float dt = 0.001f;
+  double min_time = 0.25;
+  int min_steps = 3;
+  std::string output;
+};
+
+struct Measurement {
+  long steps;
+  double seconds;
+  long allocations;
+};
+
+struct Result {
+  char kernel;
+  // Whether the kernel ran over SoaParticleState rather than ParticleState.
+  bool soa;
+  int resolution;
+  size_t particles;
+  int threads;
+  Measurement measurement;
+
+  double NsPerStep() const {
+    return measurement.seconds * 1e9 / measurement.steps;
+  }
+  double NsPerParticleStep() const {
+    return NsPerStep() / particles;
+  }
+  double AllocationsPerStep() const {
+    return double(measurement.allocations) / measurement.steps;
+  }
+};
+
+const char* KernelName(char kernel) {
+  switch (kernel) {
+    case 'f':
+      return "derivative";
+    case 'e':
+      return "euler";
+    case 's':
+      return "symplectic_euler";
+    case 'v':
+      return "velocity_verlet";
+    case 't':
+      return "trapezoidal";
+    case 'r':
+      return "rk4";
+    case 'd':
+      return "dormand_prince";
+    case 'i':
+      return "implicit_euler";
+    case 'x':
+      return "xpbd";
+  }
+  return "unknown";
+}
+
+const char* LayoutName(bool soa) {
+  return soa ? "soa" : "aos";
+}
+
+// Implicit Euler and XPBD work on ParticleStates only.
+bool SupportsSoa(char kernel) {
+  return kernel != 'i' && kernel != 'x';
+}
+
+std::vector<std::string> ParseStringList(const std::string& text) {
+  std::vector<std::string> values;
+  std::stringstream stream(text);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    values.push_back(item);
+  }
+  return values;
+}
+
+std::vector<int> ParseIntList(const std::string& text) {
+  std::vector<int> values;
+  std::stringstream stream(text);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    values.push_back(std::stoi(item));
+  }
+  return values;
+}
+
+// Runs step once to warm up buffers, then repeatedly until both min_steps
+// and min_time are reached. Allocations are counted after the warm-up.
+template <class Step>
+Measurement Measure(const Options& options, const Step& step) {
+  step();
+  using Clock = std::chrono::steady_clock;
+  long allocations_before = allocation_count.load();
+  Clock::time_point start = Clock::now();
+  Measurement measurement{0, 0.0, 0};
+  do {
+    step();
+    measurement.steps++;
+    measurement.seconds =
+        std::chrono::duration<double>(Clock::now() - start).count();
+  } while (measurement.steps < options.min_steps ||
+           measurement.seconds < options.min_time);
+  measurement.allocations = allocation_count.load() - allocations_before;
+  return measurement;
+}
+
+// Times the kernel on state, which holds the cloth in either layout.
+template <class TState>
+Measurement MeasureKernel(const Options& options,
+                          char kernel,
+                          const PendulumSystem& system,
+                          TState& state) {
+  if (kernel == 'f') {
+    TState derivative;
+    return Measure(options, [&]() {
+      system.ComputeTimeDerivative(state, 0.0f, derivative);
+    });
+  }
+  std::unique_ptr<IntegratorBase<PendulumSystem, TState>> integrator =
+      IntegratorFactory::CreateIntegrator<PendulumSystem, TState>(
+          ParseIntegratorType(kernel));
+  float time = 0.0f;
+  return Measure(options, [&]() {
+    integrator->Step(system, state, time, options.dt);
+    time += options.dt;
+  });
+}
+
+Result Run(const Options& options,
+           char kernel,
+           bool soa,
+           int resolution,
+           int threads) {
+  ClothParameters parameters;
+  parameters.resolution = resolution;
+  ClothSimulation simulation(IntegratorType::Euler, options.dt, parameters);
+  simulation.SetThreadCount(threads);
+  const PendulumSystem& system = simulation.GetSystem();
+  ParticleState state = simulation.GetState();
+
+  Result result{kernel, soa, resolution, state.Size(), threads, {0, 0.0, 0}};
+  if (soa) {
+    SoaParticleState soa_state = SoaParticleState::FromAos(state);
+    result.measurement = MeasureKernel(options, kernel, system, soa_state);
+  } else {
+    result.measurement = MeasureKernel(options, kernel, system, state);
+  }
+  return result;
+}
+
+const Result* Find(const std::vector<Result>& results,
+                   char kernel,
+                   bool soa,
+                   int resolution,
+                   int threads) {
+  for (const Result& result : results) {
+    if (result.kernel == kernel && result.soa == soa &&
+        result.resolution == resolution && result.threads == threads)
+      return &result;
+  }
+  return nullptr;
+}
+
+void PrintUsage(const char* name) {
+  printf("Usage: %s [options]\n", name);
+  printf("       --resolutions=12,32,...  cloth particles per side\n");
+  printf("       --threads=1,2,...        thread counts (default 1 and all "
+         "cores)\n");
+  printf("       --kernels=fsvtrdix       f: force evaluation only, others "
+         "as integrator letters\n");
+  printf("       --layouts=aos,soa        particle state layouts; i and x "
+         "only run in aos\n");
+  printf("       --dt=0.001               integrator step\n");
+  printf("       --min-time=0.25          seconds per measurement\n");
+  printf("       --min-steps=3            steps per measurement\n");
+  printf("       --output=file.json       write JSON here instead of stdout\n");
+  printf("%s", kIntegratorUsage);
+}
+
+Options ParseOptions(int argc, char** argv) {
+  Options options;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    size_t equals = arg.find('=');
+    std::string key = arg.substr(0, equals);
+    std::string value = equals == std::string::npos ? "" : arg.substr(equals + 1);
+    if (key == "--resolutions") {
+      options.resolutions = ParseIntList(value);
+    } else if (key == "--threads") {
+      options.thread_counts = ParseIntList(value);
+    } else if (key == "--kernels") {
+      options.kernels.assign(value.begin(), value.end());
+    } else if (key == "--layouts") {
+      options.layouts = ParseStringList(value);
+      for (const std::string& layout : options.layouts) {
+        if (layout != "aos" && layout != "soa") {
+          PrintUsage(argv[0]);
+          std::exit(-1);
+        }
+      }
+    } else if (key == "--dt") {
+      options.dt = std::stof(value);
+    } else if (key == "--min-time") {
+      options.min_time = std::stod(value);
+    } else if (key == "--min-steps") {
+      options.min_steps = std::stoi(value);
+    } else if (key == "--output") {
+      options.output = value;
+    } else {
+      PrintUsage(argv[0]);
+      std::exit(-1);
+    }
+  }
+  if (options.thread_counts.empty()) {
+    int cores = int(std::thread::hardware_concurrency());
+    options.thread_counts.push_back(1);
+    if (cores > 1)
+      options.thread_counts.push_back(cores);
+  }
+  return options;
+}
+
+void WriteJson(FILE* out,
+               const Options& options,
+               const std::vector<Result>& results) {
+  fprintf(out, "{\n  \"config\": {\n");
+  fprintf(out, "    \"dt\": %g,\n    \"min_time\": %g,\n    \"min_steps\": %d,\n",
+          options.dt, options.min_time, options.min_steps);
+  fprintf(out, "    \"hardware_threads\": %u\n  },\n",
+          std::thread::hardware_concurrency());
+
+  fprintf(out, "  \"results\": [");
+  for (size_t i = 0; i < results.size(); i++) {
+    const Result& r = results[i];
+    fprintf(out,
+            "%s\n    {\"kernel\": \"%s\", \"layout\": \"%s\", \"resolution\": "
+            "%d, \"particles\": %zu, \"threads\": %d, \"steps\": %ld, "
+            "\"ns_per_step\": %.1f, \"ns_per_particle_step\": %.3f, "
+            "\"allocations_per_step\": %.3f}",
+            i == 0 ? "" : ",", KernelName(r.kernel), LayoutName(r.soa),
+            r.resolution, r.particles, r.threads, r.measurement.steps,
+            r.NsPerStep(), r.NsPerParticleStep(), r.AllocationsPerStep());
+  }
+  fprintf(out, "\n  ],\n");
+
+  // Layout: the same kernel, cloth and threads in the SoA layout, relative
+  // to the AoS one.
+  fprintf(out, "  \"soa_speedup\": [");
+  bool first = true;
+  for (const Result& r : results) {
+    const Result* aos =
+        r.soa ? Find(results, r.kernel, false, r.resolution, r.threads)
+              : nullptr;
+    if (aos == nullptr)
+      continue;
+    fprintf(out,
+            "%s\n    {\"kernel\": \"%s\", \"resolution\": %d, \"threads\": %d, "
+            "\"speedup\": %.3f}",
+            first ? "" : ",", KernelName(r.kernel), r.resolution, r.threads,
+            aos->NsPerStep() / r.NsPerStep());
+    first = false;
+  }
+  fprintf(out, "\n  ],\n");
+
+  // Strong scaling: the same cloth on more threads, relative to one thread.
+  fprintf(out, "  \"strong_scaling\": [");
+  first = true;
+  for (const Result& r : results) {
+    const Result* serial = Find(results, r.kernel, r.soa, r.resolution, 1);
+    if (serial == nullptr || r.threads == 1)
+      continue;
+    double speedup = serial->NsPerStep() / r.NsPerStep();
+    fprintf(out,
+            "%s\n    {\"kernel\": \"%s\", \"layout\": \"%s\", \"resolution\": "
+            "%d, \"threads\": %d, \"speedup\": %.3f, \"efficiency\": %.3f}",
+            first ? "" : ",", KernelName(r.kernel), LayoutName(r.soa),
+            r.resolution, r.threads, speedup, speedup / r.threads);
+    first = false;
+  }
+  fprintf(out, "\n  ],\n");
+
+  // Weak scaling: per-thread work held constant. A run on n threads is
+  // paired with the smaller single-threaded cloth whose particle count is
+  // closest to 1/n of its own; efficiency compares per-thread throughput.
+  fprintf(out, "  \"weak_scaling\": [");
+  first = true;
+  for (const Result& r : results) {
+    if (r.threads == 1)
+      continue;
+    const Result* base = nullptr;
+    double target = double(r.particles) / r.threads;
+    for (const Result& candidate : results) {
+      if (candidate.kernel != r.kernel || candidate.soa != r.soa ||
+          candidate.threads != 1 || candidate.particles >= r.particles)
+        continue;
+      if (base == nullptr || std::fabs(std::log(candidate.particles / target)) <
+                                 std::fabs(std::log(base->particles / target)))
+        base = &candidate;
+    }
+    if (base == nullptr)
+      continue;
+    double efficiency =
+        base->NsPerParticleStep() / (r.NsPerParticleStep() * r.threads);
+    fprintf(out,
+            "%s\n    {\"kernel\": \"%s\", \"layout\": \"%s\", \"threads\": %d, "
+            "\"resolution\": %d, \"base_resolution\": %d, \"efficiency\": "
+            "%.3f}",
+            first ? "" : ",", KernelName(r.kernel), LayoutName(r.soa),
+            r.threads, r.resolution, base->resolution, efficiency);
+    first = false;
+  }
+  fprintf(out, "\n  ]\n}\n");
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options = ParseOptions(argc, argv);
+
+  std::vector<Result> results;
+  for (char kernel : options.kernels) {
+    for (const std::string& layout : options.layouts) {
+      bool soa = layout == "soa";
+      if (soa && !SupportsSoa(kernel))
+        continue;
+      for (int resolution : options.resolutions) {
+        for (int threads : options.thread_counts) {
+          fprintf(stderr, "%-18s %s %5dx%-5d %2d threads ... ",
+                  KernelName(kernel), LayoutName(soa), resolution, resolution,
+                  threads);
+          results.push_back(Run(options, kernel, soa, resolution, threads));
+          fprintf(stderr, "%.2f ns/particle-step\n",
+                  results.back().NsPerParticleStep());
+        }
+      }
+    }
+  }
+
+  FILE* out = stdout;
+  if (!options.output.empty()) {
+    out = fopen(options.output.c_str(), "w");
+    if (out == nullptr) {
+      fprintf(stderr, "Cannot open %s!\n", options.output.c_str());
+      return -1;
+    }
+  }
+  WriteJson(out, options, results);
+  if (out != stdout)
+    fclose(out);
+  return 0;
+}
@@ -0,0 +1,181 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ClothSimulation.hpp"
+#include "IntegratorType.hpp"
+#include "TrajectoryRecorder.hpp"
+#include "gloo/debug/Profiler.hpp"
+#include "gloo/debug/Tracer.hpp"
+
+using namespace GLOO;
+
+// Runs the cloth simulation without a window or GL context and reports the
+// raw physics throughput.
+int main(int argc, char** argv) {
+  // Options may go anywhere; everything else is positional.
+  std::vector<std::string> args;
+  std::string load_path;
+  std::string save_path;
+  std::string record_path;
+  bool deterministic = false;
+  int hash_interval = 0;
+  float self_collision_thickness = 0.0f;
+  bool continuous_collision = false;
+  bool swept_spheres = false;
+  bool soa_layout = false;
+  AdaptiveTolerances tolerances;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg.compare(0, 7, "--load=") == 0) {
+      load_path = arg.substr(7);
+    } else if (arg.compare(0, 7, "--save=") == 0) {
+      save_path = arg.substr(7);
+    } else if (arg.compare(0, 9, "--record=") == 0) {
+      record_path = arg.substr(9);
+    } else if (arg == "--deterministic") {
+      deterministic = true;
+    } else if (arg.compare(0, 13, "--hash-every=") == 0) {
+      hash_interval = std::stoi(arg.substr(13));
+    } else if (arg.compare(0, 17, "--self-collision=") == 0) {
+      self_collision_thickness = std::stof(arg.substr(17));
+    } else if (arg == "--ccd") {
+      continuous_collision = true;
+    } else if (arg == "--swept-spheres") {
+      swept_spheres = true;
+    } else if (arg == "--soa") {
+      soa_layout = true;
+    } else if (arg.compare(0, 13, "--tolerances=") == 0) {
+      // <relative>,<absolute>, or one value for both.
+      std::string values = arg.substr(13);
+      size_t comma = values.find(',');
+      tolerances.relative = std::stof(values.substr(0, comma));
+      tolerances.absolute = comma == std::string::npos
+                                ? tolerances.relative
+                                : std::stof(values.substr(comma + 1));
+    } else {
+      args.push_back(arg);
+    }
+  }
+
+  if (tolerances.relative <= 0.0f || tolerances.absolute <= 0.0f) {
+    printf("Tolerances must be positive\n");
+    return -1;
+  }
+  if (args.size() != 4 && args.size() != 5) {
+    printf("Usage: %s <e|s|v|t|r|d|i|x> <timestep> <resolution> <duration> "
+           "[threads] [--load=<checkpoint>] [--save=<checkpoint>] "
+           "[--record=<trajectory>] [--deterministic] [--hash-every=<steps>] "
+           "[--self-collision=<thickness>] [--ccd] [--swept-spheres] "
+           "[--tolerances=<relative>,<absolute>] [--soa]\n",
+           argv[0]);
+    printf("%s", kIntegratorUsage);
+    printf("       resolution: cloth particles per side\n");
+    printf("       duration: simulated seconds\n");
+    printf("       threads: worker threads for cloth forces (default 1)\n");
+    printf("       --load: resume from a checkpoint of the same resolution\n");
+    printf("       --save: write a checkpoint when the run ends\n");
+    printf("       --record: stream every step's positions to a file\n");
+    printf("       --deterministic: fixed steps with the ball moved before each\n");
+    printf("       --hash-every: print a hash of the state every this many steps\n");
+    printf("       --self-collision: keep the cloth this far from itself\n");
+    printf("       --ccd: stop the cloth tunneling through itself\n");
+    printf("       --swept-spheres: stop the cloth tunneling through the ball\n");
+    printf("       --tolerances: error tolerances of d (default 0.001,0.001)\n");
+    printf("       --soa: integrate in the structure-of-arrays layout\n");
+    printf("\n");
+    printf("Try  : %s r 0.005 32 10\n", argv[0]);
+    printf("       for 10 simulated seconds of a 32x32 cloth with RK4\n");
+    printf("Or   : %s i 0.016 256 20 8 --save=settled.ckpt\n", argv[0]);
+    printf("       to let a 256x256 cloth settle once and keep the result\n");
+    printf("Or   : %s r 0.005 64 10 4 --deterministic --hash-every=100\n", argv[0]);
+    printf("       and diff the hashes against a run on 1 thread\n");
+    return -1;
+  }
+
+  IntegratorType integrator_type = ParseIntegratorType(args[0][0]);
+  float integration_step = std::stof(args[1]);
+  int resolution = std::stoi(args[2]);
+  float duration = std::stof(args[3]);
+  int thread_count = args.size() == 5 ? std::stoi(args[4]) : 1;
+
+  // Set GLOO_TRACE=trace.json to record a timeline of the run.
+  Tracer::SetThreadName("Main");
+  Tracer::GetInstance().StartFromEnvironment();
+
+  ClothParameters parameters;
+  parameters.resolution = resolution;
+  parameters.checkpoint = load_path;
+  parameters.deterministic = deterministic;
+  parameters.self_collision_thickness = self_collision_thickness;
+  parameters.continuous_collision = continuous_collision;
+  parameters.swept_spheres = swept_spheres;
+  parameters.tolerances = tolerances;
+  parameters.soa_layout = soa_layout;
+  ClothSimulation simulation(integrator_type, integration_step, parameters);
+  simulation.SetThreadCount(thread_count);
+  if (hash_interval > 0) {
+    simulation.SetStateHashing(
+        hash_interval, [](long step, double time, uint64_t hash) {
+          printf("state hash at step %ld (%.6f s): %016llx\n", step, time,
+                 (unsigned long long)hash);
+        });
+  }
+  long num_frames = long(std::ceil(duration / integration_step));
+  size_t num_particles = simulation.GetState().Size();
+  std::unique_ptr<TrajectoryRecorder> recorder;
+  if (!record_path.empty()) {
+    std::pair<glm::vec3, glm::vec3> bounds = simulation.GetBounds();
+    recorder.reset(new TrajectoryRecorder(record_path, num_particles,
+                                          bounds.first, bounds.second));
+  }
+
+  // One frame per step, so the ball moves exactly as in the windowed app.
+  using Clock = std::chrono::steady_clock;
+  Clock::time_point start = Clock::now();
+  long num_steps = 0;
+  for (long i = 0; i < num_frames; i++) {
+    TraceScope trace("Frame");
+    num_steps += simulation.Advance(integration_step);
+    if (recorder != nullptr) {
+      recorder->RecordFrame(simulation.GetTime(), simulation.GetState().positions);
+    }
+  }
+  // Finishes writing before the wall time is taken.
+  recorder.reset();
+  double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+  Tracer::GetInstance().Stop();
+  if (!save_path.empty()) {
+    simulation.SaveCheckpoint(save_path);
+  }
+
+  printf("particles            : %zu\n", num_particles);
+  printf("threads              : %d\n", thread_count);
+  printf("steps                : %ld of %g s\n", num_steps, integration_step);
+  if (!load_path.empty()) {
+    printf("resumed from         : %s\n", load_path.c_str());
+  }
+  printf("simulated time       : %g s\n", simulation.GetTime());
+  printf("wall time            : %.3f s\n", elapsed);
+  printf("steps per second     : %.1f\n", num_steps / elapsed);
+  printf("ns per particle-step : %.2f\n",
+         elapsed * 1e9 / (double(num_steps) * num_particles));
+  const AdaptiveStepStats* stats = simulation.GetAdaptiveStats();
+  if (stats != nullptr) {
+    printf("adaptive substeps    : %ld accepted, %ld rejected\n",
+           stats->accepted_steps, stats->rejected_steps);
+  }
+  glm::vec3 corner = simulation.GetState().positions.back();
+  printf("last particle        : %g %g %g\n", corner.x, corner.y, corner.z);
+
+  const Profiler& profiler = Profiler::GetInstance();
+  for (const Profiler::Scope& scope : profiler.GetScopes()) {
+    printf("%-21s: %.3f s in %ld calls (%.1f%%)\n", scope.name,
+           scope.total_seconds, scope.total_calls,
+           100.0 * scope.total_seconds / elapsed);
+  }
+  return 0;
+}
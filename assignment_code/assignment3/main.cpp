@@ -6,42 +6,39 @@
 
 #include "SimulationApp.hpp"
 #include "IntegratorType.hpp"
+#include "SceneConfig.hpp"
 
 using namespace GLOO;
 
 int main(int argc, char** argv) {
-  if (argc != 3) {
-    printf("Usage: %s <e|t|r> <timestep>\n", argv[0]);
-    printf("       e: Integrator: Forward Euler\n");
-    printf("       t: Integrator: Trapezoid\n");
-    printf("       r: Integrator: RK 4\n");
+  if (argc < 3 || argc > 5) {
+    printf("Usage: %s <e|s|v|t|r|d|i|x> <timestep> [threads] [scene]\n",
+           argv[0]);
+    printf("%s", kIntegratorUsage);
+    printf("       threads: worker threads for cloth forces (default 1)\n");
+    printf("       scene: scene description file; objects use the integrator\n");
+    printf("              and timestep above unless the file sets their own\n");
     printf("\n");
     printf("Try  : %s t 0.001\n", argv[0]);
     printf("       for trapezoid (1ms steps)\n");
     printf("Or   : %s r 0.005\n", argv[0]);
     printf("       for RK4 (5ms steps)\n");
+    printf("Or   : %s i 0.016\n", argv[0]);
+    printf("       for implicit Euler (one step per frame)\n");
+    printf("Or   : %s i 0.016 8 assets/scenes/large_cloth.scene\n", argv[0]);
+    printf("       for a 256x256 cloth on 8 threads\n");
     return -1;
   }
 
-  IntegratorType integrator_type;
-  switch (argv[1][0]) {
-    case 'e':
-      integrator_type = IntegratorType::Euler;
-      break;
-    case 't':
-      integrator_type = IntegratorType::Trapezoidal;
-      break;
-    case 'r':
-      integrator_type = IntegratorType::RK4;
-      break;
-    default:
-      throw std::runtime_error(
-          "Unrecognized integrator type: " + std::string(1, argv[1][0]) + ".");
-  }
+  IntegratorType integrator_type = ParseIntegratorType(argv[1][0]);
   float integration_step = std::stof(argv[2]);
+  int thread_count = argc >= 4 ? std::stoi(argv[3]) : 1;
+  SceneConfig scene_config =
+      argc == 5 ? LoadSceneConfig(argv[4], integrator_type, integration_step)
+                : CreateDefaultSceneConfig(integrator_type, integration_step);
 
   std::unique_ptr<SimulationApp> app = make_unique<SimulationApp>(
-      "Assignment3", glm::ivec2(1440, 900), integrator_type, integration_step);
+      "Assignment3", glm::ivec2(1440, 900), scene_config, thread_count);
 
   app->SetupScene();
 
@@ -1,13 +1,21 @@
 #include "Application.hpp"
 
+#include <cstdlib>
 #include <iostream>
 
 #include "gloo/utils.hpp"
 #include "gloo/InputManager.hpp"
+#include "gloo/debug/Profiler.hpp"
+#include "gloo/debug/Tracer.hpp"
 
 namespace GLOO {
 Application::Application(std::string app_name, glm::ivec2 window_size)
     : app_name_(app_name), window_size_(window_size) {
+  // Set GLOO_TRACE=trace.json to record a timeline, written on exit.
+  Tracer::SetThreadName("Main");
+  if (Tracer::GetInstance().StartFromEnvironment())
+    std::cout << "Recording trace to " << std::getenv("GLOO_TRACE") << std::endl;
+
   InitializeGLFW();
   InitializeGUI();
 
@@ -16,6 +24,8 @@ Application::Application(std::string app_name, glm::ivec2 window_size)
 }
 
 Application::~Application() {
+  Tracer::GetInstance().Stop();
+
   // Release scene resources before destroying everything else.
   scene_.release();
 
@@ -105,18 +115,33 @@ void Application::DestroyGUI() {
 }
 
 void Application::Tick(double delta_time, double current_time) {
+  TraceScope trace("Application::Tick");
+
   // Process window events.
   glfwPollEvents();
   UpdateGUI();
 
   // Logic update before rendering.
-  scene_->Update(delta_time);
+  {
+    ScopedTimer timer("Scene::Update");
+    UpdateScene(delta_time);
+  }
 
   // Rendering scene and GUI.
-  renderer_->Render(*scene_);
-  RenderGUI();
+  {
+    ScopedTimer timer("Renderer::Render");
+    renderer_->Render(*scene_);
+  }
+  {
+    ScopedTimer timer("RenderGUI");
+    RenderGUI();
+  }
 
-  glfwSwapBuffers(window_handle_);
+  {
+    ScopedTimer timer("SwapBuffers");
+    glfwSwapBuffers(window_handle_);
+  }
+  Profiler::GetInstance().EndFrame();
 }
 
 void Application::FramebufferSizeCallback(glm::ivec2 window_size) {
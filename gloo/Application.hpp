@@ -24,6 +24,10 @@ class Application {
  protected:
   virtual void DrawGUI() {
   }
+  // Runs the logic update of a frame, before rendering.
+  virtual void UpdateScene(double delta_time) {
+    scene_->Update(delta_time);
+  }
   virtual void SetupScene() = 0;
   std::unique_ptr<Scene> scene_;
 
@@ -12,6 +12,7 @@
 #include "components/ShadingComponent.hpp"
 #include "components/CameraComponent.hpp"
 #include "debug/PrimitiveFactory.hpp"
+#include "debug/Profiler.hpp"
 
 
 namespace GLOO {
@@ -65,7 +66,11 @@ void Renderer::RenderScene(const Scene& scene) const {
   GL_CHECK(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
 
   const SceneNode& root = scene.GetRootNode();
-  auto rendering_info = RetrieveRenderingInfo(scene);
+  RenderingInfo rendering_info;
+  {
+    ScopedTimer timer("RetrieveRenderingInfo");
+    rendering_info = RetrieveRenderingInfo(scene);
+  }
   auto light_ptrs = root.GetComponentPtrsInChildren<LightComponent>();
   if (light_ptrs.size() == 0) {
     // Make sure there are at least 2 passes of we don't forget to set color
@@ -80,6 +85,8 @@ void Renderer::RenderScene(const Scene& scene) const {
   size_t total_passes = 1 + light_ptrs.size();
 
   for (size_t pass = 0; pass < total_passes; pass++) {
+    // CPU time spent submitting the pass; the GPU runs behind it.
+    ScopedTimer timer(pass == 0 ? "Depth pass" : "Light pass");
 
     GL_CHECK(glDepthMask((pass == 0) ? GL_TRUE : GL_FALSE));
     bool color_mask = (pass == 0) ? GL_FALSE : GL_TRUE;
@@ -1,5 +1,9 @@
 #include "Scene.hpp"
 
+#include <typeinfo>
+
+#include "debug/Tracer.hpp"
+
 namespace GLOO {
 
 void Scene::Update(double delta_time) {
@@ -7,7 +11,10 @@ void Scene::Update(double delta_time) {
 }
 
 void Scene::RecursiveUpdate(SceneNode& node, double delta_time) {
-  node.Update(delta_time);
+  {
+    TraceScope trace(typeid(node).name(), Tracer::kNodeCategory);
+    node.Update(delta_time);
+  }
   size_t child_count = node.GetChildrenCount();
   for (size_t i = 0; i < child_count; i++) {
     RecursiveUpdate(node.GetChild(i), delta_time);
@@ -0,0 +1,92 @@
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace GLOO {
+const int Profiler::kHistoryFrames;
+
+int Profiler::BeginScope(const char* name) {
+  int* link = current_ == -1 ? &first_root_ : &scopes_[current_].first_child;
+  while (*link != -1) {
+    const Scope& scope = scopes_[*link];
+    if (scope.name == name || std::strcmp(scope.name, name) == 0)
+      break;
+    link = &scopes_[*link].next_sibling;
+  }
+
+  if (*link == -1) {
+    Scope scope;
+    scope.name = name;
+    scope.parent = current_;
+    scope.depth = current_ == -1 ? 0 : scopes_[current_].depth + 1;
+    scope.first_child = -1;
+    scope.next_sibling = -1;
+    scope.frame_seconds = 0.0;
+    scope.frame_calls = 0;
+    scope.last_frame_calls = 0;
+    std::fill(scope.history, scope.history + kHistoryFrames, 0.0f);
+    scope.total_seconds = 0.0;
+    scope.total_calls = 0;
+    // link may point into scopes_, so set it before the vector can grow.
+    *link = int(scopes_.size());
+    current_ = *link;
+    scopes_.push_back(scope);
+  } else {
+    current_ = *link;
+  }
+  return current_;
+}
+
+void Profiler::EndScope(int index, double seconds) {
+  assert(index == current_);
+  Scope& scope = scopes_[index];
+  scope.frame_seconds += seconds;
+  scope.frame_calls++;
+  scope.total_seconds += seconds;
+  scope.total_calls++;
+  current_ = scope.parent;
+}
+
+void Profiler::EndFrame() {
+  assert(current_ == -1);
+  for (Scope& scope : scopes_) {
+    scope.history[history_cursor_] = float(scope.frame_seconds);
+    scope.last_frame_calls = scope.frame_calls;
+    scope.frame_seconds = 0.0;
+    scope.frame_calls = 0;
+  }
+  history_cursor_ = (history_cursor_ + 1) % kHistoryFrames;
+  frame_count_++;
+}
+
+void Profiler::Reset() {
+  scopes_.clear();
+  first_root_ = -1;
+  current_ = -1;
+  history_cursor_ = 0;
+  frame_count_ = 0;
+}
+
+int Profiler::GetHistorySize() const {
+  return int(std::min<long>(frame_count_, kHistoryFrames));
+}
+
+float Profiler::GetAverageSeconds(int index) const {
+  int size = GetHistorySize();
+  if (size == 0)
+    return 0.0f;
+  // Slots past size are still zero, so summing the whole ring is fine.
+  const float* history = scopes_[index].history;
+  float sum = 0.0f;
+  for (int i = 0; i < kHistoryFrames; i++)
+    sum += history[i];
+  return sum / size;
+}
+
+float Profiler::GetMaxSeconds(int index) const {
+  const float* history = scopes_[index].history;
+  return *std::max_element(history, history + kHistoryFrames);
+}
+}  // namespace GLOO
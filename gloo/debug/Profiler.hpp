@@ -0,0 +1,130 @@
+#ifndef GLOO_PROFILER_H_
+#define GLOO_PROFILER_H_
+
+#include <chrono>
+#include <vector>
+
+#include "Tracer.hpp"
+
+namespace GLOO {
+// Collects the CPU time spent in named, nested scopes. Scopes are keyed by
+// their name and their enclosing scope, so the same name under two parents is
+// tracked twice. Per-frame totals are kept for the last kHistoryFrames frames
+// for rolling averages and maxima, along with lifetime totals.
+//
+// Opening a scope costs a clock read and a short scan of its siblings, so the
+// profiler stays on in release builds. Every thread records into a profiler
+// of its own; work handed to the thread pool is timed by the enclosing scope.
+// To show another thread's scopes, that thread copies its profiler into a
+// buffer the reader can take it from, as SimulationThread does.
+class Profiler {
+ public:
+  static const int kHistoryFrames = 120;
+
+  struct Scope {
+    // Must outlive the profiler; string literals are expected.
+    const char* name;
+    int parent;
+    int depth;
+    int first_child;
+    int next_sibling;
+
+    double frame_seconds;
+    int frame_calls;
+    int last_frame_calls;
+    // Seconds per frame over the last kHistoryFrames frames, as a ring.
+    float history[kHistoryFrames];
+    double total_seconds;
+    long total_calls;
+  };
+
+  // The calling thread's profiler.
+  static Profiler& GetInstance() {
+    static thread_local Profiler _instance;
+    return _instance;
+  }
+
+  Profiler() {
+  }
+
+  bool IsEnabled() const {
+    return enabled_;
+  }
+  void SetEnabled(bool enabled) {
+    enabled_ = enabled;
+  }
+
+  // Opens a child of the innermost open scope and returns its index.
+  int BeginScope(const char* name);
+  // Closes the innermost open scope, which must be index.
+  void EndScope(int index, double seconds);
+  // Moves the current frame's totals into the history. Call once per frame,
+  // with no scope open.
+  void EndFrame();
+  // Forgets every scope. Call between frames.
+  void Reset();
+
+  // Scopes in the order they were first opened. Walk the tree through
+  // GetFirstRoot, first_child and next_sibling; -1 ends a list.
+  const std::vector<Scope>& GetScopes() const {
+    return scopes_;
+  }
+  int GetFirstRoot() const {
+    return first_root_;
+  }
+  // Number of frames in the history, at most kHistoryFrames.
+  int GetHistorySize() const;
+  float GetAverageSeconds(int index) const;
+  float GetMaxSeconds(int index) const;
+
+ private:
+  bool enabled_{true};
+  std::vector<Scope> scopes_;
+  int first_root_{-1};
+  int current_{-1};
+  // Next slot in the history rings, and frames recorded so far.
+  int history_cursor_{0};
+  long frame_count_{0};
+};
+
+// Times its own lifetime as a scope of the profiler, and records it as a
+// trace event while the tracer is recording.
+//
+//   {
+//     ScopedTimer timer("UpdateClothNormals");
+//     UpdateClothNormals();
+//   }
+class ScopedTimer {
+ public:
+  explicit ScopedTimer(const char* name)
+      : name_(name), tracing_(Tracer::IsEnabled()) {
+    Profiler& profiler = Profiler::GetInstance();
+    index_ = profiler.IsEnabled() ? profiler.BeginScope(name) : -1;
+    if (index_ != -1 || tracing_)
+      start_ = std::chrono::steady_clock::now();
+  }
+  ~ScopedTimer() {
+    if (index_ == -1 && !tracing_)
+      return;
+    std::chrono::steady_clock::time_point end =
+        std::chrono::steady_clock::now();
+    if (index_ != -1) {
+      std::chrono::duration<double> elapsed = end - start_;
+      Profiler::GetInstance().EndScope(index_, elapsed.count());
+    }
+    if (tracing_)
+      Tracer::GetInstance().Record(name_, "gloo", start_, end);
+  }
+
+  ScopedTimer(const ScopedTimer&) = delete;
+  void operator=(const ScopedTimer&) = delete;
+
+ private:
+  const char* name_;
+  bool tracing_;
+  int index_;
+  std::chrono::steady_clock::time_point start_;
+};
+}  // namespace GLOO
+
+#endif
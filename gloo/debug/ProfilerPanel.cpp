@@ -0,0 +1,74 @@
+#include "ProfilerPanel.hpp"
+
+#include "gloo/external.hpp"
+
+namespace GLOO {
+namespace {
+void DrawScopes(const Profiler& profiler, int index) {
+  const std::vector<Profiler::Scope>& scopes = profiler.GetScopes();
+  for (; index != -1; index = scopes[index].next_sibling) {
+    const Profiler::Scope& scope = scopes[index];
+    ImGui::Text("%*s%s", 2 * scope.depth, "", scope.name);
+    ImGui::NextColumn();
+    ImGui::Text("%.3f", 1000.0f * profiler.GetAverageSeconds(index));
+    ImGui::NextColumn();
+    ImGui::Text("%.3f", 1000.0f * profiler.GetMaxSeconds(index));
+    ImGui::NextColumn();
+    ImGui::Text("%d", scope.last_frame_calls);
+    ImGui::NextColumn();
+    DrawScopes(profiler, scope.first_child);
+  }
+}
+
+void DrawScopeTable(const Profiler& profiler, const char* table_id) {
+  ImGui::Columns(4, table_id);
+  ImGui::Text("Scope");
+  ImGui::NextColumn();
+  ImGui::Text("Avg ms");
+  ImGui::NextColumn();
+  ImGui::Text("Max ms");
+  ImGui::NextColumn();
+  ImGui::Text("Calls");
+  ImGui::NextColumn();
+  ImGui::Separator();
+  DrawScopes(profiler, profiler.GetFirstRoot());
+  ImGui::Columns(1);
+}
+
+ProfilerPanelChanges BeginProfilerPanel(Profiler& profiler) {
+  ProfilerPanelChanges changes;
+  ImGui::Begin("Profiler");
+  changes.enabled = profiler.IsEnabled();
+  if (ImGui::Checkbox("Enabled", &changes.enabled)) {
+    profiler.SetEnabled(changes.enabled);
+    changes.enabled_changed = true;
+  }
+  ImGui::SameLine();
+  if (ImGui::Button("Reset")) {
+    profiler.Reset();
+    changes.reset = true;
+  }
+  ImGui::Text("CPU time per frame over the last %d frames",
+              profiler.GetHistorySize());
+  DrawScopeTable(profiler, "profiler_scopes");
+  return changes;
+}
+}  // namespace
+
+void DrawProfilerPanel(Profiler& profiler) {
+  BeginProfilerPanel(profiler);
+  ImGui::End();
+}
+
+ProfilerPanelChanges DrawProfilerPanel(Profiler& profiler,
+                                       const Profiler& thread_profiler,
+                                       const char* thread_name) {
+  ProfilerPanelChanges changes = BeginProfilerPanel(profiler);
+  ImGui::Separator();
+  ImGui::Text("%s thread, per pass over the last %d passes", thread_name,
+              thread_profiler.GetHistorySize());
+  DrawScopeTable(thread_profiler, "thread_profiler_scopes");
+  ImGui::End();
+  return changes;
+}
+}  // namespace GLOO
@@ -0,0 +1,27 @@
+#ifndef GLOO_PROFILER_PANEL_H_
+#define GLOO_PROFILER_PANEL_H_
+
+#include "Profiler.hpp"
+
+namespace GLOO {
+// What the panel's controls were used for in one frame.
+struct ProfilerPanelChanges {
+  bool enabled_changed = false;
+  bool enabled = true;
+  bool reset = false;
+};
+
+// Draws the profiler's scope tree as an ImGui window with the rolling average
+// and maximum per frame of each scope. Kept apart from Profiler so that tools
+// without a GUI can time scopes without linking ImGui.
+void DrawProfilerPanel(Profiler& profiler);
+// As above, followed by the scopes of another thread's profiler, copied from
+// it between that thread's frames. The controls only act on profiler; the
+// caller passes the returned changes on to the other thread, which applies
+// them to its own profiler between its frames.
+ProfilerPanelChanges DrawProfilerPanel(Profiler& profiler,
+                                       const Profiler& thread_profiler,
+                                       const char* thread_name);
+}  // namespace GLOO
+
+#endif
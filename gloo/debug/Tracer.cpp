@@ -0,0 +1,184 @@
+#include "Tracer.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <unordered_map>
+
+#ifdef __GNUG__
+#include <cxxabi.h>
+#endif
+
+namespace GLOO {
+namespace {
+thread_local const char* thread_name = nullptr;
+
+std::string Demangle(const char* name) {
+#ifdef __GNUG__
+  int status = 0;
+  char* demangled = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+  if (status == 0 && demangled != nullptr) {
+    std::string result = demangled;
+    std::free(demangled);
+    return result;
+  }
+#endif
+  return name;
+}
+
+void WriteEscaped(FILE* out, const char* text) {
+  for (; *text != '\0'; text++) {
+    if (*text == '"' || *text == '\\')
+      fputc('\\', out);
+    fputc(*text, out);
+  }
+}
+}  // namespace
+
+const char* const Tracer::kNodeCategory = "node";
+const int Tracer::kChunkSize;
+const int Tracer::kMaxChunks;
+std::atomic<bool> Tracer::enabled_(false);
+
+Tracer::~Tracer() {
+  if (IsEnabled())
+    Stop();
+  for (auto& buffer : buffers_) {
+    for (int i = 0; i < kMaxChunks; i++)
+      delete[] buffer->chunks[i].load();
+  }
+}
+
+void Tracer::Start(const std::string& path) {
+  if (IsEnabled())
+    return;
+  path_ = path;
+  epoch_ = Clock::now();
+  dropped_events_.store(0);
+  enabled_.store(true);
+}
+
+bool Tracer::StartFromEnvironment() {
+  const char* path = std::getenv("GLOO_TRACE");
+  if (path == nullptr || *path == '\0')
+    return false;
+  Start(path);
+  return true;
+}
+
+void Tracer::Stop() {
+  if (!IsEnabled())
+    return;
+  enabled_.store(false);
+  Write(path_);
+}
+
+void Tracer::SetThreadName(const char* name) {
+  thread_name = name;
+  if (IsEnabled())
+    GetInstance().GetThreadBuffer().thread_name.store(name);
+}
+
+Tracer::ThreadBuffer& Tracer::GetThreadBuffer() {
+  thread_local ThreadBuffer* buffer = nullptr;
+  if (buffer == nullptr) {
+    std::lock_guard<std::mutex> lock(registry_mutex_);
+    buffers_.emplace_back(new ThreadBuffer());
+    buffer = buffers_.back().get();
+    buffer->thread_id = int(buffers_.size());
+    buffer->thread_name.store(thread_name);
+    for (int i = 0; i < kMaxChunks; i++)
+      buffer->chunks[i].store(nullptr);
+    buffer->count.store(0);
+    buffer->written = 0;
+  }
+  return *buffer;
+}
+
+void Tracer::Record(const char* name,
+                    const char* category,
+                    Clock::time_point start,
+                    Clock::time_point end) {
+  if (!IsEnabled())
+    return;
+  ThreadBuffer& buffer = GetThreadBuffer();
+  long index = buffer.count.load(std::memory_order_relaxed);
+  int chunk_index = int(index / kChunkSize);
+  if (chunk_index >= kMaxChunks) {
+    dropped_events_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  Event* chunk = buffer.chunks[chunk_index].load(std::memory_order_relaxed);
+  if (chunk == nullptr) {
+    chunk = new Event[kChunkSize];
+    buffer.chunks[chunk_index].store(chunk, std::memory_order_release);
+  }
+  Event& event = chunk[index % kChunkSize];
+  event.name = name;
+  event.category = category;
+  event.start_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(start - epoch_)
+          .count();
+  event.duration_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+          .count();
+  buffer.count.store(index + 1, std::memory_order_release);
+}
+
+void Tracer::Write(const std::string& path) {
+  std::lock_guard<std::mutex> lock(registry_mutex_);
+  FILE* out = fopen(path.c_str(), "w");
+  if (out == nullptr) {
+    std::cerr << "Cannot write trace to " << path << "!" << std::endl;
+    return;
+  }
+
+  std::unordered_map<const char*, std::string> node_names;
+  bool first = true;
+  fprintf(out, "{\"traceEvents\":[");
+  for (auto& buffer : buffers_) {
+    const char* name = buffer->thread_name.load();
+    fprintf(out,
+            "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+            "\"args\":{\"name\":\"",
+            first ? "" : ",", buffer->thread_id);
+    if (name != nullptr) {
+      WriteEscaped(out, name);
+    } else {
+      fprintf(out, "Thread %d", buffer->thread_id);
+    }
+    fprintf(out, "\"}}");
+    first = false;
+
+    long count = buffer->count.load(std::memory_order_acquire);
+    for (long i = buffer->written; i < count; i++) {
+      const Event* chunk =
+          buffer->chunks[i / kChunkSize].load(std::memory_order_acquire);
+      const Event& event = chunk[i % kChunkSize];
+      // Events recorded before this trace started.
+      if (event.start_ns < 0)
+        continue;
+      const char* event_name = event.name;
+      if (event.category == kNodeCategory) {
+        auto it = node_names.find(event.name);
+        if (it == node_names.end())
+          it = node_names.emplace(event.name, Demangle(event.name)).first;
+        event_name = it->second.c_str();
+      }
+      fprintf(out, ",\n{\"name\":\"");
+      WriteEscaped(out, event_name);
+      fprintf(out,
+              "\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+              "\"ts\":%.3f,\"dur\":%.3f}",
+              event.category, buffer->thread_id, event.start_ns / 1000.0,
+              event.duration_ns / 1000.0);
+    }
+    buffer->written = count;
+  }
+  fprintf(out,
+          "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped_events\":"
+          "%ld}}\n",
+          dropped_events_.load());
+  fclose(out);
+}
+}  // namespace GLOO
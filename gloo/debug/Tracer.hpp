@@ -0,0 +1,122 @@
+#ifndef GLOO_TRACER_H_
+#define GLOO_TRACER_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace GLOO {
+// Opt-in timeline recorder that writes Chrome trace-event JSON, which
+// chrome://tracing and Perfetto load directly. Each thread appends complete
+// events to its own buffer without locks; the buffers are only read when a
+// recording stops and is written out. While no recording is running a scope
+// costs one relaxed atomic load.
+class Tracer {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  // Events of "node" category carry a typeid name, demangled on output.
+  static const char* const kNodeCategory;
+
+  // Singleton design pattern, as InputManager.
+  static Tracer& GetInstance() {
+    static Tracer _instance;
+    return _instance;
+  }
+
+  Tracer(const Tracer&) = delete;
+  void operator=(const Tracer&) = delete;
+
+  static bool IsEnabled() {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+
+  // Starts recording; Stop writes everything recorded since to path.
+  void Start(const std::string& path);
+  // Starts recording to the file named by the GLOO_TRACE environment
+  // variable, if it is set. Returns whether recording started.
+  bool StartFromEnvironment();
+  // Stops recording and writes the trace. Events still being recorded by
+  // other threads at this point may be left out.
+  void Stop();
+
+  // Appends a complete event to the calling thread's buffer. name and
+  // category must outlive the tracer; string literals are expected.
+  void Record(const char* name,
+              const char* category,
+              Clock::time_point start,
+              Clock::time_point end);
+  // Labels the calling thread in the trace. name must outlive the tracer.
+  static void SetThreadName(const char* name);
+
+ private:
+  struct Event {
+    const char* name;
+    const char* category;
+    int64_t start_ns;
+    int64_t duration_ns;
+  };
+
+  // Events are stored in fixed-size chunks allocated by the owning thread as
+  // it needs them. Publishing the count with release ordering makes every
+  // event below it visible to the thread writing the trace.
+  static const int kChunkSize = 1 << 16;
+  static const int kMaxChunks = 64;
+  struct ThreadBuffer {
+    int thread_id;
+    std::atomic<const char*> thread_name;
+    std::atomic<Event*> chunks[kMaxChunks];
+    std::atomic<long> count;
+    // Events before this index went into an earlier trace. Only touched by
+    // Stop, under registry_mutex_.
+    long written;
+  };
+
+  Tracer() {
+  }
+  ~Tracer();
+
+  ThreadBuffer& GetThreadBuffer();
+  void Write(const std::string& path);
+
+  static std::atomic<bool> enabled_;
+  std::string path_;
+  Clock::time_point epoch_;
+  std::atomic<long> dropped_events_{0};
+
+  // Taken when a thread records its first event and when a trace is written.
+  std::mutex registry_mutex_;
+  std::vector<std::unique_ptr<ThreadBuffer>> buffers_;
+};
+
+// Records its own lifetime as a trace event. Safe to use on any thread;
+// ScopedTimer does the same and also feeds the calling thread's profiler.
+class TraceScope {
+ public:
+  explicit TraceScope(const char* name, const char* category = "gloo")
+      : name_(name), category_(category), enabled_(Tracer::IsEnabled()) {
+    if (enabled_)
+      start_ = Tracer::Clock::now();
+  }
+  ~TraceScope() {
+    if (enabled_)
+      Tracer::GetInstance().Record(name_, category_, start_,
+                                   Tracer::Clock::now());
+  }
+
+  TraceScope(const TraceScope&) = delete;
+  void operator=(const TraceScope&) = delete;
+
+ private:
+  const char* name_;
+  const char* category_;
+  bool enabled_;
+  Tracer::Clock::time_point start_;
+};
+}  // namespace GLOO
+
+#endif